@@ -0,0 +1,58 @@
+#ifndef H_BIT_MASK
+#define H_BIT_MASK
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+class BitMask{
+public:
+  BitMask();
+  BitMask(const BitMask &) = default;
+  BitMask& operator=(const BitMask &) = default;
+  BitMask(BitMask &&) = default;
+  BitMask& operator=(BitMask &&) = default;
+  ~BitMask() = default;
+
+  void Assign(const std::vector<double> &values);
+  void Resize(std::size_t size);
+  void Set(std::size_t i);
+
+  bool Test(std::size_t i) const;
+  std::size_t NextSet(std::size_t i) const;
+  std::size_t Size() const;
+  bool Any() const;
+  std::size_t Count() const;
+
+private:
+  std::size_t size_;//!<Number of bits
+  std::vector<std::uint64_t> words_;//!<Bits, 64 per word. Bits at or beyond size_ are always 0.
+};
+
+/*!\brief Sets bit i, which must be less than Size()
+ */
+inline void BitMask::Set(std::size_t i){
+  words_[i >> 6] |= std::uint64_t(1) << (i & 63);
+}
+
+/*!\brief Check if bit i, which must be less than Size(), is set
+ */
+inline bool BitMask::Test(std::size_t i) const{
+  return (words_[i >> 6] >> (i & 63)) & 1;
+}
+
+/*!\brief Index of the first set bit at or after i, or Size() if there is none
+ */
+inline std::size_t BitMask::NextSet(std::size_t i) const{
+  std::size_t iword = i >> 6;
+  if(iword >= words_.size()) return size_;
+  std::uint64_t word = words_[iword] & (~std::uint64_t(0) << (i & 63));
+  while(word == 0){
+    if(++iword == words_.size()) return size_;
+    word = words_[iword];
+  }
+  return (iword << 6) + __builtin_ctzll(word);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef H_CATEGORY_HIST1D
+#define H_CATEGORY_HIST1D
+
+#include <cstddef>
+
+#include <iosfwd>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "core/figure.hpp"
+#include "core/process.hpp"
+#include "core/axis.hpp"
+#include "core/named_func.hpp"
+#include "core/plot_opt.hpp"
+#include "core/hist1d.hpp"
+#include "core/bit_mask.hpp"
+
+class CategoryHist1D final: public Figure{
+public:
+  class SingleCategoryHist1D final: public Figure::FigureComponent{
+  public:
+    SingleCategoryHist1D(const CategoryHist1D &figure,
+                         const std::shared_ptr<Process> &process);
+    ~SingleCategoryHist1D() = default;
+
+    void RecordEvent(const Baby &baby) final;
+    void FinishBaby(const Baby &baby) final;
+    bool CanRecordBlock() const final;
+    void RecordBlock(const EventBlock &block,
+                     const NamedFunc::VectorType &pass) final;
+    std::size_t EstimateBytes() const final;
+    bool CanMerge() const final;
+    void WriteState(std::ostream &out) final;
+    void MergeState(std::istream &in) final;
+
+  private:
+    SingleCategoryHist1D() = delete;
+    SingleCategoryHist1D(const SingleCategoryHist1D &) = delete;
+    SingleCategoryHist1D& operator=(const SingleCategoryHist1D &) = delete;
+    SingleCategoryHist1D(SingleCategoryHist1D &&) = delete;
+    SingleCategoryHist1D& operator=(SingleCategoryHist1D &&) = delete;
+
+    std::vector<Hist1D::SingleHist1D*> hists_;//!<Component of the process in each category's Hist1D
+    NamedFunc proc_and_hist_cut_;//!<Cut of the histograms and of the process
+    BitMask cut_mask_;//!<Elements passing a vector cut in the current entry
+    NamedFunc::VectorType cat_vector_, cut_vector_, wgt_vector_, val_vector_;
+  };
+
+  CategoryHist1D(const Axis &xaxis, const NamedFunc &cut,
+                 const NamedFunc &category,
+                 const std::vector<std::string> &category_names,
+                 const std::vector<std::shared_ptr<Process> > &processes,
+                 const std::vector<PlotOpt> &plot_options = {PlotOpt()});
+  CategoryHist1D(CategoryHist1D &&) = default;
+  CategoryHist1D& operator=(CategoryHist1D &&) = default;
+  ~CategoryHist1D() = default;
+
+  void Print(double luminosity,
+             const std::string &subdir) final;
+
+  std::set<const Process*> GetProcesses() const final;
+
+  std::string GetTag() const final;
+  std::vector<NamedFunc> GetFunctions() const final;
+  FigureComponent * GetComponent(const Process *process) final;
+
+  std::size_t NumCategories() const;
+  const Hist1D & Category(std::size_t icategory) const;
+
+  CategoryHist1D & Weight(const NamedFunc &weight);
+  CategoryHist1D & Tag(const std::string &tag);
+  CategoryHist1D & LuminosityTag(const std::string &tag);
+  CategoryHist1D & LeftLabel(const std::vector<std::string> &label);
+  CategoryHist1D & LeftLabel(std::size_t icategory, const std::vector<std::string> &label);
+  CategoryHist1D & RightLabel(const std::vector<std::string> &label);
+  CategoryHist1D & RightLabel(std::size_t icategory, const std::vector<std::string> &label);
+  CategoryHist1D & YAxisZoom(const double &yaxis_zoom);
+  CategoryHist1D & YAxisZoom(std::size_t icategory, const double &yaxis_zoom);
+  CategoryHist1D & RatioTitle(const std::string &numerator,
+                              const std::string &denominator);
+  CategoryHist1D & DrawPlot(const bool &draw_plot);
+
+  NamedFunc category_;//!<Scalar index of the category to fill, entries outside [0, NumCategories()) are skipped
+  std::vector<std::string> category_names_;//!<Name of each category, appended to the file name of its plot
+  std::string tag_;//!<Filename tag to identify plots, before the category name
+
+private:
+  std::vector<std::unique_ptr<Hist1D> > hists_;//!<Plot of each category
+  std::vector<std::unique_ptr<SingleCategoryHist1D> > components_;//!<Component of each process
+
+  CategoryHist1D(const CategoryHist1D &) = delete;
+  CategoryHist1D& operator=(const CategoryHist1D &) = delete;
+  CategoryHist1D() = delete;
+
+  void SetCategoryTags();
+};
+
+#endif
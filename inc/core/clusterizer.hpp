@@ -1,15 +1,20 @@
 #ifndef H_CLUSTERIZER
 #define H_CLUSTERIZER
 
+#include <cstddef>
+
 #include <list>
 #include <set>
 #include <vector>
+#include <istream>
 #include <ostream>
 #include <random>
 
 #include "TH2D.h"
 #include "TGraph.h"
 
+#include "core/fast_hist.hpp"
+
 namespace Clustering{
   class Point{
   public:
@@ -49,10 +54,15 @@ namespace Clustering{
     TH2D GetHistogram() const;
     TGraph GetGraph(double luminosity, bool keep_in_frame = true) const;
 
+    std::size_t EstimateBytes() const;
+    void WriteState(std::ostream &out) const;
+    void MergeState(std::istream &in);
+
   private:
     long max_points_;
     bool hist_mode_;
-    TH2D hist_;
+    mutable TH2D hist_;//!<Histogram of all points. Mutable to add pending_fills_ when read
+    mutable FastHist pending_fills_;//!<Points added since hist_ was last updated
     std::vector<Point> orig_points_;
     mutable std::list<Node> nodes_;
     mutable std::vector<Point> final_points_;
@@ -72,6 +82,7 @@ namespace Clustering{
                     float dist);
 
     void EmptyHistogram();
+    void FlushPendingFills() const;
     void ConvertToHist();
 
     void Cluster(double luminosity) const;
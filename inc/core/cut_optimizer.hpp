@@ -0,0 +1,90 @@
+#ifndef H_CUT_OPTIMIZER
+#define H_CUT_OPTIMIZER
+
+#include <cstddef>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/named_func.hpp"
+
+class CutOptimizer{
+public:
+  class Chain : public std::enable_shared_from_this<Chain>{
+  public:
+    Chain(const std::string &name,
+          const std::vector<NamedFunc> &conjuncts);
+    ~Chain() = default;
+
+    NamedFunc::ScalarType Evaluate(const Baby &baby) const;
+
+    bool Reordered() const;
+    void Print(std::ostream &stream) const;
+
+  private:
+    friend class CutOptimizer;
+
+    struct State{
+      const Baby *baby_;//!<Baby for which order is being learned
+      std::size_t num_events_;//!<Number of training events seen so far
+      std::vector<std::size_t> order_;//!<Chosen evaluation order, empty while training
+      std::vector<double> seconds_;//!<Total evaluation time of each conjunct
+      std::vector<long> calls_;//!<Number of evaluations of each conjunct
+      std::vector<long> passes_;//!<Number of evaluations returning true
+    };
+
+    struct OrderSummary{
+      long num_files_;//!<Number of Babies for which this order was chosen
+      double cost_before_;//!<Summed expected time per event with original order
+      double cost_after_;//!<Summed expected time per event with this order
+    };
+
+    Chain(const Chain &) = delete;
+    Chain& operator=(const Chain &) = delete;
+    Chain(Chain &&) = delete;
+    Chain& operator=(Chain &&) = delete;
+
+    static std::unordered_map<unsigned long, State> & LocalStates();
+
+    State & GetState(const Baby &baby) const;
+    NamedFunc::ScalarType Train(const Baby &baby, State &state) const;
+    void ChooseOrder(State &state) const;
+    double ExpectedCost(const State &state, const std::vector<std::size_t> &order) const;
+
+    unsigned long id_;//!<Unique identifier, used to find the learning state of each thread
+    std::string name_;//!<String representation of the full chain
+    std::vector<std::string> names_;//!<String representation of each conjunct
+    std::vector<std::function<NamedFunc::ScalarFunc> > functions_;//!<Conjuncts in the order written
+    std::vector<bool> pure_;//!<Whether each conjunct may be moved
+
+    mutable std::mutex mutex_;//!<Protects orders_ and registered_
+    mutable std::map<std::vector<std::size_t>, OrderSummary> orders_;//!<Orders chosen so far
+    mutable bool registered_;//!<True once added to list of reported chains
+  };
+
+  static void Enable(bool enable = true);
+  static bool Enabled();
+  static void TrainingEvents(std::size_t num_events);
+  static std::size_t TrainingEvents();
+  static void Report(std::ostream &stream);
+  static void Reset();
+
+private:
+  CutOptimizer() = delete;
+
+  static void Register(const std::shared_ptr<const Chain> &chain);
+
+  static std::atomic<bool> enabled_;//!<Whether chains learn and use optimized orders
+  static std::atomic<std::size_t> training_events_;//!<Events per Baby used to measure conjuncts
+  static std::mutex mutex_;//!<Protects chains_
+  static std::vector<std::weak_ptr<const Chain> > chains_;//!<Chains which chose an order
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef H_DATACARD
+#define H_DATACARD
+
+#include <cstddef>
+
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/figure.hpp"
+#include "core/process.hpp"
+#include "core/axis.hpp"
+#include "core/named_func.hpp"
+#include "core/gamma_params.hpp"
+
+class Datacard final: public Figure{
+public:
+  using Key = std::vector<NamedFunc::ScalarType>;
+
+  class Region{
+  public:
+    Region(const std::string &name,
+           const NamedFunc &cut);
+    Region(const Region &) = default;
+    Region& operator=(const Region &) = default;
+    Region(Region &&) = default;
+    Region& operator=(Region &&) = default;
+    ~Region() = default;
+
+    std::string name_;//!<Name of the bin (channel) in the datacards
+    NamedFunc cut_;//!<Selection of the region
+
+  private:
+    Region() = delete;
+  };
+
+  class Systematic{
+  public:
+    Systematic(const std::string &name,
+               const NamedFunc &up);
+    Systematic(const std::string &name,
+               const NamedFunc &up,
+               const NamedFunc &down);
+    Systematic(const Systematic &) = default;
+    Systematic& operator=(const Systematic &) = default;
+    Systematic(Systematic &&) = default;
+    Systematic& operator=(Systematic &&) = default;
+    ~Systematic() = default;
+
+    std::string name_;//!<Name of the nuisance parameter
+    NamedFunc up_;//!<Factor applied to the nominal weight for the up variation
+    NamedFunc down_;//!<Factor applied to the nominal weight for the down variation
+    bool has_down_;//!<If false, the variation is one-sided
+
+  private:
+    Systematic() = delete;
+  };
+
+  class Point{
+  public:
+    std::vector<double> sumw_;//!<Sum of weights for each region, variation and bin, see Datacard::Index()
+    std::vector<double> sumw2_;//!<Sum of squared weights, indexed like sumw_
+  };
+
+  class SingleDatacard final: public Figure::FigureComponent{
+  public:
+    SingleDatacard(const Datacard &datacard,
+                   const std::shared_ptr<Process> &process);
+    ~SingleDatacard() = default;
+
+    void RecordEvent(const Baby &baby) final;
+    std::size_t EstimateBytes() const final;
+    bool CanMerge() const final;
+    void WriteState(std::ostream &out) final;
+    void MergeState(std::istream &in) final;
+
+    const std::map<Key, Point> & Points() const;
+
+  private:
+    SingleDatacard() = delete;
+    SingleDatacard(const SingleDatacard &) = delete;
+    SingleDatacard& operator=(const SingleDatacard &) = delete;
+    SingleDatacard(SingleDatacard &&) = delete;
+    SingleDatacard& operator=(SingleDatacard &&) = delete;
+
+    Point & GetPoint(const Key &key);
+
+    std::vector<NamedFunc> proc_and_region_cuts_;//!<Cut of each region and of the process
+    std::map<Key, Point> points_;//!<Sums of weights and squared weights for each scan point
+    Point *last_point_;//!<Point of the previous entry, scan files being mostly ordered by point
+    Key last_key_;//!<Key of last_point_
+    Key key_;//!<Key of the current entry (to avoid creating a new vector each event)
+    std::vector<double> weights_;//!<Weight of each variation in the current entry
+  };
+
+  Datacard(const std::string &name,
+           const std::vector<Region> &regions,
+           const std::vector<std::shared_ptr<Process> > &processes);
+  Datacard(const std::string &name,
+           const std::vector<Region> &regions,
+           const Axis &axis,
+           const std::vector<std::shared_ptr<Process> > &processes);
+  Datacard(Datacard &&) = default;
+  Datacard& operator=(Datacard &&) = default;
+  ~Datacard() = default;
+
+  void Print(double luminosity,
+             const std::string &subdir) final;
+
+  std::string GetTag() const final {return name_;}
+  std::set<const Process*> GetProcesses() const final;
+  std::vector<NamedFunc> GetFunctions() const final;
+  FigureComponent * GetComponent(const Process *process) final;
+
+  std::vector<GammaParams> Yield(const Process *process,
+                                 double luminosity,
+                                 const Key &key = Key(),
+                                 std::size_t ivariation = 0) const;
+  std::set<Key> Points() const;
+  std::string PointName(const Key &key) const;
+
+  std::size_t NumBins() const;
+  std::size_t NumVariations() const;
+  std::size_t Index(std::size_t iregion, std::size_t ivariation, std::size_t ibin) const;
+
+  Datacard & ScanKeys(const std::vector<NamedFunc> &keys);
+  Datacard & Weight(const NamedFunc &weight);
+  Datacard & AddSystematic(const Systematic &systematic);
+  Datacard & AddLogNormal(const std::string &name, double kappa);
+  Datacard & McStats(bool mc_stats);
+
+  std::string name_;//!<Name of the datacards, used for the output directory and file names
+  std::vector<Region> regions_;//!<Bins (channels) of the datacards
+  Axis axis_;//!<Binning of the shape histograms in each region
+  bool is_shape_;//!<If false, counting datacards with one yield per region are written
+  std::vector<NamedFunc> keys_;//!<Scalar functions identifying the signal scan point, empty for a single card
+  NamedFunc weight_;//!<Nominal event weight
+  std::vector<Systematic> systematics_;//!<Weight variations, written as lnN or shape nuisances
+  std::vector<std::pair<std::string, double> > log_normals_;//!<Flat lnN uncertainties of all simulated processes
+  bool mc_stats_;//!<Add uncertainties from the limited number of simulated events
+
+private:
+  std::vector<std::unique_ptr<SingleDatacard> > backgrounds_;//!<Background components of the figure
+  std::vector<std::unique_ptr<SingleDatacard> > signals_;//!<Signal components of the figure
+  std::vector<std::unique_ptr<SingleDatacard> > datas_;//!<Data components of the figure
+
+  Datacard(const Datacard &) = delete;
+  Datacard& operator=(const Datacard &) = delete;
+  Datacard() = delete;
+
+  void AddProcesses(const std::vector<std::shared_ptr<Process> > &processes);
+  void CheckScalar(const NamedFunc &func) const;
+  const SingleDatacard * FindComponent(const Process *process) const;
+  void WriteShapes(const std::string &file_name,
+                   const std::vector<const SingleDatacard*> &components,
+                   const Key &key,
+                   double luminosity) const;
+  void WriteCard(const std::string &file_name,
+                 const std::string &shapes_file,
+                 const std::string &signal_shapes_file,
+                 const Key &key,
+                 double luminosity) const;
+};
+
+#endif
@@ -19,6 +19,7 @@
 #include "core/process.hpp"
 #include "core/axis.hpp"
 #include "core/plot_opt.hpp"
+#include "core/bit_mask.hpp"
 
 class EfficiencyPlot final: public Figure{
 public:
@@ -34,6 +35,10 @@ public:
     TH1D raw_numerator_hist_;//!<Histogram storing distribution before stacking and luminosity weighting
 
     void RecordEvent(const Baby &baby) final;
+    std::size_t EstimateBytes() const final;
+    bool CanMerge() const final;
+    void WriteState(std::ostream &out) final;
+    void MergeState(std::istream &in) final;
 
   private:
     SingleEfficiencyPlot() = delete;
@@ -43,7 +48,8 @@ public:
     SingleEfficiencyPlot& operator=(SingleEfficiencyPlot &&) = delete;
 
     NamedFunc proc_and_hist_cut_, numerator_cut_;
-    NamedFunc::VectorType cut_vector_, wgt_vector_, val_vector_, numerator_cut_vector_;
+    BitMask cut_mask_;
+    NamedFunc::VectorType wgt_vector_, val_vector_, numerator_cut_vector_;
   };
 
   EfficiencyPlot(const Axis &xaxis, const NamedFunc &denominator_cut, const NamedFunc &numerator_cut,
@@ -57,6 +63,7 @@ public:
   void Print(double luminosity,
              const std::string &subdir) final;
   std::string GetTag() const final;
+  std::vector<NamedFunc> GetFunctions() const final;
   std::set<const Process*> GetProcesses() const final;
   FigureComponent * GetComponent(const Process *process) final;
 
@@ -0,0 +1,40 @@
+#ifndef H_EVENT_BLOCK
+#define H_EVENT_BLOCK
+
+#include <cstddef>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/named_func.hpp"
+
+class EventBlock{
+public:
+  explicit EventBlock(std::size_t capacity = 1024);
+  EventBlock(const EventBlock &) = default;
+  EventBlock& operator=(const EventBlock &) = default;
+  EventBlock(EventBlock &&) = default;
+  EventBlock& operator=(EventBlock &&) = default;
+  ~EventBlock() = default;
+
+  void AddColumns(const NamedFunc &function);
+  void Append(const Baby &baby);
+  void Clear();
+
+  std::size_t Size() const;
+  std::size_t Capacity() const;
+  bool Full() const;
+  std::size_t NumColumns() const;
+
+  const NamedFunc::VectorType & Column(const std::string &name) const;
+
+private:
+  std::size_t capacity_;//!<Maximum number of events
+  std::size_t size_;//!<Number of events currently stored
+  std::vector<NamedFunc> functions_;//!<Scalar function evaluated for each column
+  std::vector<NamedFunc::VectorType> columns_;//!<Values of each column, capacity_ entries each
+  std::unordered_map<std::string, std::size_t> indices_;//!<Index of each column by function name
+};
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef H_EVENT_CACHE
+#define H_EVENT_CACHE
+
+#include <cstddef>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class Baby;
+
+class EventCache{
+public:
+  class ColumnBase{
+  public:
+    ColumnBase() = default;
+    virtual ~ColumnBase() = default;
+
+    virtual std::size_t Append(const Baby &baby) = 0;
+    virtual std::size_t Size() const = 0;
+    virtual std::size_t Bytes() const = 0;
+
+  private:
+    ColumnBase(const ColumnBase &) = delete;
+    ColumnBase& operator=(const ColumnBase &) = delete;
+    ColumnBase(ColumnBase &&) = delete;
+    ColumnBase& operator=(ColumnBase &&) = delete;
+  };
+
+  template<typename T> class Column;
+
+  using ColumnFactory = std::function<std::unique_ptr<ColumnBase>()>;
+
+  template<typename T>
+  static ColumnFactory Factory(T const & (Baby::*getter)() const);
+
+  explicit EventCache(const std::vector<ColumnFactory> &factories);
+  ~EventCache();
+
+  template<typename T>
+  bool Read(std::size_t icol, T &value);
+
+  bool Start();
+  void SetEntry(long entry);
+  void SetRow(std::size_t row);
+  void EndEntry(Baby &baby, bool keep);
+  void Finish(bool full_pass);
+  void Clear();
+
+  bool Active() const;
+  bool Complete() const;
+  std::size_t NumRows() const;
+  long Entry(std::size_t row) const;
+  std::size_t NumColumns() const;
+  std::size_t Bytes() const;
+
+  static void SetBudget(std::size_t bytes);
+  static std::size_t Budget();
+  static std::size_t TotalBytes();
+
+private:
+  EventCache(const EventCache &) = delete;
+  EventCache& operator=(const EventCache &) = delete;
+  EventCache(EventCache &&) = delete;
+  EventCache& operator=(EventCache &&) = delete;
+
+  void Touch(std::size_t icol);
+  void Release(std::size_t bytes);
+  void DropPartialColumns(bool disable);
+
+  std::vector<ColumnFactory> factories_;//!<Creates the column for each Baby variable
+  std::vector<std::unique_ptr<ColumnBase> > columns_;//!<Cached columns, null until first use
+  std::vector<bool> disabled_;//!<Columns that could not be cached within budget
+  std::vector<std::size_t> used_;//!<Indices of non-null columns_, in order of first use
+  std::vector<long> entries_;//!<TChain entry of each cached row
+  long entry_;//!<Current TChain entry
+  std::size_t row_;//!<Current row (number of rows before current entry while recording)
+  std::size_t bytes_;//!<Memory used by this cache
+  bool active_;//!<True while inside an event loop using the cache
+  bool recording_;//!<True while the list of rows is being built
+  bool complete_;//!<True once all entries of the Baby have been seen
+  bool overflow_;//!<True if the memory budget was exceeded while recording
+
+  static std::atomic<std::size_t> budget_;//!<Maximum memory summed over all caches
+  static std::atomic<std::size_t> total_bytes_;//!<Memory currently used by all caches
+};
+
+template<typename T>
+class EventCache::Column final : public EventCache::ColumnBase{
+public:
+  using Getter = T const & (Baby::*)() const;
+
+  explicit Column(Getter getter):
+    ColumnBase(),
+    getter_(getter),
+    values_(){
+  }
+  ~Column() = default;
+
+  std::size_t Append(const Baby &baby) final{
+    values_.push_back((baby.*getter_)());
+    return sizeof(T);
+  }
+
+  std::size_t Size() const final{
+    return values_.size();
+  }
+
+  std::size_t Bytes() const final{
+    return values_.size()*sizeof(T);
+  }
+
+  bool Get(std::size_t row, T &value) const{
+    value = values_[row];
+    return true;
+  }
+
+private:
+  Getter getter_;//!<Baby accessor used to fill column
+  std::vector<T> values_;//!<Value for each row
+};
+
+template<typename T>
+class EventCache::Column<std::vector<T>*> final : public EventCache::ColumnBase{
+public:
+  using Getter = std::vector<T>* const & (Baby::*)() const;
+
+  explicit Column(Getter getter):
+    ColumnBase(),
+    getter_(getter),
+    values_(),
+    ends_(){
+  }
+  ~Column() = default;
+
+  std::size_t Append(const Baby &baby) final{
+    const std::vector<T> *vec = (baby.*getter_)();
+    std::size_t size = vec == nullptr ? 0 : vec->size();
+    if(vec != nullptr) values_.insert(values_.end(), vec->cbegin(), vec->cend());
+    ends_.push_back(values_.size());
+    return size*sizeof(T)+sizeof(std::size_t);
+  }
+
+  std::size_t Size() const final{
+    return ends_.size();
+  }
+
+  std::size_t Bytes() const final{
+    return values_.size()*sizeof(T)+ends_.size()*sizeof(std::size_t);
+  }
+
+  bool Get(std::size_t row, std::vector<T>* &value) const{
+    if(value == nullptr) return false;
+    std::size_t begin = row == 0 ? 0 : ends_[row-1];
+    value->assign(values_.cbegin()+begin, values_.cbegin()+ends_[row]);
+    return true;
+  }
+
+private:
+  Getter getter_;//!<Baby accessor used to fill column
+  std::vector<T> values_;//!<Elements of all rows, concatenated
+  std::vector<std::size_t> ends_;//!<One past the last element of each row in values_
+};
+
+/*!\brief Get function creating a column filled through a Baby accessor
+
+  \param[in] getter Baby accessor, e.g. &Baby::met
+
+  \return Function creating an empty column of matching type
+*/
+template<typename T>
+EventCache::ColumnFactory EventCache::Factory(T const & (Baby::*getter)() const){
+  return [getter](){
+    return std::unique_ptr<ColumnBase>(new Column<T>(getter));
+  };
+}
+
+/*!\brief Copy cached value of a variable for current row into value
+
+  If the column is not yet cached, it is marked as used so that it is stored at
+  the end of the current entry.
+
+  \param[in] icol Index of variable in Baby::CacheColumns()
+
+  \param[out] value Baby member receiving the cached value
+
+  \return True if value was set from the cache, false if it must be read from
+  disk
+*/
+template<typename T>
+bool EventCache::Read(std::size_t icol, T &value){
+  if(!active_) return false;
+  ColumnBase *column = columns_[icol].get();
+  if(column == nullptr){
+    Touch(icol);
+    return false;
+  }
+  if(column->Size() <= row_) return false;
+  return static_cast<Column<T>*>(column)->Get(row_, value);
+}
+
+#endif
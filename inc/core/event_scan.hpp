@@ -49,6 +49,7 @@ class EventScan final : public Figure{
             const std::string &subdir) final;
 
  std::set<const Process*> GetProcesses() const final;
+ std::vector<NamedFunc> GetFunctions() const final;
 
  FigureComponent * GetComponent(const Process *process) final;
 
@@ -0,0 +1,111 @@
+#ifndef H_FAST_HIST
+#define H_FAST_HIST
+
+#include <cstddef>
+
+#include <algorithm>
+#include <vector>
+
+#include "TH1.h"
+
+class FastHist{
+public:
+  explicit FastHist(const TH1 &hist_template);
+  FastHist(const FastHist &) = default;
+  FastHist& operator=(const FastHist &) = default;
+  FastHist(FastHist &&) = default;
+  FastHist& operator=(FastHist &&) = default;
+  ~FastHist() = default;
+
+  void Fill(double x, double w);
+  void Fill(double x, double y, double w);
+
+  void AddTo(TH1 &hist) const;
+  void FlushTo(TH1 &hist);
+  void Reset();
+
+  bool Empty() const;
+
+private:
+  /*!\brief Binning along one direction, with ROOT's bin numbering
+   */
+  class BinFinder{
+  public:
+    BinFinder();
+    explicit BinFinder(const TAxis &axis);
+
+    int FindBin(double x) const;
+    int NumCells() const;
+
+  private:
+    int nbins_;//!<Number of bins excluding under- and overflow
+    double xmin_;//!<Low edge of first bin
+    double xmax_;//!<High edge of last bin
+    double scale_;//!<Bins per unit of x
+    bool fixed_;//!<Axis has fixed bins, so ROOT computes the bin arithmetically
+    bool regular_;//!<Variable bins that are nearly equally spaced
+    std::vector<double> edges_;//!<Bin edges, empty for fixed bins
+  };
+
+  BinFinder x_;//!<Binning along x
+  BinFinder y_;//!<Binning along y, single cell for 1D histograms
+  int dimension_;//!<Number of dimensions of the histogram
+  std::vector<double> sumw_;//!<Sum of weights per global bin
+  std::vector<double> sumw2_;//!<Sum of squared weights per global bin
+  double stats_[7];//!<In-range sums of w, w^2, wx, wx^2, wy, wy^2, wxy as in TH1::GetStats
+  double entries_;//!<Number of calls to Fill
+};
+
+/*!\brief Bin number of x, matching TAxis::FindBin
+
+  Values below the axis give 0 and values above it or NaN give nbins+1.
+*/
+inline int FastHist::BinFinder::FindBin(double x) const{
+  if(x < xmin_) return 0;
+  if(!(x < xmax_)) return nbins_+1;
+  if(fixed_) return 1 + static_cast<int>(nbins_*(x-xmin_)/(xmax_-xmin_));
+  if(regular_){
+    int bin = std::min(std::max(1 + static_cast<int>((x-xmin_)*scale_), 1), nbins_);
+    while(x < edges_[bin-1]) --bin;
+    while(x >= edges_[bin]) ++bin;
+    return bin;
+  }
+  return std::upper_bound(edges_.cbegin(), edges_.cend(), x) - edges_.cbegin();
+}
+
+/*!\brief Add weight w at x to the 1D histogram
+ */
+inline void FastHist::Fill(double x, double w){
+  int bin = x_.FindBin(x);
+  sumw_[bin] += w;
+  sumw2_[bin] += w*w;
+  ++entries_;
+  if(bin > 0 && bin < x_.NumCells()-1){
+    stats_[0] += w;
+    stats_[1] += w*w;
+    stats_[2] += w*x;
+    stats_[3] += w*x*x;
+  }
+}
+
+/*!\brief Add weight w at (x, y) to the 2D histogram
+ */
+inline void FastHist::Fill(double x, double y, double w){
+  int xbin = x_.FindBin(x);
+  int ybin = y_.FindBin(y);
+  int bin = xbin + x_.NumCells()*ybin;
+  sumw_[bin] += w;
+  sumw2_[bin] += w*w;
+  ++entries_;
+  if(xbin > 0 && xbin < x_.NumCells()-1 && ybin > 0 && ybin < y_.NumCells()-1){
+    stats_[0] += w;
+    stats_[1] += w*w;
+    stats_[2] += w*x;
+    stats_[3] += w*x*x;
+    stats_[4] += w*y;
+    stats_[5] += w*y*y;
+    stats_[6] += w*x*y;
+  }
+}
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef H_FIGURE
 #define H_FIGURE
 
+#include <cstddef>
+
+#include <iosfwd>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -10,6 +13,8 @@
 #include "core/baby.hpp"
 #include "core/named_func.hpp"
 
+class EventBlock;
+
 class Figure{
 public:
   class FigureComponent{
@@ -19,6 +24,14 @@ public:
     virtual ~FigureComponent() = default;
 
     virtual void RecordEvent(const Baby &baby) = 0;
+    virtual void FinishBaby(const Baby &/*baby*/){}
+    virtual bool CanRecordBlock() const{return false;}
+    virtual void RecordBlock(const EventBlock &/*block*/,
+                             const NamedFunc::VectorType &/*pass*/){}
+    virtual std::size_t EstimateBytes() const;
+    virtual bool CanMerge() const{return false;}
+    virtual void WriteState(std::ostream &out);
+    virtual void MergeState(std::istream &in);
 
     const Figure& figure_;//!<Reference to figure containing this component
     std::shared_ptr<Process> process_;//!<Process associated to this part of the figure
@@ -47,6 +60,8 @@ public:
 
   virtual std::string GetTag() const {return "";}
 
+  virtual std::vector<NamedFunc> GetFunctions() const {return {};}
+
   virtual FigureComponent * GetComponent(const Process *process) = 0;
 };
 
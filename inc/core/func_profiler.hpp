@@ -0,0 +1,36 @@
+#ifndef H_FUNC_PROFILER
+#define H_FUNC_PROFILER
+
+#include <cstddef>
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+#include "core/named_func.hpp"
+
+class FuncProfiler{
+public:
+  static void Enable(bool enable = true);
+  static bool Enabled();
+  static void SamplePeriod(unsigned long period);
+  static unsigned long SamplePeriod();
+
+  static std::size_t Register(const std::string &name);
+
+  static std::function<NamedFunc::ScalarFunc> Wrap(std::size_t id,
+                                                   const std::function<NamedFunc::ScalarFunc> &function);
+  static std::function<NamedFunc::VectorFunc> Wrap(std::size_t id,
+                                                   const std::function<NamedFunc::VectorFunc> &function);
+  static std::function<NamedFunc::ElementFunc> Wrap(std::size_t id,
+                                                    const std::function<NamedFunc::ElementFunc> &function);
+
+  static void Reset();
+  static void Report(std::ostream &stream, std::size_t max_lines = 25);
+  static void WriteJson(const std::string &file_name);
+
+private:
+  FuncProfiler() = delete;
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <ostream>
+#include <memory>
+#include <functional>
 
 #include "token.hpp"
 
@@ -27,6 +29,10 @@ public:
   Token ResolveAsToken() const;
   NamedFunc ResolveAsNamedFunc() const;
 
+  static std::shared_ptr<const NamedFunc> Intern(const std::string &function_string);
+  static void ClearCache();
+  static std::size_t CacheSize();
+
 private:
   std::string input_string_;//!<String being parsed
   mutable std::vector<Token> tokens_;//!<List of tokens generated in parsing process
@@ -35,10 +41,14 @@ private:
 
   FunctionParser(const std::vector<Token> &tokens);
 
+  static std::shared_ptr<const NamedFunc> Intern(const std::string &key,
+                                                 const std::function<NamedFunc()> &parse);
+
   void Tokenize() const;
   void CheckForUnknowns() const;
   void ResolveVariables() const;
   void EvaluateGroupings() const;
+  void ApplyFunction(std::size_t i_func, std::size_t i_close) const;
   void MergeParentheses() const;
   void ApplySubscripts() const;
   void DisambiguatePlusMinus() const;
@@ -49,6 +59,7 @@ private:
   void EqualOrNot() const;
   void And() const;
   void Or() const;
+  void Conditional() const;
   void CheckSolved() const;
   void CleanupName() const;
 
@@ -56,6 +67,7 @@ private:
 
   std::size_t FindClose(std::size_t i_open_token) const;
   std::string ConcatenateTokenStrings(std::size_t i_start, std::size_t i_end) const;
+  std::shared_ptr<const NamedFunc> InternRange(std::size_t i_start, std::size_t i_end) const;
   void CondenseTokens(std::size_t i_start, std::size_t i_end, const Token &replacement) const;
 };
 
@@ -0,0 +1,57 @@
+#ifndef H_GEN_TREE
+#define H_GEN_TREE
+
+#include <cstddef>
+#include <cstdint>
+
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+#include "core/baby.hpp"
+
+class GenTree{
+public:
+  static const GenTree & Get(const Baby &baby);
+
+  std::size_t Size() const;
+  int Id(int i) const;
+  int Mother(int i) const;
+  int MotherId(int i) const;
+  const std::vector<int> & Daughters(int i) const;
+  const std::vector<int> & Indices(int id) const;
+
+  bool IsAncestor(int ancestor, int i) const;
+  bool IsDescendantOf(int i, int abs_id) const;
+  int LastCopy(int i) const;
+
+  int First(std::initializer_list<int> ids) const;
+  int First(std::initializer_list<int> ids, int mother_id) const;
+  int Last(std::initializer_list<int> ids) const;
+  int FirstAbs(std::initializer_list<int> abs_ids) const;
+  int FirstAbsFrom(std::initializer_list<int> abs_ids, int ancestor_abs_id) const;
+  const std::vector<int> & DaughtersOf(int abs_id) const;
+
+  ~GenTree() = default;
+
+private:
+  GenTree();
+  GenTree(const GenTree &) = delete;
+  GenTree& operator=(const GenTree &) = delete;
+  GenTree(GenTree &&) = delete;
+  GenTree& operator=(GenTree &&) = delete;
+
+  void Build(const Baby &baby);
+  void BuildAncestors();
+
+  std::size_t event_id_;//!<Baby::EventId() of the event the tree was built for, 0 if never
+  std::size_t num_words_;//!<Number of 64-bit words in the ancestor bitset of each particle
+  std::vector<int> ids_;//!<PDG id of each particle (mc_id)
+  std::vector<int> mothers_;//!<Index of the mother of each particle (mc_momidx), -1 if none or invalid
+  std::vector<int> mother_ids_;//!<PDG id of the mother of each particle (mc_mom)
+  std::vector<std::vector<int> > daughters_;//!<Indices of the daughters of each particle, in increasing order
+  std::vector<std::uint64_t> ancestors_;//!<Bit j of the bitset of particle i is set if j is an ancestor of i
+  std::unordered_map<int, std::vector<int> > indices_;//!<Indices of the particles with each PDG id, in increasing order
+};
+
+#endif
@@ -19,6 +19,8 @@
 #include "core/process.hpp"
 #include "core/axis.hpp"
 #include "core/plot_opt.hpp"
+#include "core/fast_hist.hpp"
+#include "core/bit_mask.hpp"
 
 class Hist1D final: public Figure{
 public:
@@ -31,8 +33,20 @@ public:
 
     TH1D raw_hist_;//!<Histogram storing distribution before stacking and luminosity weighting
     mutable TH1D scaled_hist_;//!<Kludge. Mutable storage of scaled and stacked histogram
+    FastHist fill_hist_;//!<Entries recorded since they were last added to raw_hist_
 
     void RecordEvent(const Baby &baby) final;
+    void RecordPassing(const Baby &baby,
+                       const BitMask *mask);
+    void FinishBaby(const Baby &baby) final;
+    bool CanRecordBlock() const final;
+    void RecordBlock(const EventBlock &block,
+                     const NamedFunc::VectorType &pass) final;
+    void FlushFills();
+    std::size_t EstimateBytes() const final;
+    bool CanMerge() const final;
+    void WriteState(std::ostream &out) final;
+    void MergeState(std::istream &in) final;
 
     double GetMax(double max_bound = std::numeric_limits<double>::infinity(),
                   bool include_error_bar = false,
@@ -49,6 +63,7 @@ public:
     SingleHist1D& operator=(SingleHist1D &&) = delete;
 
     NamedFunc proc_and_hist_cut_;
+    BitMask cut_mask_;
     NamedFunc::VectorType cut_vector_, wgt_vector_, val_vector_;
   };
 
@@ -65,6 +80,7 @@ public:
   std::set<const Process*> GetProcesses() const final;
 
   std::string GetTag() const final;
+  std::vector<NamedFunc> GetFunctions() const final;
   FigureComponent * GetComponent(const Process *process) final;
   std::vector<TH1D> GetBottomPlots(double &the_min, double &the_max) const;
 
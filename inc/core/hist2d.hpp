@@ -24,6 +24,10 @@ public:
     Clustering::Clusterizer clusterizer_;
 
     void RecordEvent(const Baby &baby);
+    std::size_t EstimateBytes() const override;
+    bool CanMerge() const override;
+    void WriteState(std::ostream &out) override;
+    void MergeState(std::istream &in) override;
 
   private:
     SingleHist2D() = delete;
@@ -47,6 +51,7 @@ public:
              const std::string &subdir) override;
 
   std::string GetTag() const final;
+  std::vector<NamedFunc> GetFunctions() const override;
 
   std::set<const Process*> GetProcesses() const override;
 
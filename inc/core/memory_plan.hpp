@@ -0,0 +1,45 @@
+#ifndef H_MEMORY_PLAN
+#define H_MEMORY_PLAN
+
+#include <cstddef>
+
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+class MemoryPlan{
+public:
+  MemoryPlan(const std::vector<std::size_t> &figure_bytes,
+             std::size_t baby_bytes,
+             std::size_t reserved_bytes,
+             std::size_t max_threads,
+             std::size_t budget);
+  MemoryPlan(const MemoryPlan &) = default;
+  MemoryPlan& operator=(const MemoryPlan &) = default;
+  MemoryPlan(MemoryPlan &&) = default;
+  MemoryPlan& operator=(MemoryPlan &&) = default;
+  ~MemoryPlan() = default;
+
+  static std::size_t EstimateBabyBytes(const std::set<std::string> &files);
+
+  std::size_t NumThreads() const;
+  std::size_t FigureBytes() const;
+  bool Fits() const;
+
+  void Print(std::ostream &out) const;
+
+  static const std::size_t chain_overhead_bytes;
+  static const std::size_t unknown_baby_bytes;
+
+private:
+  MemoryPlan() = delete;
+
+  std::vector<std::size_t> figure_bytes_;//!<Estimated memory of each figure
+  std::size_t baby_bytes_;//!<Estimated memory of one open Baby
+  std::size_t reserved_bytes_;//!<Memory set aside for other uses, e.g. the EventCache
+  std::size_t budget_;//!<Memory allowed for everything
+  std::size_t num_threads_;//!<Number of Babies processed at once
+};
+
+#endif
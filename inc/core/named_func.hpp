@@ -1,26 +1,47 @@
 #ifndef H_NAMED_FUNC
 #define H_NAMED_FUNC
 
+#include <cstddef>
+
 #include <string>
 #include <functional>
 #include <ostream>
+#include <type_traits>
 #include <vector>
 
 #include "TString.h"
 
 #include "core/baby.hpp"
 
+class EventBlock;
+class BitMask;
+
 class NamedFunc{
 public:
   using ScalarType = double;
   using VectorType = std::vector<ScalarType>;
   using ScalarFunc = ScalarType(const Baby &);
   using VectorFunc = VectorType(const Baby &);
+  using SizeFunc = std::size_t(const Baby &);
+  using ElementFunc = ScalarType(const Baby &, std::size_t);
+  using BlockFunc = void(const EventBlock &, VectorType &);
+
+  enum class ResultType{boolean, integer, real};
+
+  template<typename T>
+    static constexpr ResultType TypeOf(){
+    return std::is_same<T, bool>::value ? ResultType::boolean
+      : std::is_integral<T>::value ? ResultType::integer
+      : ResultType::real;
+  }
 
   NamedFunc(const std::string &name,
             const std::function<ScalarFunc> &function);
   NamedFunc(const std::string &name,
             const std::function<VectorFunc> &function);
+  NamedFunc(const std::string &name,
+            const std::function<SizeFunc> &size_function,
+            const std::function<ElementFunc> &element_function);
   NamedFunc(const std::string &function);
   NamedFunc(const char *function);
   NamedFunc(const TString &function);
@@ -38,14 +59,35 @@ public:
 
   NamedFunc & Function(const std::function<ScalarFunc> &function);
   NamedFunc & Function(const std::function<VectorFunc> &function);
+  NamedFunc & Function(const std::function<SizeFunc> &size_function,
+                       const std::function<ElementFunc> &element_function,
+                       const std::function<VectorFunc> &vector_function = std::function<VectorFunc>());
   const std::function<ScalarFunc> & ScalarFunction() const;
   const std::function<VectorFunc> & VectorFunction() const;
+  const std::function<SizeFunc> & SizeFunction() const;
+  const std::function<ElementFunc> & ElementFunction() const;
+  NamedFunc & BlockFunction(const std::function<BlockFunc> &block_function,
+                            const std::vector<NamedFunc> &block_columns);
+  const std::function<BlockFunc> & BlockFunction() const;
+  const std::vector<NamedFunc> & BlockColumns() const;
+  NamedFunc & BlockColumn();
 
   bool IsScalar() const;
   bool IsVector() const;
+  bool HasElements() const;
+  bool HasBlock() const;
+
+  bool IsPure() const;
+  NamedFunc & Pure(bool pure);
+  ResultType Type() const;
+  NamedFunc & Type(ResultType type);
+  const std::vector<NamedFunc> & Conjuncts() const;
 
   ScalarType GetScalar(const Baby &b) const;
   VectorType GetVector(const Baby &b) const;
+  void GetVector(const Baby &b, VectorType &result) const;
+  void GetMask(const Baby &b, BitMask &result) const;
+  void GetBlock(const EventBlock &block, VectorType &result) const;
 
   NamedFunc & operator += (const NamedFunc &func);
   NamedFunc & operator -= (const NamedFunc &func);
@@ -56,12 +98,23 @@ public:
   NamedFunc operator [] (const NamedFunc &func) const;
 
 private:
+  friend NamedFunc operator && (NamedFunc f, NamedFunc g);
+
   NamedFunc() = delete;
   std::string name_;//!<String representation of the function
   std::function<ScalarFunc> scalar_func_;//<!Scalar function. Cannot be valid at same time as NamedFunc::vector_func_.
   std::function<VectorFunc> vector_func_;//<!Vector function. Cannot be valid at same time as NamedFunc::scalar_func_.
+  std::function<SizeFunc> size_func_;//<!Optional length of vector result, valid together with NamedFunc::element_func_
+  std::function<ElementFunc> element_func_;//<!Optional access to single element of vector result without building it
+  std::function<BlockFunc> block_func_;//<!Optional evaluation of scalar function for every event of an EventBlock
+  std::vector<NamedFunc> block_columns_;//<!Scalar functions whose values NamedFunc::block_func_ reads from the EventBlock
+  std::vector<NamedFunc> conjuncts_;//<!Operands of a flattened chain of scalar "&&", empty otherwise
+  bool pure_;//<!True if evaluation has no side effects and cannot throw, so it may be reordered
+  ResultType type_;//<!Kind of values returned, which are always stored as ScalarType
 
   void CleanName();
+  void NewChain();
+  void Instrument();
 };
 
 NamedFunc operator + (NamedFunc f, NamedFunc g);
@@ -89,5 +142,6 @@ std::ostream & operator<<(std::ostream &stream, const NamedFunc &function);
 
 bool HavePass(const NamedFunc::VectorType &v);
 bool HavePass(const std::vector<NamedFunc::VectorType> &vv);
+bool HavePass(const BitMask &mask);
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef H_NUMA_TOPOLOGY
+#define H_NUMA_TOPOLOGY
+
+#include <cstddef>
+
+#include <set>
+#include <string>
+#include <vector>
+
+class NumaTopology{
+public:
+  explicit NumaTopology(const std::string &sysfs_dir,
+                        const std::set<int> &allowed_cpus = std::set<int>());
+  NumaTopology(const NumaTopology &) = default;
+  NumaTopology& operator=(const NumaTopology &) = default;
+  NumaTopology(NumaTopology &&) = default;
+  NumaTopology& operator=(NumaTopology &&) = default;
+  ~NumaTopology() = default;
+
+  static const NumaTopology & Get();
+  static std::set<int> AllowedCpus();
+  static std::vector<int> ParseCpuList(const std::string &list);
+
+  std::size_t NumNodes() const;
+  std::size_t NumCpus() const;
+  int NodeId(std::size_t inode) const;
+  const std::vector<int> & Cpus(std::size_t inode) const;
+  int NodeOfCpu(int cpu) const;
+  std::size_t WorkerNode(std::size_t iworker) const;
+
+  static const std::string sysfs_node_dir;
+
+private:
+  NumaTopology() = delete;
+
+  std::vector<int> node_ids_;//!<Number of each node with usable CPUs, as in sysfs
+  std::vector<std::vector<int> > cpus_;//!<Usable CPUs of each node
+  std::vector<std::size_t> worker_nodes_;//!<Node index for each worker index, one per usable CPU, alternating between nodes
+};
+
+#endif
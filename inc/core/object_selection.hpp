@@ -0,0 +1,32 @@
+#ifndef H_OBJECT_SELECTION
+#define H_OBJECT_SELECTION
+
+#include <cstddef>
+
+#include <string>
+#include <vector>
+
+#include "core/named_func.hpp"
+
+class ObjectSelection{
+public:
+  static void Define(const std::string &definition);
+  static void Define(const std::string &name, const NamedFunc &selection);
+
+  static bool Exists(const std::string &name);
+  static std::vector<std::string> Names();
+
+  static NamedFunc Mask(const std::string &name);
+  static NamedFunc Count(const std::string &name);
+  static NamedFunc Leading(const std::string &name);
+  static NamedFunc Sum(const std::string &name, const NamedFunc &value);
+
+  static const std::vector<std::size_t> & Indices(const std::string &name, const Baby &baby);
+
+  static void Reset();
+
+private:
+  ObjectSelection() = delete;
+};
+
+#endif
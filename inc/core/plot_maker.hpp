@@ -1,6 +1,7 @@
 #ifndef H_PLOT_MAKER
 #define H_PLOT_MAKER
 
+#include <string>
 #include <vector>
 #include <set>
 #include <memory>
@@ -8,6 +9,7 @@
 
 #include "core/plot_opt.hpp"
 #include "core/figure.hpp"
+#include "core/run_telemetry.hpp"
 
 class Process;
 
@@ -41,6 +43,8 @@ public:
   }
   void Clear();
 
+  const RunTelemetry & Telemetry() const;
+
   void SetEventVetoData(void * eventVetoData);
 
   bool multithreaded_;
@@ -48,14 +52,36 @@ public:
   bool print_2d_figures_;
   long max_entries_;
   void * event_veto_data_;
+  std::size_t cache_bytes_;//!<Memory budget for in-memory event caches, 0 to read from disk
+  NamedFunc cache_preselection_;//!<Only entries passing this are kept in the event cache
+  bool optimize_cuts_;//!<Reorder terms of "&&" chains by measured pass rate and cost
+  std::string profile_file_;//!<JSON output of FuncProfiler, if enabled. Empty to skip.
+  std::string telemetry_file_;//!<JSON (or CSV if ending in ".csv") output of RunTelemetry. Empty to skip.
+  std::size_t block_size_;//!<Entries per EventBlock for components that can record blocks, 0 to record entry by entry
+  std::size_t memory_budget_;//!<Approximate memory for figures, open babies and the event cache, 0 for no limit
+  bool pin_threads_;//!<Bind worker threads to NUMA nodes in alternation, by default if there are several nodes
+  int shard_;//!<Index of this process among PlotMaker::num_shards_ shards, -1 to process all babies
+  int num_shards_;//!<Number of shards among which the babies are split
+  int merge_shards_;//!<If positive, adds the results of this many shards instead of looping over babies
+  std::string shard_dir_;//!<Directory of the shard result files
 
 private:
   std::vector<std::unique_ptr<Figure> > figures_;//!<Figures to be produced
+  RunTelemetry telemetry_;//!<Measurements of the last event loop
+  std::set<Baby*> shard_babies_;//!<Babies processed by this shard
+  std::size_t num_calls_;//!<Number of PlotMaker::MakePlots calls, used to name shard result files
 
-  void GetYields();
+  std::size_t PlanThreads(std::size_t max_threads) const;
+  void GetYields(std::size_t max_threads);
   long GetYield(Baby *baby_ptr);
 
+  void AssignShardBabies();
+  std::string ShardFile(std::size_t call, int shard) const;
+  void WriteShard(std::size_t call);
+  void MergeShards(std::size_t call);
+
   std::set<Baby*> GetBabies() const;
+  std::set<Baby*> LoopBabies() const;
   std::set<const Process *> GetProcesses() const;
   std::set<Figure::FigureComponent*> GetComponents(const Process *process) const;
 };
@@ -1,11 +1,18 @@
 #ifndef H_PROCESS
 #define H_PROCESS
 
+#include <cstddef>
+
+#include <functional>
 #include <memory>
 #include <string>
 #include <map>
 #include <set>
 #include <mutex>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
 
 #include "core/baby.hpp"
 #include "core/named_func.hpp"
@@ -49,8 +56,19 @@ private:
   Process(Process &&) = delete;
   Process& operator=(Process &&) = delete;
 
-  static std::set<std::unique_ptr<Baby> > baby_pool_;
-  static std::mutex mutex_;
+  //! Dynamic type of a Baby and the real path of its file
+  using BabyKey = std::pair<std::type_index, std::string>;
+
+  struct BabyKeyHash{
+    std::size_t operator()(const BabyKey &key) const{
+      return key.first.hash_code() ^ (std::hash<std::string>()(key.second) << 1);
+    }
+  };
+
+  std::set<Baby*> babies_;//!<Babies reading files of this process
+
+  static std::unordered_map<BabyKey, std::unique_ptr<Baby>, BabyKeyHash> baby_pool_;//!<Babies of all processes
+  static std::mutex mutex_;//!<Protects baby_pool_, babies_ and Baby::processes_
 };
 
 template<typename BabyType>
@@ -70,28 +88,21 @@ Process::Process(BabyType * /*dummy_baby*/,
   name_(name),
   type_(type),
   cut_(cut),
-  color_(color){
+  color_(color),
+  babies_(){
+  const std::set<std::string> full_files = GlobAll(files);
+  const std::type_index baby_type(typeid(BabyType));
   std::lock_guard<std::mutex> lock(mutex_);
-  for(const auto &file: files){
-    const auto &full_files = Glob(file);
-    for(const auto &full_file: full_files){
-      bool found = false;
-      for(auto &baby_p: baby_pool_){
-        auto &baby = *baby_p;
-        if(typeid(baby) != typeid(BabyType)) continue;
-        const auto &baby_files = baby.FileNames();
-        if(baby_files.find(full_file) != baby_files.end()){
-          baby.processes_.insert(this);
-          found = true;
-          break;
-        }
-      }
-      if(!found){
-        baby_pool_.emplace(static_cast<Baby*>(new BabyType(std::set<std::string>{full_file},
-                                                           std::set<const Process*>{this})));
-      }
+  for(const auto &full_file: full_files){
+    auto &baby = baby_pool_[BabyKey(baby_type, full_file)];
+    if(baby == nullptr){
+      baby.reset(new BabyType(std::set<std::string>{full_file},
+                              std::set<const Process*>{this}));
+    }else{
+      baby->processes_.insert(this);
     }
+    babies_.insert(baby.get());
   }
-  }
+}
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef H_RUN_TELEMETRY
+#define H_RUN_TELEMETRY
+
+#include <cstddef>
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class RunTelemetry{
+public:
+  /*!\brief Measurements of the event loop over one Baby
+   */
+  struct BabyRecord{
+    std::string tag_;//!<File name or description of the Baby
+    std::size_t worker_;//!<Index of the thread that processed the Baby
+    int node_;//!<NUMA node the thread was bound to, -1 if not bound
+    double open_seconds_;//!<Time to activate the Baby and count entries
+    double io_seconds_;//!<Time in Baby::GetEntry and the event cache
+    double cut_seconds_;//!<Time evaluating process cuts
+    double fill_seconds_;//!<Time in FigureComponent::RecordEvent
+    double finish_seconds_;//!<Time in FigureComponent::FinishBaby
+    double total_seconds_;//!<Total time spent on the Baby
+    long entries_read_;//!<Number of entries looped over
+    std::vector<std::pair<std::string, long> > entries_passed_;//!<Entries passing each process cut
+    long long bytes_read_;//!<Bytes read from the Baby's files
+    bool cached_;//!<Whether entries were replayed from the event cache
+  };
+
+  RunTelemetry();
+  RunTelemetry(const RunTelemetry &) = default;
+  RunTelemetry& operator=(const RunTelemetry &) = default;
+  RunTelemetry(RunTelemetry &&) = default;
+  RunTelemetry& operator=(RunTelemetry &&) = default;
+  ~RunTelemetry() = default;
+
+  void Clear();
+  void Add(const BabyRecord &record);
+  void Finish(std::size_t num_threads, double seconds);
+
+  const std::vector<BabyRecord> & Records() const;
+  std::size_t NumThreads() const;
+  double Seconds() const;
+  long EntriesRead() const;
+  long long BytesRead() const;
+  long PeakRssKb() const;
+
+  void PrintNodes(std::ostream &stream) const;
+  void WriteJson(std::ostream &stream) const;
+  void WriteCsv(std::ostream &stream) const;
+  void Write(const std::string &file_name) const;
+
+  static long CurrentPeakRssKb();
+
+private:
+  std::vector<BabyRecord> records_;//!<One record per processed Baby, in order of completion
+  std::size_t num_threads_;//!<Number of worker threads used
+  double seconds_;//!<Wall time of the whole event loop
+  long peak_rss_kb_;//!<Peak resident memory of the program when the event loop finished
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef H_SAMPLE_MANIFEST
+#define H_SAMPLE_MANIFEST
+
+#include <cstddef>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class SampleManifest{
+public:
+  class FileInfo{
+  public:
+    std::string name_;//!<File name without directory
+    long long size_;//!<Size in bytes
+    long long mtime_sec_;//!<Modification time, seconds since epoch
+    long mtime_nsec_;//!<Modification time, nanoseconds within the second
+    std::string checksum_;//!<Hex FNV-1a hash of the contents, empty if not computed
+    long entries_;//!<Number of entries in the tree
+    std::vector<long> clusters_;//!<First entry of each cluster of the tree
+    std::map<std::string, std::pair<long long, long long> > branch_bytes_;//!<Compressed and uncompressed bytes of each top-level branch
+
+    long long ZipBytes(const std::set<std::string> &branches = std::set<std::string>()) const;
+    std::vector<std::pair<long, long> > SplitEntries(long max_entries) const;
+  };
+
+  explicit SampleManifest(const std::string &directory);
+  SampleManifest(const SampleManifest &) = default;
+  SampleManifest& operator=(const SampleManifest &) = default;
+  SampleManifest(SampleManifest &&) = default;
+  SampleManifest& operator=(SampleManifest &&) = default;
+  ~SampleManifest() = default;
+
+  static SampleManifest Scan(const std::string &directory,
+                             const std::string &pattern = "*.root",
+                             const std::string &tree_name = "tree",
+                             bool checksums = true);
+  static std::string PathFor(const std::string &directory);
+  static std::shared_ptr<const FileInfo> Lookup(const std::string &file);
+  static long Entries(const std::set<std::string> &files);
+
+  bool Read();
+  void Write() const;
+
+  const std::string & Directory() const;
+  const std::string & TreeName() const;
+  const std::vector<FileInfo> & Files() const;
+  const FileInfo * Find(const std::string &name) const;
+  bool IsCurrent(const FileInfo &info) const;
+  bool VerifyChecksum(const FileInfo &info) const;
+
+  static const std::string file_name;
+
+private:
+  SampleManifest() = delete;
+
+  void Add(const FileInfo &info);
+
+  std::string directory_;//!<Directory described by the manifest
+  std::string tree_name_;//!<Name of the tree scanned in each file
+  std::vector<FileInfo> files_;//!<One entry per file, in order of scanning
+  std::unordered_map<std::string, std::size_t> indices_;//!<Index in files_ of each file name
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef H_SCAN_BANK
+#define H_SCAN_BANK
+
+#include <cstddef>
+
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/figure.hpp"
+#include "core/process.hpp"
+#include "core/axis.hpp"
+#include "core/named_func.hpp"
+#include "core/bit_mask.hpp"
+
+class ScanBank final: public Figure{
+public:
+  using Key = std::vector<NamedFunc::ScalarType>;
+
+  class Point{
+  public:
+    Key key_;//!<Values of the scan key functions
+    std::vector<double> sumw_;//!<Sum of weights in each bin, underflow and overflow included for histograms
+    std::vector<double> sumw2_;//!<Sum of squared weights in each bin
+    long entries_;//!<Number of entries recorded
+    std::size_t last_used_;//!<Event counter value of the last entry recorded, used to pick points to spill
+
+    void Add(const Point &other);
+  };
+
+  class SingleScanBank final: public Figure::FigureComponent{
+  public:
+    SingleScanBank(const ScanBank &scan_bank,
+                   const std::shared_ptr<Process> &process);
+    ~SingleScanBank();
+
+    void RecordEvent(const Baby &baby) final;
+    std::size_t EstimateBytes() const final;
+    bool CanMerge() const final;
+    void WriteState(std::ostream &out) final;
+    void MergeState(std::istream &in) final;
+
+    void ForEachPoint(const std::function<void(const Point &)> &func);
+    std::size_t NumPoints() const;
+    std::size_t NumSpilled() const;
+
+  private:
+    SingleScanBank() = delete;
+    SingleScanBank(const SingleScanBank &) = delete;
+    SingleScanBank& operator=(const SingleScanBank &) = delete;
+    SingleScanBank(SingleScanBank &&) = delete;
+    SingleScanBank& operator=(SingleScanBank &&) = delete;
+
+    struct KeyHash{
+      std::size_t operator()(const Key &key) const;
+    };
+
+    Point & GetPoint(const Key &key);
+    void Fill(Point &point, NamedFunc::ScalarType value, NamedFunc::ScalarType weight);
+    void Spill(bool all);
+    std::string BucketPath(std::size_t ibucket) const;
+
+    NamedFunc proc_and_bank_cut_;//!<Cut of the figure and of the process
+    std::unordered_map<Key, Point, KeyHash> points_;//!<Points held in memory
+    std::size_t point_bytes_;//!<Approximate memory used by one point
+    std::size_t counter_;//!<Number of entries recorded, used to order points by last use
+    std::size_t num_spilled_;//!<Number of point records written to disk
+    std::string spill_dir_;//!<Directory holding the spill files, empty until the first spill
+    std::vector<std::unique_ptr<std::ofstream> > buckets_;//!<Spill files, points assigned by hash of the key
+    Key key_;//!<Key of the current entry (to avoid creating a new vector each event)
+    BitMask cut_mask_;//!<Elements passing a vector cut in the current entry
+    NamedFunc::VectorType wgt_vector_, val_vector_;
+  };
+
+  ScanBank(const std::string &name,
+           const std::vector<NamedFunc> &keys,
+           const Axis &axis,
+           const NamedFunc &cut,
+           const std::vector<std::shared_ptr<Process> > &processes);
+  ScanBank(const std::string &name,
+           const std::vector<NamedFunc> &keys,
+           const NamedFunc &cut,
+           const std::vector<std::shared_ptr<Process> > &processes);
+  ScanBank(ScanBank &&) = default;
+  ScanBank& operator=(ScanBank &&) = default;
+  ~ScanBank() = default;
+
+  void Print(double luminosity,
+             const std::string &subdir) final;
+
+  std::set<const Process*> GetProcesses() const final;
+  std::vector<NamedFunc> GetFunctions() const final;
+  FigureComponent * GetComponent(const Process *process) final;
+
+  std::size_t NumBins() const;
+  void ForEachPoint(const Process *process,
+                    const std::function<void(const Point &)> &func);
+
+  ScanBank & Weight(const NamedFunc &weight);
+  ScanBank & MaxBytes(std::size_t max_bytes);
+  ScanBank & SpillDirectory(const std::string &directory);
+
+  std::string name_;//!<Name of the bank, used for the output file names
+  std::vector<NamedFunc> keys_;//!<Scalar functions identifying the scan point, e.g. mprod and mlsp
+  Axis axis_;//!<Binning of the histogram stored for each point
+  bool is_histogram_;//!<If false, only the total yield is stored for each point
+  NamedFunc cut_;//!<Cut applied before filling
+  NamedFunc weight_;//!<Event weight
+  std::size_t max_bytes_;//!<Approximate bound on the memory used by the points of all processes
+  std::string spill_directory_;//!<Directory in which spill files are created
+
+private:
+  std::vector<std::unique_ptr<SingleScanBank> > banks_;//!<One bank for each process
+
+  ScanBank(const ScanBank &) = delete;
+  ScanBank& operator=(const ScanBank &) = delete;
+  ScanBank() = delete;
+
+  void CheckKeys() const;
+};
+
+#endif
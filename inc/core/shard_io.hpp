@@ -0,0 +1,39 @@
+#ifndef H_SHARD_IO
+#define H_SHARD_IO
+
+#include <cstddef>
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "TH1.h"
+
+#include "core/utilities.hpp"
+
+namespace ShardIO{
+  template<typename T>
+    void Write(std::ostream &out, const T &x){
+    out.write(reinterpret_cast<const char*>(&x), sizeof(T));
+  }
+
+  template<typename T>
+    T Read(std::istream &in){
+    T x;
+    in.read(reinterpret_cast<char*>(&x), sizeof(T));
+    if(!in) ERROR("Shard result is truncated");
+    return x;
+  }
+
+  void WriteString(std::ostream &out, const std::string &s);
+  std::string ReadString(std::istream &in);
+
+  void WriteVector(std::ostream &out, const std::vector<double> &v);
+  void AddVector(std::istream &in, std::vector<double> &v);
+
+  void WriteHist(std::ostream &out, const TH1 &hist);
+  void AddHist(std::istream &in, TH1 &hist);
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef H_SKIM
+#define H_SKIM
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+
+#include "core/figure.hpp"
+#include "core/process.hpp"
+
+class Skim final : public Figure{
+public:
+  class SingleSkim final : public Figure::FigureComponent{
+  public:
+    SingleSkim(const Skim &skim,
+               const std::shared_ptr<Process> &process);
+    ~SingleSkim();
+
+    void RecordEvent(const Baby &baby) final;
+    void FinishBaby(const Baby &baby) final;
+
+    std::string OutputName(const std::string &subdir) const;
+    long NumWritten() const;
+    void Merge(const std::string &subdir);
+
+  private:
+    class Writer{
+    public:
+      Writer(const Skim &skim, const Baby &baby, const std::string &file_name);
+      ~Writer();
+
+      void Fill();
+      void Close();
+
+      std::string file_name_;//!<Temporary file holding this writer's output
+      long num_written_;//!<Number of events written so far
+
+    private:
+      Writer() = delete;
+      Writer(const Writer &) = delete;
+      Writer& operator=(const Writer &) = delete;
+      Writer(Writer &&) = delete;
+      Writer& operator=(Writer &&) = delete;
+
+      void FindBranches();
+
+      const Baby &baby_;//!<Baby whose current entry is copied
+      std::unique_ptr<TFile> file_;//!<Output file
+      TTree *tree_;//!<Output tree, owned by file_
+      std::vector<std::string> branch_names_;//!<Branches copied to output tree
+      std::vector<TBranch*> branches_;//!<Input branch of each of branch_names_ in the current tree of the chain, null if missing
+      int tree_number_;//!<Tree number of the chain for which branches_ were found, -1 before the first entry
+    };
+
+    SingleSkim() = delete;
+    SingleSkim(const SingleSkim &) = delete;
+    SingleSkim& operator=(const SingleSkim &) = delete;
+    SingleSkim(SingleSkim &&) = delete;
+    SingleSkim& operator=(SingleSkim &&) = delete;
+
+    NamedFunc full_cut_;//!<Cached skim&&process cut
+    NamedFunc::VectorType cut_vector_;//!<Cut results (to avoid creating new vector each event)
+    std::map<const Baby*, std::unique_ptr<Writer> > writers_;//!<Open writers, one per Baby in flight
+    std::vector<std::string> parts_;//!<Closed temporary files awaiting merge
+    long num_written_;//!<Events written by closed writers
+  };
+
+  Skim(const std::string &name,
+       const NamedFunc &cut,
+       const std::vector<std::shared_ptr<Process> > &processes,
+       const std::vector<std::string> &branches = {});
+  Skim(Skim &&) = default;
+  Skim& operator=(Skim &&) = default;
+  ~Skim() = default;
+
+  void Print(double luminosity,
+             const std::string &subdir) final;
+
+  std::set<const Process*> GetProcesses() const final;
+  std::string GetTag() const final;
+  std::vector<NamedFunc> GetFunctions() const final;
+
+  FigureComponent * GetComponent(const Process *process) final;
+
+  Skim & Tag(const std::string &tag);
+  Skim & Branches(const std::vector<std::string> &branches);
+  Skim & AddFunctionBranches(const std::vector<NamedFunc> &functions);
+  Skim & Compression(int compression);
+
+  bool UsesFigureBranches() const;
+  const std::set<std::string> & BranchPatterns() const;
+
+  std::string name_;//!<Name of skim for saving to file
+  NamedFunc cut_;//!<Selection of events to write
+  std::string tag_;//!<Tag to identify skim
+  int compression_;//!<ROOT compression settings for output files
+
+private:
+  std::vector<std::unique_ptr<SingleSkim> > skims_;//!<One skim for each process
+  std::set<std::string> branch_patterns_;//!<Branch names/wildcards to copy
+  bool figure_branches_;//!<If true, branch list is filled from subsequent figures
+
+  Skim(const Skim &) = delete;
+  Skim& operator=(const Skim &) = delete;
+  Skim() = delete;
+};
+
+#endif
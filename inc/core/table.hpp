@@ -11,6 +11,7 @@
 #include "core/process.hpp"
 #include "core/gamma_params.hpp"
 #include "core/plot_opt.hpp"
+#include "core/bit_mask.hpp"
 
 class Table final: public Figure{
 public:
@@ -21,6 +22,9 @@ public:
     ~TableColumn() = default;
 
     void RecordEvent(const Baby &baby) final;
+    bool CanMerge() const final;
+    void WriteState(std::ostream &out) final;
+    void MergeState(std::istream &in) final;
 
     std::vector<double> sumw_, sumw2_;
 
@@ -32,7 +36,8 @@ public:
     TableColumn& operator=(TableColumn &&) = delete;
 
     std::vector<NamedFunc> proc_and_table_cut_;
-    NamedFunc::VectorType cut_vector_, wgt_vector_, val_vector_;
+    BitMask cut_mask_;
+    NamedFunc::VectorType wgt_vector_, val_vector_;
   };
 
   Table(const std::string &name,
@@ -57,6 +62,7 @@ public:
   
   std::string GetTag() const final {return tag_;};
   std::set<const Process*> GetProcesses() const final;
+  std::vector<NamedFunc> GetFunctions() const final;
 
   FigureComponent * GetComponent(const Process *process) final;
 
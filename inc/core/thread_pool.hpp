@@ -1,12 +1,15 @@
 #ifndef H_THREAD_POOL
 #define H_THREAD_POOL
 
+#include <cstddef>
+
 #include <algorithm>
 #include <thread>
 #include <future>
 #include <memory>
 #include <functional>
-#include <queue>
+#include <deque>
+#include <exception>
 #include <mutex>
 #include <vector>
 #include <atomic>
@@ -14,62 +17,90 @@
 
 class ThreadPool{
 public:
+  class Latch{
+  public:
+    explicit Latch(std::size_t count = 0);
+    ~Latch() = default;
+
+    void Add(std::size_t count);
+    void CountDown();
+    void Fail(std::exception_ptr error);
+    bool Done() const;
+    void Wait();
+
+  private:
+    Latch(const Latch &) = delete;
+    Latch& operator=(const Latch &) = delete;
+    Latch(Latch &&) = delete;
+    Latch& operator=(Latch &&) = delete;
+
+    std::atomic<std::size_t> count_;//!<Number of outstanding tasks
+    std::exception_ptr error_;//!<First exception thrown by a task
+    std::mutex mutex_;//!<Protects error_ and waiting on cv_
+    std::condition_variable cv_;//!<Notified when count_ reaches 0
+  };
+
   ThreadPool();
-  explicit ThreadPool(std::size_t num_threads);
+  explicit ThreadPool(std::size_t num_threads, bool pin_threads = false);
   ~ThreadPool();
 
   std::size_t Size() const;
   void Resize(size_t num_threads);
+  void PinThreads(bool pin);
+
+  static int CurrentNode();
 
   template<typename FuncType, typename...ArgTypes>
   auto Push(FuncType &&func, ArgTypes&&... args) -> std::future<decltype(func(args...))>;
 
+  void PushRange(std::size_t begin, std::size_t end,
+                 const std::function<void(std::size_t)> &func,
+                 Latch &latch, std::size_t grain = 0);
+  void ParallelFor(std::size_t begin, std::size_t end,
+                   const std::function<void(std::size_t)> &func,
+                   std::size_t grain = 0);
+  void Wait(Latch &latch);
+
 private:
+  using Task = std::function<void()>;
+
+  struct Worker{
+    std::deque<Task> tasks_;//!<Owner takes from the back, thieves from the front
+    std::mutex mutex_;//!<Protects tasks_
+    std::thread thread_;//!<Thread running ThreadPool::DoTasks
+    std::atomic<int> node_{-1};//!<NUMA node the thread is bound to, -1 if not bound
+  };
+
   ThreadPool(const ThreadPool &) = delete;
   ThreadPool& operator=(const ThreadPool &) = delete;
   ThreadPool(ThreadPool &&) = delete;
   ThreadPool& operator=(ThreadPool &&) = delete;
 
-  void DoTasksFromQueue(size_t ithread);
-  bool ReadyToAct(size_t ithread, std::unique_ptr<std::function<void()> > &task);
-
-  class Queue{
-  public:
-    using FuncPtr = std::unique_ptr<std::function<void()> >;
-
-    Queue() = default;
-    ~Queue() = default;
-
-    void Push(FuncPtr &func);
-    FuncPtr Pop();
-
-  private:
-    Queue(const Queue &) = delete;
-    Queue& operator=(const Queue &) = delete;
-    Queue(Queue &&) = delete;
-    Queue& operator=(Queue &&) = delete;
-
-    std::queue<FuncPtr> queue_;
-    std::mutex mutex_;
-  };
+  void Enqueue(Task &&task);
+  void Enqueue(std::vector<Task> &tasks);
+  bool TakeTask(Task &task);
+  void DoTasks(std::size_t ithread);
+  void StartThreads();
+  void StopThreads();
+  void ApplyAffinity();
+  void BindWorker(std::size_t ithread, bool self);
 
-  Queue tasks_;
-  std::vector<std::unique_ptr<std::thread> > threads_;
-  std::vector<std::shared_ptr<std::atomic<bool> > > stop_thread_now_;
-  std::atomic<bool> stop_at_empty_;
+  std::vector<std::unique_ptr<Worker> > workers_;//!<One deque and thread per worker
+  std::atomic<std::size_t> queued_;//!<Number of tasks in all deques
+  std::atomic<std::size_t> next_worker_;//!<Deque receiving the next task pushed from outside the pool
+  std::atomic<bool> stop_at_empty_;//!<Workers exit once no task is left
+  std::atomic<bool> pin_threads_;//!<Bind each worker to the CPUs of the node given by NumaTopology::WorkerNode
 
-  std::mutex mutex_;
-  std::condition_variable cv_;
+  std::mutex mutex_;//!<Protects waiting on cv_
+  std::condition_variable cv_;//!<Notified when tasks are queued or workers must stop
 };
 
 template<typename FuncType, typename...ArgTypes>
 auto ThreadPool::Push(FuncType &&func, ArgTypes&&... args) -> std::future<decltype(func(args...))>{
   auto task =  std::make_shared<std::packaged_task<decltype(func(args...))()> >(std::bind(std::forward<FuncType>(func), std::forward<ArgTypes>(args)...));
-  std::unique_ptr<std::function<void()> > pkg_func(new std::function<void()>([task](){(*task)();}));
-  tasks_.Push(pkg_func);
-  std::lock_guard<std::mutex> lock(mutex_);
-  cv_.notify_one();
-  return task->get_future();
+  auto result = task->get_future();
+  Enqueue([task](){(*task)();});
+  return result;
 }
 
 #endif
@@ -16,7 +16,9 @@ struct Token{
       logical_and, logical_or, logical_not, //19-21
       open_paren, close_paren, //22-23
       open_square, close_square, //24-25
-      unknown};//26
+      function_name, comma, //26-27
+      question, colon, //28-29
+      unknown};//30
 
   Token(const std::string &function_string="", Type type = Type::unknown);
   Token(const NamedFunc &function);
@@ -27,6 +27,7 @@ namespace Multithreading{
 }
 
 std::set<std::string> Glob(const std::string &pattern);
+std::set<std::string> GlobAll(const std::set<std::string> &patterns);
 std::string Basename(const std::string &filename);
 
 bool Contains(const std::string &str, const std::string &pat);
@@ -0,0 +1,21 @@
+#ifndef H_VECTOR_ARENA
+#define H_VECTOR_ARENA
+
+#include <cstddef>
+
+#include "core/named_func.hpp"
+
+class VectorArena{
+public:
+  static NamedFunc::VectorType Get(std::size_t size);
+  static void Recycle(NamedFunc::VectorType &vec);
+  static void Reset();
+
+  static std::size_t NumFree();
+  static long NumAllocations();
+
+private:
+  VectorArena() = delete;
+};
+
+#endif
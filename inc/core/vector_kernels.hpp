@@ -0,0 +1,39 @@
+#ifndef H_VECTOR_KERNELS
+#define H_VECTOR_KERNELS
+
+#include <cstddef>
+
+#include <functional>
+#include <string>
+
+namespace VectorKernels{
+  enum class Operation{none,
+      plus, minus, multiplies, divides,
+      equal_to, not_equal_to, greater, less, greater_equal, less_equal,
+      logical_and, logical_or};
+
+  template<typename Operator>
+    struct OperationOf{
+      static constexpr Operation value = Operation::none;
+    };
+  template<> struct OperationOf<std::plus<double> >{static constexpr Operation value = Operation::plus;};
+  template<> struct OperationOf<std::minus<double> >{static constexpr Operation value = Operation::minus;};
+  template<> struct OperationOf<std::multiplies<double> >{static constexpr Operation value = Operation::multiplies;};
+  template<> struct OperationOf<std::divides<double> >{static constexpr Operation value = Operation::divides;};
+  template<> struct OperationOf<std::equal_to<double> >{static constexpr Operation value = Operation::equal_to;};
+  template<> struct OperationOf<std::not_equal_to<double> >{static constexpr Operation value = Operation::not_equal_to;};
+  template<> struct OperationOf<std::greater<double> >{static constexpr Operation value = Operation::greater;};
+  template<> struct OperationOf<std::less<double> >{static constexpr Operation value = Operation::less;};
+  template<> struct OperationOf<std::greater_equal<double> >{static constexpr Operation value = Operation::greater_equal;};
+  template<> struct OperationOf<std::less_equal<double> >{static constexpr Operation value = Operation::less_equal;};
+  template<> struct OperationOf<std::logical_and<double> >{static constexpr Operation value = Operation::logical_and;};
+  template<> struct OperationOf<std::logical_or<double> >{static constexpr Operation value = Operation::logical_or;};
+
+  void Apply(Operation op, const double *a, const double *b, double *out, std::size_t n);
+  void Apply(Operation op, const double *a, double b, double *out, std::size_t n);
+  void Apply(Operation op, double a, const double *b, double *out, std::size_t n);
+
+  std::string InstructionSet();
+}
+
+#endif
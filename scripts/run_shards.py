@@ -0,0 +1,71 @@
+#!/bin/env python
+import os
+import sys
+import argparse
+import subprocess
+from time import time
+
+# Runs a program using PlotMaker in several processes, each looping over a
+# share of the babies, and then once more to merge their results and print
+# the plots and tables. With --submit, the shard commands are only printed,
+# one per line, to be sent as batch jobs; run again with --merge_only when
+# they are done.
+
+def shardEnvironment(shard, num_shards, shard_dir):
+  env = dict(os.environ)
+  env['DRAW_PICO_SHARD'] = str(shard)+'/'+str(num_shards)
+  env['DRAW_PICO_SHARD_DIR'] = shard_dir
+  env.pop('DRAW_PICO_MERGE', None)
+  return env
+
+if __name__ == '__main__':
+  t0 = time()
+
+  parser = argparse.ArgumentParser(description='Runs a PlotMaker program in shards and merges the results.')
+  parser.add_argument('-n', '--num_shards', type=int, default=4, help='Number of shards')
+  parser.add_argument('-d', '--shard_dir', default='shards', help='Directory of the shard result files')
+  parser.add_argument('-l', '--log_dir', default='', help='Directory for the output of each shard, default is the shard directory')
+  parser.add_argument('--submit', action='store_true', help='Only print the shard commands')
+  parser.add_argument('--merge_only', action='store_true', help='Only merge the results of shards already run')
+  parser.add_argument('command', nargs=argparse.REMAINDER, help='Program and its arguments')
+  args = parser.parse_args()
+  if len(args.command) == 0:
+    parser.error('no command given')
+  command = ' '.join(args.command)
+  if args.submit:
+    for shard in range(args.num_shards):
+      print('DRAW_PICO_SHARD='+str(shard)+'/'+str(args.num_shards)+' DRAW_PICO_SHARD_DIR='+args.shard_dir+' '+command)
+    sys.exit(0)
+
+  if not args.merge_only:
+    log_dir = args.log_dir if args.log_dir != '' else args.shard_dir
+    if not os.path.isdir(log_dir):
+      os.makedirs(log_dir)
+    processes = []
+    for shard in range(args.num_shards):
+      log_name = os.path.join(log_dir, 'shard_'+str(shard)+'.log')
+      log = open(log_name, 'w')
+      print('Starting shard '+str(shard)+' of '+str(args.num_shards)+', output in '+log_name)
+      process = subprocess.Popen(command, stdout=log, stderr=subprocess.STDOUT, shell=True,
+                                 env=shardEnvironment(shard, args.num_shards, args.shard_dir))
+      processes.append((shard, process, log, log_name))
+
+    failed = []
+    for shard, process, log, log_name in processes:
+      process.wait()
+      log.close()
+      if process.returncode != 0:
+        failed.append(log_name)
+    if len(failed) > 0:
+      print('Shards failed, see '+', '.join(failed))
+      sys.exit(1)
+    print('All '+str(args.num_shards)+' shards finished after %.0fm %.0fs.' % ((time()-t0)//60,(time()-t0)%60))
+
+  env = dict(os.environ)
+  env['DRAW_PICO_MERGE'] = str(args.num_shards)
+  env['DRAW_PICO_SHARD_DIR'] = args.shard_dir
+  env.pop('DRAW_PICO_SHARD', None)
+  returncode = subprocess.call(command, shell=True, env=env)
+
+  print('\nProgram took %.0fm %.0fs.' % ((time()-t0)//60,(time()-t0)%60))
+  sys.exit(returncode)
@@ -0,0 +1,311 @@
+/*! \file bench_core.cxx
+
+  \brief Microbenchmarks of the core hot paths
+
+  Times FunctionParser parsing, NamedFunc evaluation of scalar, vector, vector
+  cut and subscript expressions, VectorKernels loops, Baby::GetEntry followed
+  by accessors, Hist1D::SingleHist1D::RecordEvent, Clusterizer clustering at
+  several numbers of points, ThreadPool::Push and ThreadPool::ParallelFor with
+  one index per task, and GammaParams arithmetic on fixed inputs. Each
+  benchmark is run for a number of samples after a warm-up sample, and the
+  mean and standard deviation of ns/op over the samples are reported, as a
+  table and optionally as JSON.
+
+  Benchmarks reading a Baby use a file written by generate_pico.exe and are
+  skipped if it does not exist.
+
+  Usage: bench_core.exe [--input FILE] [--samples N] [--filter SUBSTRING]
+                        [--output FILE]
+*/
+#include "core/test.hpp"
+
+#include <cmath>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include "TError.h"
+#include "TH2D.h"
+
+#include "core/baby.hpp"
+#include "core/baby_pico.hpp"
+#include "core/process.hpp"
+#include "core/named_func.hpp"
+#include "core/function_parser.hpp"
+#include "core/hist1d.hpp"
+#include "core/clusterizer.hpp"
+#include "core/thread_pool.hpp"
+#include "core/gamma_params.hpp"
+#include "core/vector_kernels.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  string input_file = "synthetic/pico_synthetic_0.root";
+  string output_file = "";
+  string filter = "";
+  int num_samples = 10;
+
+  volatile double sink = 0.;//!<Consumes results so they are not optimized away
+
+  /*!\brief Timing of one benchmark
+   */
+  struct Result{
+    string name_;//!<Benchmark name
+    long ops_;//!<Operations per sample
+    double mean_ns_;//!<Mean time per operation over samples
+    double stddev_ns_;//!<Standard deviation of time per operation over samples
+  };
+
+  vector<Result> results;
+
+  /*!\brief Time run(ops) num_samples times after one warm-up call
+
+    \param[in] name Benchmark name
+
+    \param[in] ops Number of operations performed by each call to run
+
+    \param[in] run Function performing ops operations
+  */
+  void Measure(const string &name, long ops, const function<void(long)> &run){
+    if(filter != "" && !Contains(name, filter)) return;
+    using Clock = chrono::steady_clock;
+    run(ops);
+    vector<double> ns_per_op;
+    for(int isample = 0; isample < num_samples; ++isample){
+      auto start = Clock::now();
+      run(ops);
+      ns_per_op.push_back(chrono::duration<double, nano>(Clock::now()-start).count()/ops);
+    }
+    double mean = 0., var = 0.;
+    for(const auto &x: ns_per_op) mean += x;
+    mean /= ns_per_op.size();
+    for(const auto &x: ns_per_op) var += (x-mean)*(x-mean);
+    var = ns_per_op.size() > 1 ? var/(ns_per_op.size()-1) : 0.;
+    results.push_back(Result{name, ops, mean, sqrt(var)});
+    cout << setw(50) << left << name << right
+         << setw(14) << RoundNumber(mean, 1) << " +- " << setw(10) << left << RoundNumber(sqrt(var), 1)
+         << right << " ns/op" << endl;
+  }
+
+  const vector<string> expressions = {
+    "met>100",
+    "nll>=1 && nphoton>=1 && ll_m[0]>50 && photon_pt[0]>15",
+    "Sum$(photon_pt>15 && photon_sig)>=1 ? llphoton_m[0] : -1"
+  };
+
+  void BenchParsing(){
+    for(size_t i = 0; i < expressions.size(); ++i){
+      const string &expr = expressions.at(i);
+      Measure("FunctionParser/"+to_string(i), 200, [&expr](long ops){
+          for(long op = 0; op < ops; ++op){
+            sink = sink + FunctionParser(expr).ResolveAsNamedFunc().IsScalar();
+          }
+        });
+      Measure("NamedFunc(string) interned/"+to_string(i), 20000, [&expr](long ops){
+          for(long op = 0; op < ops; ++op){
+            sink = sink + NamedFunc(expr).IsScalar();
+          }
+        });
+    }
+  }
+
+  void BenchBaby(){
+    struct stat buffer;
+    if(stat(input_file.c_str(), &buffer) != 0){
+      cout << "Skipping Baby benchmarks: " << input_file << " not found. Run generate_pico.exe first." << endl;
+      return;
+    }
+    auto proc = Process::MakeShared<Baby_pico>("bench", Process::Type::background, 1, {input_file}, "1");
+    Baby_pico baby(set<string>{input_file}, set<const Process*>{proc.get()});
+    auto activator = baby.Activate();
+    long num_entries = baby.GetEntries();
+    if(num_entries == 0) return;
+
+    Measure("Baby::GetEntry+accessors", 10000, [&baby, num_entries](long ops){
+        for(long op = 0; op < ops; ++op){
+          baby.GetEntry(op%num_entries);
+          sink = sink + baby.met() + baby.nphoton() + baby.photon_pt()->size();
+        }
+      });
+
+    baby.GetEntry(0);
+    NamedFunc scalar = "met>100 && njet>=2";
+    NamedFunc vector_func = "photon_pt*2";
+    NamedFunc subscript = "ll_m[0]>80";
+    NamedFunc reduction = "Sum$(photon_pt>15 && photon_sig)";
+    NamedFunc vector_cut = "photon_pt>15";
+    Measure("NamedFunc scalar", 100000, [&](long ops){
+        for(long op = 0; op < ops; ++op) sink = sink + scalar.GetScalar(baby);
+      });
+    Measure("NamedFunc vector", 100000, [&](long ops){
+        for(long op = 0; op < ops; ++op) sink = sink + vector_func.GetVector(baby).size();
+      });
+    Measure("NamedFunc vector cut", 100000, [&](long ops){
+        for(long op = 0; op < ops; ++op) sink = sink + vector_cut.GetVector(baby).size();
+      });
+    Measure("NamedFunc subscript", 100000, [&](long ops){
+        for(long op = 0; op < ops; ++op){
+          if(baby.nll() > 0) sink = sink + subscript.GetScalar(baby);
+        }
+      });
+    Measure("NamedFunc reduction", 100000, [&](long ops){
+        for(long op = 0; op < ops; ++op) sink = sink + reduction.GetScalar(baby);
+      });
+
+    Hist1D hist(Axis(40, 0., 200., "photon_pt", "p_{T}^{#gamma} [GeV]"),
+                "nphoton>=1", vector<shared_ptr<Process> >{proc});
+    hist.Weight("weight");
+    Figure::FigureComponent *component = hist.GetComponent(proc.get());
+    Measure("Hist1D::SingleHist1D::RecordEvent", 10000, [&](long ops){
+        for(long op = 0; op < ops; ++op){
+          baby.GetEntry(op%num_entries);
+          component->RecordEvent(baby);
+        }
+      });
+  }
+
+  void BenchClusterizer(){
+    TH2D hist_template("", "", 20, 0., 1., 20, 0., 1.);
+    for(const long num_points: {1000l, 4000l, 16000l}){
+      mt19937 gen(1);
+      uniform_real_distribution<float> uniform(0., 1.);
+      vector<Clustering::Point> points;
+      for(long i = 0; i < num_points; ++i){
+        points.emplace_back(uniform(gen), uniform(gen), 1.);
+      }
+      Measure("Clusterizer/"+to_string(num_points)+" points", 1, [&](long ops){
+          for(long op = 0; op < ops; ++op){
+            Clustering::Clusterizer clusterizer(hist_template, 500);
+            clusterizer.SetPoints(points);
+            sink = sink + clusterizer.GetGraph(1.).GetN();
+          }
+        });
+    }
+  }
+
+  void BenchThreadPool(){
+    ThreadPool pool(4);
+    Measure("ThreadPool::Push+get", 20000, [&pool](long ops){
+        vector<future<long> > futures;
+        futures.reserve(ops);
+        for(long op = 0; op < ops; ++op){
+          futures.push_back(pool.Push([](long x){return x;}, op));
+        }
+        for(auto &f: futures) sink = sink + f.get();
+      });
+    Measure("ThreadPool::ParallelFor/1", 20000, [&pool](long ops){
+        atomic<long> total(0);
+        pool.ParallelFor(0, static_cast<size_t>(ops), [&total](size_t i){total += i;}, 1);
+        sink = sink + total;
+      });
+  }
+
+  void BenchVectorKernels(){
+    cout << "VectorKernels instruction set: " << VectorKernels::InstructionSet() << endl;
+    for(size_t size: {4, 16, 256}){
+      vector<double> values(size), result(size);
+      for(size_t i = 0; i < size; ++i) values.at(i) = 10.*i;
+      Measure("VectorKernels::Apply >/"+to_string(size), 1000000/size, [&values, &result](long ops){
+          for(long op = 0; op < ops; ++op){
+            VectorKernels::Apply(VectorKernels::Operation::greater, values.data(), 15., result.data(), values.size());
+            sink = sink + result.back();
+          }
+        });
+    }
+  }
+
+  void BenchGammaParams(){
+    Measure("GammaParams +=, *", 1000000, [](long ops){
+        GammaParams total;
+        GammaParams event(1., 0.5);
+        for(long op = 0; op < ops; ++op){
+          total += 1.0001*event;
+        }
+        sink = sink + total.Yield();
+      });
+  }
+
+  void WriteJson(){
+    ofstream out(output_file);
+    out << "{\"benchmark\": \"bench_core\", \"samples\": " << num_samples
+        << ", \"instruction_set\": \"" << VectorKernels::InstructionSet() << "\", \"results\": [";
+    for(size_t i = 0; i < results.size(); ++i){
+      const Result &r = results.at(i);
+      out << (i == 0 ? "\n" : ",\n")
+          << "  {\"name\": \"" << r.name_ << "\", \"ops\": " << r.ops_
+          << ", \"ns_per_op\": " << r.mean_ns_ << ", \"stddev_ns\": " << r.stddev_ns_ << "}";
+    }
+    out << "\n]}" << endl;
+    cout << "Wrote " << output_file << endl;
+  }
+}
+
+int main(int argc, char *argv[]){
+  gErrorIgnoreLevel = 6000;
+  GetOptions(argc, argv);
+
+  BenchParsing();
+  BenchVectorKernels();
+  BenchBaby();
+  BenchClusterizer();
+  BenchThreadPool();
+  BenchGammaParams();
+
+  if(output_file != "") WriteJson();
+}
+
+void GetOptions(int argc, char *argv[]){
+  while(true){
+    static struct option long_options[] = {
+      {"input", required_argument, 0, 'i'},
+      {"samples", required_argument, 0, 'n'},
+      {"filter", required_argument, 0, 'f'},
+      {"output", required_argument, 0, 'o'},
+      {0, 0, 0, 0}
+    };
+
+    char opt = -1;
+    int option_index;
+    opt = getopt_long(argc, argv, "i:n:f:o:", long_options, &option_index);
+
+    if( opt == -1) break;
+
+    string optname;
+    switch(opt){
+    case 'i':
+      input_file = optarg;
+      break;
+    case 'n':
+      num_samples = max(atoi(optarg), 1);
+      break;
+    case 'f':
+      filter = optarg;
+      break;
+    case 'o':
+      output_file = optarg;
+      break;
+    case 0:
+      optname = long_options[option_index].name;
+      printf("Bad option! Found option name %s\n", optname.c_str());
+      break;
+    default:
+      printf("Bad option! getopt_long returned character code 0%o\n", opt);
+      break;
+    }
+  }
+}
@@ -0,0 +1,265 @@
+/*! \file bench_plotmaker.cxx
+
+  \brief End-to-end throughput benchmark of PlotMaker on synthetic picos
+
+  Runs a fixed, representative set of figures (Hist1D, a Table cutflow, Hist2D,
+  EfficiencyPlot and EventScan) over the files written by generate_pico.exe,
+  split into three processes by "type", and reports events per second, bytes
+  read from disk and peak resident memory as JSON on stdout and in the output
+  file, so that performance changes can be compared on any machine. On
+  machines with several NUMA nodes, the entries per second of each node in
+  the last pass are included; --no_pin leaves thread placement to the OS for
+  comparison. Each pass fills newly built figures. Rates use the entries read
+  and the event loop time according to the run telemetry, so they exclude
+  printing the plots and count what --max_entries, which limits each Baby,
+  actually let through.
+
+  Usage: bench_plotmaker.exe [--input_dir DIR] [--output FILE] [--repeat N]
+                             [--cache_mb N] [--block_size N] [--max_entries N]
+                             [--memory_mb N] [--single_thread] [--no_pin]
+*/
+#include "core/test.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/resource.h>
+
+#include "TChain.h"
+#include "TError.h"
+#include "TFile.h"
+
+#include "core/baby.hpp"
+#include "core/baby_pico.hpp"
+#include "core/process.hpp"
+#include "core/named_func.hpp"
+#include "core/plot_maker.hpp"
+#include "core/plot_opt.hpp"
+#include "core/table.hpp"
+#include "core/event_scan.hpp"
+#include "core/efficiency_plot.hpp"
+#include "core/hist1d.hpp"
+#include "core/hist2d.hpp"
+#include "core/numa_topology.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+using namespace PlotOptTypes;
+
+namespace{
+  string input_dir = "synthetic";
+  string output_file = "bench_plotmaker.json";
+  int num_repeats = 1;
+  size_t cache_mb = 0;
+  size_t block_size = 0;
+  size_t memory_mb = 0;
+  long max_entries = -1;
+  bool single_thread = false;
+  bool no_pin = false;
+
+  void AddFigures(PlotMaker &pm, const vector<shared_ptr<Process> > &procs){
+    PlotOpt lin_shapes("txt/plot_styles.txt", "CMSPaper");
+    lin_shapes.Title(TitleType::info)
+      .Bottom(BottomType::off)
+      .YAxis(YAxisType::linear)
+      .Stack(StackType::shapes);
+    vector<PlotOpt> plot_types = {lin_shapes};
+    PlotOpt style2d("txt/plot_styles.txt", "Scatter");
+    vector<PlotOpt> plot_types_2d = {style2d().Stack(StackType::signal_overlay).Title(TitleType::info)};
+
+    NamedFunc baseline = "nll>=1 && nphoton>=1 && ll_m[0]>50";
+    NamedFunc selection = baseline && "photon_pt[0]>15 && llphoton_m[0]>100 && llphoton_m[0]<180";
+
+    pm.Push<Hist1D>(Axis(40, 100., 180., "llphoton_m[0]", "m_{ll#gamma} [GeV]", {120., 130.}),
+                    selection, procs, plot_types).Weight("weight");
+    pm.Push<Hist1D>(Axis(40, 50., 130., "ll_m[0]", "m_{ll} [GeV]", {80., 100.}),
+                    baseline, procs, plot_types).Weight("weight");
+    pm.Push<Hist1D>(Axis(40, 0., 200., "photon_pt", "p_{T}^{#gamma} [GeV]"),
+                    baseline && "photon_sig", procs, plot_types);
+    pm.Push<Hist1D>(Axis(40, 0., 400., "met", "p_{T}^{miss} [GeV]"),
+                    "1", procs, plot_types).Weight("w_lumi*w_pu");
+    pm.Push<Hist1D>(Axis(10, -0.5, 9.5, "njet", "N_{jets}"),
+                    selection, procs, plot_types);
+
+    pm.Push<Table>("bench_cutflow", vector<TableRow>{
+        TableRow("No selection", "1"),
+          TableRow("$N_{\\ell\\ell}\\geq1$", "nll>=1"),
+          TableRow("$N_{\\gamma}\\geq1$", "nll>=1 && nphoton>=1"),
+          TableRow("$m_{\\ell\\ell}>50$", baseline),
+          TableRow("Full selection", selection)
+          }, procs, false);
+
+    pm.Push<Hist2D>(Axis(30, 0., 150., "photon_pt[0]", "p_{T}^{#gamma} [GeV]"),
+                    Axis(30, 100., 180., "llphoton_m[0]", "m_{ll#gamma} [GeV]"),
+                    baseline, procs, plot_types_2d);
+
+    pm.Push<EfficiencyPlot>(Axis(20, 0., 200., "photon_pt[0]", "p_{T}^{#gamma} [GeV]"),
+                            baseline, "photon_id[0]", procs, false, plot_types);
+
+    pm.Push<EventScan>("bench_scan", selection && "llphoton_m[0]>124 && llphoton_m[0]<126",
+                       vector<NamedFunc>{"run", "event", "ll_m[0]", "llphoton_m[0]", "photon_pt[0]"},
+                       procs);
+  }
+
+  long PeakRssKb(){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+}
+
+int main(int argc, char *argv[]){
+  gErrorIgnoreLevel = 6000;
+  GetOptions(argc, argv);
+
+  set<string> files = {input_dir+"/*.root"};
+  TChain chain("tree");
+  chain.Add((input_dir+"/*.root").c_str());
+  long num_events = chain.GetEntries();
+  int num_files = chain.GetListOfFiles()->GetEntries();
+  if(num_events == 0) ERROR("No events found in "+input_dir+". Run generate_pico.exe first.");
+
+  vector<shared_ptr<Process> > procs = {
+    Process::MakeShared<Baby_pico>("Background 1", Process::Type::background, kAzure+1, files, "type==1000"),
+    Process::MakeShared<Baby_pico>("Background 2", Process::Type::background, kOrange+1, files, "type==2000"),
+    Process::MakeShared<Baby_pico>("Signal", Process::Type::signal, kRed, files, "type==3000")
+  };
+
+  PlotMaker pm;
+  pm.min_print_ = true;
+  pm.multithreaded_ = !single_thread;
+  pm.max_entries_ = max_entries;
+  pm.cache_bytes_ = cache_mb << 20;
+  pm.block_size_ = block_size;
+  pm.memory_budget_ = memory_mb << 20;
+  if(no_pin) pm.pin_threads_ = false;
+
+  using Clock = chrono::steady_clock;
+  vector<double> pass_seconds, loop_seconds;
+  vector<long> pass_entries;
+  Long64_t bytes_before = TFile::GetFileBytesRead();
+  for(int irepeat = 0; irepeat < num_repeats; ++irepeat){
+    pm.Clear();
+    AddFigures(pm, procs);
+    auto start_time = Clock::now();
+    pm.MakePlots(1.);
+    pass_seconds.push_back(chrono::duration<double>(Clock::now()-start_time).count());
+    loop_seconds.push_back(pm.Telemetry().Seconds());
+    pass_entries.push_back(pm.Telemetry().EntriesRead());
+  }
+  Long64_t bytes_read = TFile::GetFileBytesRead()-bytes_before;
+
+  double total_seconds = 0., total_loop_seconds = 0.;
+  for(const auto &seconds: pass_seconds) total_seconds += seconds;
+  for(const auto &seconds: loop_seconds) total_loop_seconds += seconds;
+  long total_entries = 0;
+  for(const auto &entries: pass_entries) total_entries += entries;
+
+  map<int, long> node_entries;
+  for(const auto &record: pm.Telemetry().Records()) node_entries[record.node_] += record.entries_read_;
+
+  ostringstream json;
+  json << "{\"benchmark\": \"bench_plotmaker\""
+       << ", \"files\": " << num_files
+       << ", \"events\": " << num_events
+       << ", \"max_entries\": " << max_entries
+       << ", \"threads\": " << pm.Telemetry().NumThreads()
+       << ", \"numa_nodes\": " << NumaTopology::Get().NumNodes()
+       << ", \"pinned\": " << (pm.pin_threads_ && !single_thread ? "true" : "false")
+       << ", \"figures\": " << pm.Figures().size()
+       << ", \"cache_mb\": " << cache_mb
+       << ", \"block_size\": " << block_size
+       << ", \"memory_mb\": " << memory_mb
+       << ", \"passes\": [";
+  for(size_t i = 0; i < pass_seconds.size(); ++i){
+    json << (i == 0 ? "" : ", ")
+         << "{\"seconds\": " << pass_seconds.at(i)
+         << ", \"loop_seconds\": " << loop_seconds.at(i)
+         << ", \"entries_read\": " << pass_entries.at(i)
+         << ", \"events_per_second\": " << pass_entries.at(i)/loop_seconds.at(i) << "}";
+  }
+  json << "], \"seconds\": " << total_seconds
+       << ", \"loop_seconds\": " << total_loop_seconds
+       << ", \"events_per_second\": " << total_entries/total_loop_seconds
+       << ", \"bytes_read\": " << bytes_read
+       << ", \"peak_rss_kb\": " << PeakRssKb()
+       << ", \"nodes\": [";
+  for(auto node = node_entries.cbegin(); node != node_entries.cend(); ++node){
+    json << (node == node_entries.cbegin() ? "" : ", ")
+         << "{\"node\": " << node->first
+         << ", \"events_per_second\": " << node->second/loop_seconds.back() << "}";
+  }
+  json << "]}";
+
+  cout << json.str() << endl;
+  ofstream out(output_file);
+  out << json.str() << endl;
+}
+
+void GetOptions(int argc, char *argv[]){
+  while(true){
+    static struct option long_options[] = {
+      {"input_dir", required_argument, 0, 'i'},
+      {"output", required_argument, 0, 'o'},
+      {"repeat", required_argument, 0, 'r'},
+      {"cache_mb", required_argument, 0, 0},
+      {"block_size", required_argument, 0, 0},
+      {"memory_mb", required_argument, 0, 0},
+      {"max_entries", required_argument, 0, 'n'},
+      {"single_thread", no_argument, 0, 's'},
+      {"no_pin", no_argument, 0, 0},
+      {0, 0, 0, 0}
+    };
+
+    char opt = -1;
+    int option_index;
+    opt = getopt_long(argc, argv, "i:o:r:n:s", long_options, &option_index);
+
+    if( opt == -1) break;
+
+    string optname;
+    switch(opt){
+    case 'i':
+      input_dir = optarg;
+      break;
+    case 'o':
+      output_file = optarg;
+      break;
+    case 'r':
+      num_repeats = max(atoi(optarg), 1);
+      break;
+    case 'n':
+      max_entries = atol(optarg);
+      break;
+    case 's':
+      single_thread = true;
+      break;
+    case 0:
+      optname = long_options[option_index].name;
+      if(optname == "cache_mb"){
+        cache_mb = atol(optarg);
+      }else if(optname == "block_size"){
+        block_size = atol(optarg);
+      }else if(optname == "memory_mb"){
+        memory_mb = atol(optarg);
+      }else if(optname == "no_pin"){
+        no_pin = true;
+      }else{
+        printf("Bad option! Found option name %s\n", optname.c_str());
+      }
+      break;
+    default:
+      printf("Bad option! getopt_long returned character code 0%o\n", opt);
+      break;
+    }
+  }
+}
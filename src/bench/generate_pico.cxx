@@ -0,0 +1,300 @@
+/*! \file generate_pico.cxx
+
+  \brief Writes synthetic pico ntuples with the schema of txt/variables/pico
+
+  Every variable listed in the variables file becomes a branch of a TTree named
+  "tree", so the files can be read by Baby_pico and used to benchmark the
+  framework without access to the real ntuples. Vector branches sharing a
+  prefix (e.g. el_pt, el_eta) have the same length in each event, drawn from a
+  Poisson distribution with a typical multiplicity for that object, and the
+  matching counter (e.g. nel) is set to that length. Values are drawn from
+  simple distributions chosen by name (falling pt spectra, Z and Higgs masses,
+  uniform phi, ...), and "type" is set to 1000, 2000 or 3000 so benchmarks can
+  split the events into several processes.
+
+  Usage: generate_pico.exe [--events N] [--files N] [--compression N]
+                           [--seed N] [--output_dir DIR] [--name NAME]
+                           [--variables FILE]
+*/
+#include "core/test.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include "TError.h"
+#include "TFile.h"
+#include "TTree.h"
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  long num_events = 100000;
+  int num_files = 1;
+  int compression = 404;
+  unsigned seed = 42;
+  string output_dir = "synthetic";
+  string name = "pico_synthetic";
+  string variables_file = "txt/variables/pico";
+
+  /*!\brief Storage and generator for a single branch
+   */
+  struct Variable{
+    string type_;//!<C++ type as given in variables file
+    string name_;//!<Branch name
+    string group_;//!<Prefix shared by vectors of the same object, empty for scalars
+    bool b_;
+    int i_;
+    float f_;
+    Long64_t l_;
+    vector<bool> vb_;
+    vector<char> vc_;
+    vector<int> vi_;
+    vector<float> vf_;
+  };
+
+  bool IsVector(const string &type){
+    return type.find("vector") != string::npos;
+  }
+
+  bool EndsWith(const string &s, const string &suffix){
+    return s.size() >= suffix.size() && s.compare(s.size()-suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  /*!\brief Typical number of objects per event for a vector prefix
+   */
+  double Multiplicity(const string &group){
+    static const map<string, double> multiplicities = {
+      {"el", 1.2}, {"mu", 1.4}, {"lep", 2.}, {"ll", 1.1}, {"photon", 1.5},
+      {"llphoton", 1.3}, {"fsrphoton", 0.2}, {"jet", 3.}, {"tk", 0.5}, {"mc", 25.}
+    };
+    auto found = multiplicities.find(group);
+    return found == multiplicities.end() ? 2. : found->second;
+  }
+
+  vector<Variable> ReadVariables(const string &path){
+    ifstream file(path);
+    if(!file) ERROR("Could not open "+path);
+    vector<Variable> variables;
+    string line;
+    while(getline(file, line)){
+      line = line.substr(0, line.find('#'));
+      size_t split = line.find_last_of(" \t");
+      if(split == string::npos) continue;
+      Variable var = Variable();
+      var.name_ = line.substr(split+1);
+      var.type_ = line.substr(0, split);
+      ReplaceAll(var.type_, " ", "");
+      ReplaceAll(var.type_, "\t", "");
+      if(var.name_ == "" || var.type_ == "") continue;
+      if(IsVector(var.type_)) var.group_ = var.name_.substr(0, var.name_.find('_'));
+      variables.push_back(var);
+    }
+    return variables;
+  }
+
+  /*!\brief Draws a single value for a variable based on its name
+   */
+  double Draw(const string &var_name, const string &group, mt19937 &gen){
+    uniform_real_distribution<double> uniform(0., 1.);
+    normal_distribution<double> gauss(0., 1.);
+    if(EndsWith(var_name, "_pt") || var_name == "met" || var_name == "mht"){
+      exponential_distribution<double> falling(1./30.);
+      return 10.+falling(gen);
+    }
+    if(EndsWith(var_name, "_eta") || EndsWith(var_name, "_etasc")) return max(-2.5, min(2.5, 1.4*gauss(gen)));
+    if(EndsWith(var_name, "_phi")) return acos(-1.)*(2.*uniform(gen)-1.);
+    if(EndsWith(var_name, "_m") || EndsWith(var_name, "_mass")){
+      if(group == "ll") return 91.2+2.5*gauss(gen);
+      if(group == "llphoton") return uniform(gen) < 0.1 ? 125.+1.5*gauss(gen) : 100.+60.*uniform(gen);
+      exponential_distribution<double> falling(1./40.);
+      return falling(gen);
+    }
+    if(Contains(var_name, "pdgid") || EndsWith(var_name, "_id") || EndsWith(var_name, "_lepid")){
+      static const int ids[] = {11, -11, 13, -13, 22, 211};
+      return ids[gen()%6];
+    }
+    if(EndsWith(var_name, "_charge")) return gen()%2 ? 1 : -1;
+    if(EndsWith(var_name, "_dr") || EndsWith(var_name, "_drmin")) return 4.*uniform(gen);
+    if(Contains(var_name, "iso")) return 0.3*uniform(gen)*uniform(gen);
+    if(var_name.substr(0, 2) == "w_" || var_name == "weight") return 1.+0.1*gauss(gen);
+    return uniform(gen);
+  }
+
+  double PassProbability(const string &var_name){
+    if(var_name.substr(0, 5) == "pass_" || var_name == "pass" || var_name.substr(0, 6) == "stitch") return 0.98;
+    if(var_name.substr(0, 4) == "HLT_" || var_name.substr(0, 3) == "L1_") return 0.3;
+    return 0.7;
+  }
+
+  template<typename T>
+  void FillVector(vector<T> &vec, size_t size, const function<double()> &draw){
+    vec.resize(size);
+    for(size_t i = 0; i < size; ++i){
+      vec[i] = static_cast<T>(draw());
+    }
+  }
+
+  void Generate(deque<Variable> &vars, mt19937 &gen){
+    map<string, size_t> sizes;
+    for(const auto &var: vars){
+      if(var.group_ == "" || sizes.count(var.group_)) continue;
+      poisson_distribution<int> poisson(Multiplicity(var.group_));
+      sizes[var.group_] = poisson(gen);
+    }
+
+    for(auto &var: vars){
+      const string &n = var.name_;
+      if(var.group_ != ""){
+        size_t size = sizes.at(var.group_);
+        bernoulli_distribution pass(PassProbability(n));
+        if(var.type_ == "std::vector<bool>"){
+          var.vb_.resize(size);
+          for(size_t i = 0; i < size; ++i) var.vb_[i] = pass(gen);
+        }else if(var.type_ == "std::vector<char>"){
+          FillVector(var.vc_, size, [&](){return pass(gen);});
+        }else if(var.type_ == "std::vector<int>"){
+          poisson_distribution<int> poisson(1.);
+          if(Contains(n, "pdgid") || EndsWith(n, "_charge") || EndsWith(n, "_id")){
+            FillVector(var.vi_, size, [&](){return Draw(n, var.group_, gen);});
+          }else{
+            FillVector(var.vi_, size, [&](){return poisson(gen);});
+          }
+        }else{
+          FillVector(var.vf_, size, [&](){return Draw(n, var.group_, gen);});
+          if(EndsWith(n, "_pt")) sort(var.vf_.begin(), var.vf_.end(), greater<float>());
+        }
+      }else if(var.type_ == "bool"){
+        var.b_ = bernoulli_distribution(PassProbability(n))(gen);
+      }else if(var.type_ == "int"){
+        auto group = sizes.find(n.substr(1));
+        if(n == "type"){
+          static const int types[] = {1000, 1000, 1000, 2000, 2000, 3000};
+          var.i_ = types[gen()%6];
+        }else if(n[0] == 'n' && group != sizes.end()){
+          var.i_ = group->second;
+        }else{
+          var.i_ = poisson_distribution<int>(n[0] == 'n' && n.substr(0, 2) != "np" ? 1. : 20.)(gen);
+        }
+      }else if(var.type_ == "float"){
+        var.f_ = Draw(n, "", gen);
+      }else if(var.type_ == "Long64_t"){
+        ++var.l_;
+      }
+    }
+  }
+
+  void MakeBranches(TTree &tree, deque<Variable> &vars){
+    for(auto &var: vars){
+      const char *n = var.name_.c_str();
+      if(var.type_ == "bool") tree.Branch(n, &var.b_);
+      else if(var.type_ == "int") tree.Branch(n, &var.i_);
+      else if(var.type_ == "float") tree.Branch(n, &var.f_);
+      else if(var.type_ == "Long64_t") tree.Branch(n, &var.l_);
+      else if(var.type_ == "std::vector<bool>") tree.Branch(n, &var.vb_);
+      else if(var.type_ == "std::vector<char>") tree.Branch(n, &var.vc_);
+      else if(var.type_ == "std::vector<int>") tree.Branch(n, &var.vi_);
+      else if(var.type_ == "std::vector<float>") tree.Branch(n, &var.vf_);
+      else ERROR("Unsupported type "+var.type_+" for "+var.name_);
+    }
+  }
+}
+
+int main(int argc, char *argv[]){
+  gErrorIgnoreLevel = 6000;
+  GetOptions(argc, argv);
+
+  vector<Variable> read = ReadVariables(variables_file);
+  mkdir(output_dir.c_str(), 0777);
+  mt19937 gen(seed);
+  long written = 0;
+  for(int ifile = 0; ifile < num_files; ++ifile){
+    deque<Variable> vars(read.cbegin(), read.cend());
+    for(auto &var: vars){
+      var.l_ = written;
+    }
+    string path = output_dir+"/"+name+"_"+to_string(ifile)+".root";
+    TFile file(path.c_str(), "recreate");
+    if(file.IsZombie()) ERROR("Could not open "+path);
+    file.SetCompressionSettings(compression);
+    TTree tree("tree", "tree");
+    MakeBranches(tree, vars);
+    long file_events = num_events/num_files + (ifile < num_events%num_files ? 1 : 0);
+    for(long ievent = 0; ievent < file_events; ++ievent){
+      Generate(vars, gen);
+      tree.Fill();
+    }
+    written += file_events;
+    tree.Write();
+    file.Close();
+    cout << "Wrote " << file_events << " events to " << path << endl;
+  }
+}
+
+void GetOptions(int argc, char *argv[]){
+  while(true){
+    static struct option long_options[] = {
+      {"events", required_argument, 0, 'n'},
+      {"files", required_argument, 0, 'f'},
+      {"compression", required_argument, 0, 'c'},
+      {"seed", required_argument, 0, 's'},
+      {"output_dir", required_argument, 0, 'o'},
+      {"name", required_argument, 0, 0},
+      {"variables", required_argument, 0, 0},
+      {0, 0, 0, 0}
+    };
+
+    char opt = -1;
+    int option_index;
+    opt = getopt_long(argc, argv, "n:f:c:s:o:", long_options, &option_index);
+
+    if( opt == -1) break;
+
+    string optname;
+    switch(opt){
+    case 'n':
+      num_events = atol(optarg);
+      break;
+    case 'f':
+      num_files = max(atoi(optarg), 1);
+      break;
+    case 'c':
+      compression = atoi(optarg);
+      break;
+    case 's':
+      seed = atoi(optarg);
+      break;
+    case 'o':
+      output_dir = optarg;
+      break;
+    case 0:
+      optname = long_options[option_index].name;
+      if(optname == "name"){
+        name = optarg;
+      }else if(optname == "variables"){
+        variables_file = optarg;
+      }else{
+        printf("Bad option! Found option name %s\n", optname.c_str());
+      }
+      break;
+    default:
+      printf("Bad option! getopt_long returned character code 0%o\n", opt);
+      break;
+    }
+  }
+}
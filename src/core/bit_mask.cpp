@@ -0,0 +1,78 @@
+/*! \class BitMask
+
+  \brief Result of a vector cut packed as one bit per object
+
+  Vector cuts such as "photon_pt>15 && photon_sig" are otherwise a
+  NamedFunc::VectorType with 8 bytes per object. A BitMask stores one bit per
+  object, in 64 bit words, so checking whether any object passes
+  (BitMask::Any()) or counting them (BitMask::Count()) touches one word per 64
+  objects, and BitMask::NextSet() jumps directly from one passing object to
+  the next. Figure components get it with NamedFunc::GetMask() and reuse the
+  same BitMask every event.
+
+  As for vector cuts, an object passes if the cut value is non-zero.
+*/
+#include "core/bit_mask.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+/*!\brief Standard constructor of an empty mask
+ */
+BitMask::BitMask():
+  size_(0),
+  words_(){
+}
+
+/*!\brief Sets the mask to one bit per entry of values, set if the entry is
+  non-zero
+
+  \param[in] values Cut results
+*/
+void BitMask::Assign(const vector<double> &values){
+  Resize(values.size());
+  for(size_t iword = 0; iword < words_.size(); ++iword){
+    size_t begin = iword << 6;
+    size_t end = min(begin+64, values.size());
+    uint64_t word = 0;
+    for(size_t i = begin; i < end; ++i){
+      word |= static_cast<uint64_t>(values[i] != 0.) << (i-begin);
+    }
+    words_[iword] = word;
+  }
+}
+
+/*!\brief Sets the number of bits and clears all of them
+
+  \param[in] size Number of bits
+*/
+void BitMask::Resize(size_t size){
+  size_ = size;
+  words_.assign((size+63) >> 6, 0);
+}
+
+/*!\brief Number of bits
+ */
+size_t BitMask::Size() const{
+  return size_;
+}
+
+/*!\brief Check if at least one bit is set
+ */
+bool BitMask::Any() const{
+  for(const auto &word: words_){
+    if(word != 0) return true;
+  }
+  return false;
+}
+
+/*!\brief Number of set bits
+ */
+size_t BitMask::Count() const{
+  size_t count = 0;
+  for(const auto &word: words_){
+    count += __builtin_popcountll(word);
+  }
+  return count;
+}
@@ -0,0 +1,297 @@
+/*! \class CategoryHist1D
+
+  \brief Hist1D split into orthogonal categories by a single index
+
+  Plotting a variable in each of several orthogonal categories (e.g. lepton
+  flavor, bins of eta, years) with one Hist1D per category evaluates every
+  category's cut for every entry. A CategoryHist1D instead evaluates one
+  scalar NamedFunc giving the index of the category, and fills only the
+  histogram of that category:
+
+  \code
+  NamedFunc eta_bin("eta_bin", [](const Baby &b) -> NamedFunc::ScalarType{
+      double eta = fabs(b.mu_eta()->at(b.ll_i1()->at(0)));
+      return eta < 0.9 ? 0 : (eta < 1.2 ? 1 : 2);
+    });
+  pm.Push<CategoryHist1D>(Axis(80, 50., 130., "ll_m[0]", "m_{#mu#mu} [GeV]"), "nmu>=2",
+                          eta_bin, vector<string>{"barrel", "overlap", "endcap"},
+                          procs, ops).Tag("mumu");
+  \endcode
+
+  The category is only evaluated for entries passing the cut, which may thus
+  guard it as above. Non-integer indices are truncated, and entries with an
+  index outside [0, number of categories) are not plotted.
+  Each category is a Hist1D, printed as a separate plot whose file name ends in
+  the category name. Setters of CategoryHist1D apply to all categories, and
+  labels and zoom can also be set for a single category. The categories share
+  the cut, weight and variable, so CategoryHist1D::Category() only gives read
+  access to them.
+*/
+
+/*! \class CategoryHist1D::SingleCategoryHist1D
+
+  \brief Dispatches the entries of a Process to the histogram of their
+  category
+*/
+
+#include "core/category_hist1d.hpp"
+
+#include <cmath>
+
+#include "core/utilities.hpp"
+#include "core/event_block.hpp"
+
+using namespace std;
+
+/*!\brief Standard constructor
+
+  \param[in] figure CategoryHist1D containing this component
+
+  \param[in] process Process used to fill the histograms
+*/
+CategoryHist1D::SingleCategoryHist1D::SingleCategoryHist1D(const CategoryHist1D &figure,
+                                                           const shared_ptr<Process> &process):
+  FigureComponent(figure, process),
+  hists_(),
+  proc_and_hist_cut_(figure.hists_.front()->cut_ && process->cut_),
+  cut_mask_(),
+  cat_vector_(),
+  cut_vector_(),
+  wgt_vector_(),
+  val_vector_(){
+  for(const auto &hist: figure.hists_){
+    hists_.push_back(static_cast<Hist1D::SingleHist1D*>(hist->GetComponent(process.get())));
+  }
+}
+
+/*!\brief Evaluates the cut, then the category of passing entries, and
+  records them in the histogram of their category
+ */
+void CategoryHist1D::SingleCategoryHist1D::RecordEvent(const Baby &baby){
+  const CategoryHist1D &figure = static_cast<const CategoryHist1D&>(figure_);
+  const BitMask *mask = nullptr;
+  if(proc_and_hist_cut_.IsScalar()){
+    if(!proc_and_hist_cut_.GetScalar(baby)) return;
+  }else{
+    proc_and_hist_cut_.GetMask(baby, cut_mask_);
+    if(!HavePass(cut_mask_)) return;
+    mask = &cut_mask_;
+  }
+  NamedFunc::ScalarType category = trunc(figure.category_.GetScalar(baby));
+  if(!(category >= 0.) || category >= hists_.size()) return;
+  hists_[static_cast<size_t>(category)]->RecordPassing(baby, mask);
+}
+
+void CategoryHist1D::SingleCategoryHist1D::FinishBaby(const Baby &baby){
+  for(const auto &hist: hists_) hist->FinishBaby(baby);
+}
+
+/*!\brief Check if the category, cut, weight and plotted variable can all be
+  evaluated over an EventBlock
+*/
+bool CategoryHist1D::SingleCategoryHist1D::CanRecordBlock() const{
+  const Hist1D &hist = static_cast<const Hist1D&>(hists_.front()->figure_);
+  const CategoryHist1D &figure = static_cast<const CategoryHist1D&>(figure_);
+  return figure.category_.HasBlock() && proc_and_hist_cut_.HasBlock()
+    && hist.weight_.HasBlock() && hist.xaxis_.var_.HasBlock();
+}
+
+/*!\brief Records the events of block passing pass and the cut, each in the
+  histogram of its category
+
+  The cut, weight and plotted variable are evaluated once for all
+  categories. Only valid if CanRecordBlock() is true.
+*/
+void CategoryHist1D::SingleCategoryHist1D::RecordBlock(const EventBlock &block,
+                                                       const NamedFunc::VectorType &pass){
+  const Hist1D &hist = static_cast<const Hist1D&>(hists_.front()->figure_);
+  const CategoryHist1D &figure = static_cast<const CategoryHist1D&>(figure_);
+  figure.category_.GetBlock(block, cat_vector_);
+  proc_and_hist_cut_.GetBlock(block, cut_vector_);
+  hist.weight_.GetBlock(block, wgt_vector_);
+  hist.xaxis_.var_.GetBlock(block, val_vector_);
+  for(size_t i = 0; i < block.Size(); ++i){
+    if(!pass[i] || !cut_vector_[i]) continue;
+    NamedFunc::ScalarType category = trunc(cat_vector_[i]);
+    if(!(category >= 0.) || category >= hists_.size()) continue;
+    hists_[static_cast<size_t>(category)]->fill_hist_.Fill(val_vector_[i], wgt_vector_[i]);
+  }
+}
+
+size_t CategoryHist1D::SingleCategoryHist1D::EstimateBytes() const{
+  size_t bytes = FigureComponent::EstimateBytes();
+  for(const auto &hist: hists_) bytes += hist->EstimateBytes();
+  return bytes;
+}
+
+/*!\brief CategoryHist1D components can be merged across shards
+ */
+bool CategoryHist1D::SingleCategoryHist1D::CanMerge() const{
+  return true;
+}
+
+/*!\brief Writes the histogram of each category in order
+ */
+void CategoryHist1D::SingleCategoryHist1D::WriteState(ostream &out){
+  for(const auto &hist: hists_) hist->WriteState(out);
+}
+
+/*!\brief Adds the histograms of each category written by another shard
+ */
+void CategoryHist1D::SingleCategoryHist1D::MergeState(istream &in){
+  for(const auto &hist: hists_) hist->MergeState(in);
+}
+
+/*!\brief Standard constructor
+
+  \param[in] xaxis Specification of content: plotted variable, binning, etc.
+
+  \param[in] cut Event selection common to all categories
+
+  \param[in] category Scalar index of the category of an entry
+
+  \param[in] category_names Name of each category, used in the file names
+
+  \param[in] processes Processes in the plots
+
+  \param[in] plot_options Styles with which to draw the plots
+*/
+CategoryHist1D::CategoryHist1D(const Axis &xaxis, const NamedFunc &cut,
+                               const NamedFunc &category,
+                               const vector<string> &category_names,
+                               const vector<shared_ptr<Process> > &processes,
+                               const vector<PlotOpt> &plot_options):
+  Figure(),
+  category_(category),
+  category_names_(category_names),
+  tag_(""),
+  hists_(),
+  components_(){
+  if(category_names_.empty()) ERROR("CategoryHist1D needs at least one category");
+  if(!category_.IsScalar()) ERROR("Category "+category_.Name()+" must be scalar");
+  for(size_t icat = 0; icat < category_names_.size(); ++icat){
+    hists_.emplace_back(new Hist1D(xaxis, cut, processes, plot_options));
+  }
+  for(const auto &process: processes){
+    components_.emplace_back(new SingleCategoryHist1D(*this, process));
+  }
+  SetCategoryTags();
+}
+
+/*! \brief Prints the plot of each category
+
+  \param[in] luminosity The integrated luminosity with which to draw the plots
+
+  \param[in] subdir Subdirectory of plots/ in which to save the plots
+*/
+void CategoryHist1D::Print(double luminosity,
+                           const string &subdir){
+  for(const auto &hist: hists_) hist->Print(luminosity, subdir);
+}
+
+set<const Process*> CategoryHist1D::GetProcesses() const{
+  set<const Process*> processes;
+  for(const auto &component: components_){
+    processes.insert(component->process_.get());
+  }
+  return processes;
+}
+
+string CategoryHist1D::GetTag() const{
+  return tag_;
+}
+
+vector<NamedFunc> CategoryHist1D::GetFunctions() const{
+  vector<NamedFunc> functions = hists_.front()->GetFunctions();
+  functions.push_back(category_);
+  return functions;
+}
+
+Figure::FigureComponent * CategoryHist1D::GetComponent(const Process *process){
+  for(const auto &component: components_){
+    if(component->process_.get() == process){
+      return component.get();
+    }
+  }
+  DBG("Could not find histograms for process "+process->name_+".");
+  return nullptr;
+}
+
+size_t CategoryHist1D::NumCategories() const{
+  return hists_.size();
+}
+
+/*!\brief Plot of the icategory-th category
+ */
+const Hist1D & CategoryHist1D::Category(size_t icategory) const{
+  return *hists_.at(icategory);
+}
+
+CategoryHist1D & CategoryHist1D::Weight(const NamedFunc &weight){
+  for(const auto &hist: hists_) hist->Weight(weight);
+  SetCategoryTags();
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::Tag(const string &tag){
+  tag_ = tag;
+  SetCategoryTags();
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::LuminosityTag(const string &tag){
+  for(const auto &hist: hists_) hist->LuminosityTag(tag);
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::LeftLabel(const vector<string> &label){
+  for(const auto &hist: hists_) hist->LeftLabel(label);
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::LeftLabel(size_t icategory, const vector<string> &label){
+  hists_.at(icategory)->LeftLabel(label);
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::RightLabel(const vector<string> &label){
+  for(const auto &hist: hists_) hist->RightLabel(label);
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::RightLabel(size_t icategory, const vector<string> &label){
+  hists_.at(icategory)->RightLabel(label);
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::YAxisZoom(const double &yaxis_zoom){
+  for(const auto &hist: hists_) hist->YAxisZoom(yaxis_zoom);
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::YAxisZoom(size_t icategory, const double &yaxis_zoom){
+  hists_.at(icategory)->YAxisZoom(yaxis_zoom);
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::RatioTitle(const string &numerator,
+                                            const string &denominator){
+  for(const auto &hist: hists_) hist->RatioTitle(numerator, denominator);
+  return *this;
+}
+
+CategoryHist1D & CategoryHist1D::DrawPlot(const bool &draw_plot){
+  for(const auto &hist: hists_) hist->DrawPlot(draw_plot);
+  return *this;
+}
+
+/*!\brief Tags each category's plot with the name it would have without
+  categories, followed by the category name
+*/
+void CategoryHist1D::SetCategoryTags(){
+  for(size_t icat = 0; icat < hists_.size(); ++icat){
+    Hist1D &hist = *hists_.at(icat);
+    hist.Tag(tag_);
+    hist.Tag(hist.Name()+"__"+CodeToPlainText(category_names_.at(icat)));
+  }
+}
@@ -7,6 +7,7 @@
 #include <random>
 
 #include "core/utilities.hpp"
+#include "core/shard_io.hpp"
 
 using namespace std;
 using namespace Clustering;
@@ -65,6 +66,7 @@ Clusterizer::Clusterizer(const TH2D &hist_template, long max_points):
   max_points_(max_points),
   hist_mode_(max_points == 0),
   hist_(hist_template),
+  pending_fills_(hist_template),
   orig_points_(),
   nodes_(),
   final_points_(),
@@ -81,7 +83,7 @@ void Clusterizer::AddPoint(float x, float y, float w){
     hist_mode_ = true;
     orig_points_.clear();
   }
-  hist_.Fill(x, y, w);
+  pending_fills_.Fill(x, y, w);
   if(!hist_mode_){
     orig_points_.emplace_back(x, y, w);
   }
@@ -98,7 +100,7 @@ void Clusterizer::SetPoints(const vector<Point> &points){
     orig_points_ = points;
   }
   for(const auto &p: points){
-    hist_.Fill(p.x_, p.y_, p.w_);
+    pending_fills_.Fill(p.x_, p.y_, p.w_);
   }
 }
 
@@ -107,22 +109,76 @@ void Clusterizer::SetPoints(const TH2D &h){
   EmptyHistogram();
   hist_mode_ = true;
   hist_ = h;
+  pending_fills_ = FastHist(h);
   if(max_points_ >= 0 && max_points_ < hist_.GetNcells()){
     max_points_ = hist_.GetNcells();
   }
 }
 
 TH2D Clusterizer::GetHistogram(double luminosity) const{
+  FlushPendingFills();
   TH2D h = hist_;
   h.Scale(luminosity);
   return h;
 }
 
 TH2D Clusterizer::GetHistogram() const{
+  FlushPendingFills();
   TH2D h = hist_;
   return h;
 }
 
+/*!\brief Approximate memory once full: the histogram and pending fills, plus
+  up to max_points_ points with their clustering nodes. Points are not
+  counted if their number is unbounded.
+*/
+size_t Clusterizer::EstimateBytes() const{
+  size_t bytes = 2*(sizeof(TH2D) + 2*sizeof(double)*static_cast<size_t>(hist_.GetNcells()));
+  if(max_points_ > 0){
+    bytes += static_cast<size_t>(max_points_)*(2*sizeof(Point) + sizeof(Node) + 4*sizeof(void*));
+  }
+  return bytes;
+}
+
+/*!\brief Writes the points, if still kept, and the histogram of all points
+ */
+void Clusterizer::WriteState(ostream &out) const{
+  FlushPendingFills();
+  ShardIO::Write(out, hist_mode_);
+  ShardIO::Write<size_t>(out, orig_points_.size());
+  for(const auto &p: orig_points_){
+    ShardIO::Write(out, p.x_);
+    ShardIO::Write(out, p.y_);
+    ShardIO::Write(out, p.w_);
+  }
+  ShardIO::WriteHist(out, hist_);
+}
+
+/*!\brief Adds the points and histogram written by WriteState() in another
+  shard
+
+  Points are kept only while neither side has switched to histogram mode and
+  their total stays within max_points_, as if all had been added here.
+*/
+void Clusterizer::MergeState(istream &in){
+  clustered_lumi_ = -1.;
+  bool other_hist_mode = ShardIO::Read<bool>(in);
+  size_t num_points = ShardIO::Read<size_t>(in);
+  if(other_hist_mode
+     || (max_points_ >= 0 && orig_points_.size()+num_points > static_cast<size_t>(max_points_))){
+    hist_mode_ = true;
+    orig_points_.clear();
+  }
+  for(size_t i = 0; i < num_points; ++i){
+    float x = ShardIO::Read<float>(in);
+    float y = ShardIO::Read<float>(in);
+    float w = ShardIO::Read<float>(in);
+    if(!hist_mode_) orig_points_.emplace_back(x, y, w);
+  }
+  FlushPendingFills();
+  ShardIO::AddHist(in, hist_);
+}
+
 TGraph Clusterizer::GetGraph(double luminosity, bool keep_in_frame) const{
   Cluster(luminosity);
   float xmin = hist_.GetXaxis()->GetBinLowEdge(1);
@@ -269,11 +325,22 @@ void Clusterizer::EmptyHistogram(){
     hist_.SetBinError(i, 0.);
   }
   hist_.SetEntries(0.);
+  pending_fills_.Reset();
+}
+
+/*!\brief Adds points accumulated in pending_fills_ to hist_
+
+  Points are first binned in a FastHist, which is much cheaper than TH2D::Fill
+  for every point, and only added to hist_ when it is needed.
+*/
+void Clusterizer::FlushPendingFills() const{
+  pending_fills_.FlushTo(hist_);
 }
 
 void Clusterizer::Cluster(double luminosity) const{
   if(luminosity == clustered_lumi_) return;
 
+  FlushPendingFills();
   SetupNodes(luminosity);
   MergeNodes();
   
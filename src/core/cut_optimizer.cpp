@@ -0,0 +1,298 @@
+/*! \class CutOptimizer
+
+  \brief Opt-in reordering of "&&" chains by measured pass rate and cost
+
+  Every chain of scalar "&&" operations is flattened into a CutOptimizer::Chain
+  by NamedFunc's operator&&. By default the chain evaluates its conjuncts in the
+  order written, short-circuiting at the first failure, exactly like nested
+  "&&".
+
+  When enabled with CutOptimizer::Enable() (or PlotMaker::optimize_cuts_), each
+  chain measures the pass rate and evaluation time of each conjunct on the first
+  CutOptimizer::TrainingEvents() events of each Baby, then evaluates the
+  remaining events of that Baby with the conjuncts sorted by increasing
+  cost/(1-pass rate), which minimizes the expected cost for independent
+  conjuncts.
+
+  Only pure conjuncts (see NamedFunc::IsPure()) are moved. Impure ones, such as
+  C++ lambdas and subscripts like "photon_pt[0]", act as barriers: conjuncts are
+  only reordered between them, and an impure conjunct is never evaluated unless
+  all conjuncts written before it pass. The result of the chain is therefore
+  unchanged.
+*/
+
+/*! \class CutOptimizer::Chain
+
+  \brief Flattened list of conjuncts evaluated with short-circuiting
+
+  Learning state is kept per thread, and each Baby is processed by a single
+  thread, so evaluation needs no locking. PlotMaker calls CutOptimizer::Reset()
+  after each Baby to release the states of the calling thread. The mutex is only
+  used once per Baby to record the chosen order for CutOptimizer::Report().
+*/
+#include "core/cut_optimizer.hpp"
+
+#include <cmath>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+using namespace std;
+
+using ScalarType = NamedFunc::ScalarType;
+
+namespace{
+  atomic<unsigned long> next_chain_id(0);
+}
+
+atomic<bool> CutOptimizer::enabled_(false);
+atomic<size_t> CutOptimizer::training_events_(2000);
+mutex CutOptimizer::mutex_{};
+vector<weak_ptr<const CutOptimizer::Chain> > CutOptimizer::chains_{};
+
+/*!\brief Standard constructor
+
+  \param[in] name String representation of the full chain
+
+  \param[in] conjuncts Scalar functions which must all be true
+*/
+CutOptimizer::Chain::Chain(const string &name,
+                           const vector<NamedFunc> &conjuncts):
+  enable_shared_from_this<Chain>(),
+  id_(next_chain_id++),
+  name_(name),
+  names_(),
+  functions_(),
+  pure_(),
+  mutex_(),
+  orders_(),
+  registered_(false){
+  for(const auto &conjunct: conjuncts){
+    names_.push_back(conjunct.Name());
+    functions_.push_back(conjunct.ScalarFunction());
+    pure_.push_back(conjunct.IsPure());
+  }
+}
+
+/*!\brief Evaluate logical and of all conjuncts
+
+  \param[in] baby Baby at the current entry
+
+  \return 1 if all conjuncts are true, 0 otherwise
+*/
+ScalarType CutOptimizer::Chain::Evaluate(const Baby &baby) const{
+  if(Enabled()){
+    State &state = GetState(baby);
+    if(state.order_.size() == 0) return Train(baby, state);
+    for(const auto &i: state.order_){
+      if(!functions_[i](baby)) return false;
+    }
+    return true;
+  }
+  for(const auto &function: functions_){
+    if(!function(baby)) return false;
+  }
+  return true;
+}
+
+/*!\brief Check if any Baby uses an order different from the written one
+ */
+bool CutOptimizer::Chain::Reordered() const{
+  lock_guard<mutex> lock(mutex_);
+  for(const auto &order: orders_){
+    if(!is_sorted(order.first.cbegin(), order.first.cend())) return true;
+  }
+  return false;
+}
+
+/*!\brief Print orders chosen for this chain
+
+  \param[in,out] stream Stream to print to
+*/
+void CutOptimizer::Chain::Print(ostream &stream) const{
+  lock_guard<mutex> lock(mutex_);
+  stream << name_ << endl;
+  for(const auto &order: orders_){
+    const OrderSummary &summary = order.second;
+    stream << "  " << setw(5) << summary.num_files_ << " file(s): ";
+    for(auto i = order.first.cbegin(); i != order.first.cend(); ++i){
+      if(i != order.first.cbegin()) stream << " && ";
+      stream << names_.at(*i);
+    }
+    stream << endl << "    expected " << 1e9*summary.cost_after_/summary.num_files_
+           << " ns/event instead of " << 1e9*summary.cost_before_/summary.num_files_ << " ns/event" << endl;
+  }
+}
+
+/*!\brief Learning states of the calling thread, indexed by chain id
+ */
+unordered_map<unsigned long, CutOptimizer::Chain::State> & CutOptimizer::Chain::LocalStates(){
+  thread_local unordered_map<unsigned long, State> states;
+  return states;
+}
+
+/*!\brief Get learning state of this chain for current thread
+
+  The state is reset whenever a new Baby is seen.
+
+  \param[in] baby Baby being processed
+
+  \return Learning state of this thread
+*/
+CutOptimizer::Chain::State & CutOptimizer::Chain::GetState(const Baby &baby) const{
+  State &state = LocalStates()[id_];
+  if(state.baby_ != &baby){
+    size_t n = functions_.size();
+    state = State{&baby, 0, vector<size_t>(),
+                  vector<double>(n, 0.), vector<long>(n, 0), vector<long>(n, 0)};
+  }
+  return state;
+}
+
+/*!\brief Evaluate chain while measuring pass rate and cost of pure conjuncts
+
+  Pure conjuncts are evaluated even after a failure so that their pass rates
+  are measured independently. Impure conjuncts keep their guards.
+
+  \param[in] baby Baby at the current entry
+
+  \param[in,out] state Learning state for this Baby
+
+  \return 1 if all conjuncts are true, 0 otherwise
+*/
+ScalarType CutOptimizer::Chain::Train(const Baby &baby, State &state) const{
+  using Clock = chrono::steady_clock;
+  bool result = true;
+  for(size_t i = 0; i < functions_.size(); ++i){
+    if(!pure_[i]){
+      if(!result) break;
+      result = functions_[i](baby);
+      continue;
+    }
+    auto start = Clock::now();
+    bool pass = functions_[i](baby);
+    state.seconds_[i] += chrono::duration<double>(Clock::now()-start).count();
+    ++state.calls_[i];
+    if(pass) ++state.passes_[i];
+    result = result && pass;
+  }
+  if(++state.num_events_ >= TrainingEvents()) ChooseOrder(state);
+  return result;
+}
+
+/*!\brief Sort pure conjuncts between barriers by cost/(1-pass rate)
+
+  \param[in,out] state Learning state whose order is set
+*/
+void CutOptimizer::Chain::ChooseOrder(State &state) const{
+  auto rank = [&state](size_t i){
+    if(state.calls_[i] == 0) return numeric_limits<double>::max();
+    double cost = state.seconds_[i]/state.calls_[i];
+    double fail = 1.-static_cast<double>(state.passes_[i])/state.calls_[i];
+    return fail > 0. ? cost/fail : numeric_limits<double>::max();
+  };
+
+  vector<size_t> order(functions_.size());
+  iota(order.begin(), order.end(), 0);
+  auto begin = order.begin();
+  while(begin != order.end()){
+    auto end = find_if(begin, order.end(), [this](size_t i){return !pure_[i];});
+    stable_sort(begin, end, [&rank](size_t a, size_t b){return rank(a) < rank(b);});
+    begin = end == order.end() ? end : end+1;
+  }
+
+  vector<size_t> original(functions_.size());
+  iota(original.begin(), original.end(), 0);
+  double cost_before = ExpectedCost(state, original);
+  double cost_after = ExpectedCost(state, order);
+  state.order_ = order;
+
+  bool first = false;
+  {
+    lock_guard<mutex> lock(mutex_);
+    OrderSummary &summary = orders_.emplace(order, OrderSummary{0, 0., 0.}).first->second;
+    ++summary.num_files_;
+    summary.cost_before_ += cost_before;
+    summary.cost_after_ += cost_after;
+    first = !registered_;
+    registered_ = true;
+  }
+  if(first) Register(shared_from_this());
+}
+
+/*!\brief Expected time per event of evaluating measured conjuncts in given order
+
+  Assumes conjuncts are independent. Impure conjuncts are not measured and are
+  treated as free and always passing.
+*/
+double CutOptimizer::Chain::ExpectedCost(const State &state, const vector<size_t> &order) const{
+  double cost = 0., prob_reached = 1.;
+  for(const auto &i: order){
+    if(state.calls_[i] == 0) continue;
+    cost += prob_reached*state.seconds_[i]/state.calls_[i];
+    prob_reached *= static_cast<double>(state.passes_[i])/state.calls_[i];
+  }
+  return cost;
+}
+
+/*!\brief Turn learning and reordering of "&&" chains on or off
+
+  \param[in] enable Whether to optimize
+*/
+void CutOptimizer::Enable(bool enable){
+  enabled_ = enable;
+}
+
+bool CutOptimizer::Enabled(){
+  return enabled_.load(memory_order_relaxed);
+}
+
+/*!\brief Set number of events of each Baby used to measure conjuncts
+
+  \param[in] num_events Number of training events
+*/
+void CutOptimizer::TrainingEvents(size_t num_events){
+  training_events_ = max(num_events, static_cast<size_t>(1));
+}
+
+size_t CutOptimizer::TrainingEvents(){
+  return training_events_.load(memory_order_relaxed);
+}
+
+/*!\brief Print chosen order for every chain that was reordered
+
+  \param[in,out] stream Stream to print to
+*/
+void CutOptimizer::Report(ostream &stream){
+  lock_guard<mutex> lock(mutex_);
+  chains_.erase(remove_if(chains_.begin(), chains_.end(),
+                          [](const weak_ptr<const Chain> &chain){return chain.expired();}),
+                chains_.end());
+  bool printed_header = false;
+  for(const auto &weak_chain: chains_){
+    auto chain = weak_chain.lock();
+    if(!chain || !chain->Reordered()) continue;
+    if(!printed_header){
+      stream << "Reordered cuts:" << endl;
+      printed_header = true;
+    }
+    chain->Print(stream);
+  }
+}
+
+/*!\brief Release the learning states of the calling thread
+
+  Orders already chosen are kept for CutOptimizer::Report().
+*/
+void CutOptimizer::Reset(){
+  unordered_map<unsigned long, Chain::State>().swap(Chain::LocalStates());
+}
+
+void CutOptimizer::Register(const shared_ptr<const Chain> &chain){
+  lock_guard<mutex> lock(mutex_);
+  chains_.push_back(chain);
+}
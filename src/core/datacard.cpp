@@ -0,0 +1,717 @@
+/*! \class Datacard
+
+  \brief Combine datacards for every signal scan point, filled in a single
+  pass over the inputs
+
+  Datacards are usually written by running a program once per set of cards,
+  each rereading all backgrounds. A Datacard instead records, in one event
+  loop, the yields of every process in each region for the nominal weight and
+  for each systematic weight variation. Signal processes are further split by
+  the scan point given by scalar key functions, as in ScanBank, so one
+  Datacard writes the cards of a whole scan:
+
+  \code
+  pm.Push<Datacard>("tchihh", vector<Datacard::Region>{{"met0_nb3", "met>150&&met<=200&&nb==3"},
+                                                        {"met0_nb4", "met>150&&met<=200&&nb>=4"}},
+                    procs)
+    .ScanKeys({"mprod", "mlsp"})
+    .AddSystematic({"btag_bc", "sys_bchig[0]/w_bhig", "sys_bchig[1]/w_bhig"})
+    .AddLogNormal("lumi", 1.016);
+  \endcode
+
+  Without an Axis, counting cards are written with one bin per region, weight
+  variations as asymmetric lnN nuisances and, if Datacard::mc_stats_ is set,
+  an lnN nuisance for the statistical uncertainty of each simulated yield.
+  With an Axis, each region is a channel with a histogram of the axis
+  variable, values outside the axis going to the first or last bin. The
+  nominal and varied histograms are written to ROOT files next to the cards,
+  weight variations become shape nuisances and statistical uncertainties are
+  handled by autoMCStats. Backgrounds and data are shared by all points in
+  one file, and each point gets a file with its signal histograms.
+
+  Simulated yields are scaled by the luminosity. The observation is the sum of
+  the data processes or, if there are none, the total background.
+
+  Cards are written to datacards/[subdir/]name/name_point.txt, with the point
+  named after the keys and their values. Yields are available from
+  Datacard::Yield() as GammaParams, like Table::Yield().
+*/
+
+/*! \class Datacard::Region
+
+  \brief Bin (channel) of the datacards and its selection
+*/
+
+/*! \class Datacard::Systematic
+
+  \brief Nuisance parameter given by factors applied to the event weight
+*/
+
+/*! \class Datacard::Point
+
+  \brief Sums of weights of one process at one scan point
+*/
+
+/*! \class Datacard::SingleDatacard
+
+  \brief Yields of a Datacard for one process
+*/
+#include "core/datacard.hpp"
+
+#include <cmath>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <sys/stat.h>
+
+#include "TFile.h"
+#include "TH1D.h"
+
+#include "core/utilities.hpp"
+#include "core/shard_io.hpp"
+
+using namespace std;
+
+namespace{
+  //! Writes rows of cells with each column padded to its widest cell, and
+  //! empty rows as separators
+  void WriteColumns(ofstream &file, const vector<vector<string> > &rows){
+    vector<size_t> widths;
+    for(const auto &row: rows){
+      if(widths.size() < row.size()) widths.resize(row.size(), 0);
+      for(size_t icol = 0; icol < row.size(); ++icol){
+        widths.at(icol) = max(widths.at(icol), row.at(icol).size());
+      }
+    }
+    for(const auto &row: rows){
+      if(row.empty()) file << "------------";
+      for(size_t icol = 0; icol < row.size(); ++icol){
+        file << row.at(icol);
+        if(icol+1 < row.size()) file << string(widths.at(icol)-row.at(icol).size()+2, ' ');
+      }
+      file << '\n';
+    }
+  }
+
+  string FormatNumber(double x, int precision = 6){
+    ostringstream oss;
+    oss << setprecision(precision) << x;
+    return oss.str();
+  }
+
+  //! lnN entry for a variation from nominal to up and down, "-" if undefined
+  string LogNormalKappa(double nominal, double up, double down, bool has_down){
+    if(nominal <= 0. || up <= 0. || (has_down && down <= 0.)) return "-";
+    if(!has_down) return FormatNumber(up/nominal, 4);
+    return FormatNumber(down/nominal, 4)+"/"+FormatNumber(up/nominal, 4);
+  }
+}
+
+Datacard::Region::Region(const string &name,
+                         const NamedFunc &cut):
+  name_(name),
+  cut_(cut){
+}
+
+/*!\brief Constructor of a one-sided variation
+
+  \param[in] name Name of the nuisance parameter
+
+  \param[in] up Factor applied to the nominal weight
+*/
+Datacard::Systematic::Systematic(const string &name,
+                                 const NamedFunc &up):
+  name_(name),
+  up_(up),
+  down_(1.),
+  has_down_(false){
+}
+
+/*!\brief Constructor of a two-sided variation
+
+  \param[in] name Name of the nuisance parameter
+
+  \param[in] up Factor applied to the nominal weight for the up variation
+
+  \param[in] down Factor applied to the nominal weight for the down variation
+*/
+Datacard::Systematic::Systematic(const string &name,
+                                 const NamedFunc &up,
+                                 const NamedFunc &down):
+  name_(name),
+  up_(up),
+  down_(down),
+  has_down_(true){
+}
+
+Datacard::SingleDatacard::SingleDatacard(const Datacard &datacard,
+                                         const shared_ptr<Process> &process):
+  FigureComponent(datacard, process),
+  proc_and_region_cuts_(),
+  points_(),
+  last_point_(nullptr),
+  last_key_(),
+  key_(),
+  weights_(){
+  for(const auto &region: datacard.regions_){
+    proc_and_region_cuts_.push_back(region.cut_ && process->cut_);
+    datacard.CheckScalar(proc_and_region_cuts_.back());
+  }
+}
+
+void Datacard::SingleDatacard::RecordEvent(const Baby &baby){
+  const Datacard &card = static_cast<const Datacard&>(figure_);
+  Point *point = nullptr;
+  size_t ibin = 0;
+  for(size_t iregion = 0; iregion < proc_and_region_cuts_.size(); ++iregion){
+    if(!proc_and_region_cuts_[iregion].GetScalar(baby)) continue;
+    if(point == nullptr){
+      // Weights, bin and point are only needed once an entry passes a region
+      NamedFunc::ScalarType weight = card.weight_.GetScalar(baby);
+      weights_.resize(card.NumVariations());
+      weights_[0] = weight;
+      for(size_t isyst = 0; isyst < card.systematics_.size(); ++isyst){
+        const Systematic &syst = card.systematics_[isyst];
+        weights_[1+2*isyst] = weight*syst.up_.GetScalar(baby);
+        weights_[2+2*isyst] = syst.has_down_ ? weight*syst.down_.GetScalar(baby) : weight;
+      }
+      if(card.is_shape_){
+        const vector<double> &edges = card.axis_.Bins();
+        NamedFunc::ScalarType value = card.axis_.var_.GetScalar(baby);
+        size_t iedge = upper_bound(edges.cbegin(), edges.cend(), value) - edges.cbegin();
+        ibin = min(max(iedge, static_cast<size_t>(1)), card.NumBins()) - 1;
+      }
+      key_.resize(process_->type_ == Process::Type::signal ? card.keys_.size() : 0);
+      for(size_t ikey = 0; ikey < key_.size(); ++ikey){
+        key_[ikey] = card.keys_[ikey].GetScalar(baby);
+      }
+      point = &GetPoint(key_);
+    }
+    for(size_t ivar = 0; ivar < weights_.size(); ++ivar){
+      size_t index = card.Index(iregion, ivar, ibin);
+      point->sumw_[index] += weights_[ivar];
+      point->sumw2_[index] += weights_[ivar]*weights_[ivar];
+    }
+  }
+}
+
+/*!\brief Memory of the points recorded so far, and of at least one point
+ */
+size_t Datacard::SingleDatacard::EstimateBytes() const{
+  const Datacard &card = static_cast<const Datacard&>(figure_);
+  size_t point_bytes = 2*sizeof(double)*card.regions_.size()*card.NumVariations()*card.NumBins()
+    + sizeof(double)*card.keys_.size() + 64;
+  return FigureComponent::EstimateBytes() + point_bytes*max(points_.size(), static_cast<size_t>(1));
+}
+
+/*!\brief Datacard components can be merged across shards
+ */
+bool Datacard::SingleDatacard::CanMerge() const{
+  return true;
+}
+
+/*!\brief Writes the key and sums of every point
+ */
+void Datacard::SingleDatacard::WriteState(ostream &out){
+  ShardIO::Write<size_t>(out, points_.size());
+  for(const auto &point: points_){
+    ShardIO::WriteVector(out, point.first);
+    ShardIO::WriteVector(out, point.second.sumw_);
+    ShardIO::WriteVector(out, point.second.sumw2_);
+  }
+}
+
+/*!\brief Adds the points written by another shard
+ */
+void Datacard::SingleDatacard::MergeState(istream &in){
+  const Datacard &card = static_cast<const Datacard&>(figure_);
+  size_t num_points = ShardIO::Read<size_t>(in);
+  Key key(process_->type_ == Process::Type::signal ? card.keys_.size() : 0);
+  for(size_t ipoint = 0; ipoint < num_points; ++ipoint){
+    fill(key.begin(), key.end(), 0.);
+    ShardIO::AddVector(in, key);
+    Point &point = GetPoint(key);
+    ShardIO::AddVector(in, point.sumw_);
+    ShardIO::AddVector(in, point.sumw2_);
+  }
+}
+
+/*!\brief Sums of weights of each scan point, a single point with empty key
+  for processes that are not split
+*/
+const map<Datacard::Key, Datacard::Point> & Datacard::SingleDatacard::Points() const{
+  return points_;
+}
+
+Datacard::Point & Datacard::SingleDatacard::GetPoint(const Key &key){
+  if(last_point_ != nullptr && key == last_key_) return *last_point_;
+  auto found = points_.find(key);
+  if(found == points_.end()){
+    const Datacard &card = static_cast<const Datacard&>(figure_);
+    size_t num_values = card.regions_.size()*card.NumVariations()*card.NumBins();
+    found = points_.emplace(key, Point{vector<double>(num_values, 0.), vector<double>(num_values, 0.)}).first;
+  }
+  last_key_ = key;
+  last_point_ = &found->second;
+  return *last_point_;
+}
+
+/*!\brief Constructor of counting datacards
+
+  \param[in] name Name of the datacards, used for the output directory and
+  file names
+
+  \param[in] regions Bins of the datacards. Cuts must be scalar.
+
+  \param[in] processes Processes in the datacards: signals, backgrounds and
+  data giving the observation
+*/
+Datacard::Datacard(const string &name,
+                   const vector<Region> &regions,
+                   const vector<shared_ptr<Process> > &processes):
+  Figure(),
+  name_(name),
+  regions_(regions),
+  axis_(1, 0., 1., 0.),
+  is_shape_(false),
+  keys_(),
+  weight_("weight"),
+  systematics_(),
+  log_normals_(),
+  mc_stats_(true),
+  backgrounds_(),
+  signals_(),
+  datas_(){
+  AddProcesses(processes);
+}
+
+/*!\brief Constructor of shape datacards with a histogram of axis in each
+  region
+*/
+Datacard::Datacard(const string &name,
+                   const vector<Region> &regions,
+                   const Axis &axis,
+                   const vector<shared_ptr<Process> > &processes):
+  Figure(),
+  name_(name),
+  regions_(regions),
+  axis_(axis),
+  is_shape_(true),
+  keys_(),
+  weight_("weight"),
+  systematics_(),
+  log_normals_(),
+  mc_stats_(true),
+  backgrounds_(),
+  signals_(),
+  datas_(){
+  CheckScalar(axis_.var_);
+  AddProcesses(processes);
+}
+
+/*!\brief Writes the datacards of every scan point, and for shape datacards
+  the ROOT files with their histograms
+*/
+void Datacard::Print(double luminosity,
+                     const string &subdir){
+  string dir = "datacards";
+  mkdir(dir.c_str(), 0777);
+  if(subdir != ""){
+    dir += "/"+subdir;
+    mkdir(dir.c_str(), 0777);
+  }
+  string base_name = CodeToPlainText(name_);
+  dir += "/"+base_name;
+  mkdir(dir.c_str(), 0777);
+
+  string shapes_file = "";
+  if(is_shape_){
+    shapes_file = base_name+"_shapes.root";
+    vector<const SingleDatacard*> components;
+    for(const auto &component: backgrounds_) components.push_back(component.get());
+    for(const auto &component: datas_) components.push_back(component.get());
+    WriteShapes(dir+"/"+shapes_file, components, Key(), luminosity);
+  }
+
+  set<Key> points = Points();
+  for(const auto &key: points){
+    string card_name = key.empty() ? base_name : base_name+"_"+PointName(key);
+    string signal_shapes_file = "";
+    if(is_shape_ && !signals_.empty()){
+      signal_shapes_file = card_name+"_signal.root";
+      vector<const SingleDatacard*> components;
+      for(const auto &component: signals_) components.push_back(component.get());
+      WriteShapes(dir+"/"+signal_shapes_file, components, key, luminosity);
+    }
+    WriteCard(dir+"/"+card_name+".txt", shapes_file, signal_shapes_file, key, luminosity);
+  }
+  cout << "Wrote " << points.size() << (points.size() == 1 ? " datacard" : " datacards")
+       << " to " << dir << endl;
+}
+
+set<const Process*> Datacard::GetProcesses() const{
+  set<const Process*> processes;
+  for(const auto &proc: backgrounds_){
+    processes.insert(proc->process_.get());
+  }
+  for(const auto &proc: signals_){
+    processes.insert(proc->process_.get());
+  }
+  for(const auto &proc: datas_){
+    processes.insert(proc->process_.get());
+  }
+  return processes;
+}
+
+vector<NamedFunc> Datacard::GetFunctions() const{
+  vector<NamedFunc> functions = keys_;
+  for(const auto &region: regions_) functions.push_back(region.cut_);
+  functions.push_back(weight_);
+  for(const auto &syst: systematics_){
+    functions.push_back(syst.up_);
+    if(syst.has_down_) functions.push_back(syst.down_);
+  }
+  if(is_shape_) functions.push_back(axis_.var_);
+  return functions;
+}
+
+Figure::FigureComponent * Datacard::GetComponent(const Process *process){
+  return const_cast<SingleDatacard*>(FindComponent(process));
+}
+
+/*!\brief Yield and uncertainty of process in each region and bin
+
+  \param[in] process Process whose yields are returned
+
+  \param[in] luminosity Luminosity by which simulated yields are scaled
+
+  \param[in] key Scan point, ignored for processes other than signals
+
+  \param[in] ivariation Index of the weight variation, 0 for nominal. See
+  Datacard::Index().
+
+  \return Yields indexed by iregion*NumBins()+ibin, zero if the point was
+  never filled
+*/
+vector<GammaParams> Datacard::Yield(const Process *process,
+                                    double luminosity,
+                                    const Key &key,
+                                    size_t ivariation) const{
+  const SingleDatacard *component = FindComponent(process);
+  if(component == nullptr) ERROR("Process "+process->name_+" is not in datacard "+name_);
+  vector<GammaParams> yields(regions_.size()*NumBins());
+  auto point = component->Points().find(process->type_ == Process::Type::signal ? key : Key());
+  if(point == component->Points().end()) return yields;
+  double scale = process->type_ == Process::Type::data ? 1. : luminosity;
+  for(size_t iregion = 0; iregion < regions_.size(); ++iregion){
+    for(size_t ibin = 0; ibin < NumBins(); ++ibin){
+      size_t index = Index(iregion, ivariation, ibin);
+      yields.at(iregion*NumBins()+ibin).SetYieldAndUncertainty(scale*point->second.sumw_.at(index),
+                                                               scale*sqrt(point->second.sumw2_.at(index)));
+    }
+  }
+  return yields;
+}
+
+/*!\brief Scan points seen by any signal process, or a single empty key if the
+  signal is not split
+*/
+set<Datacard::Key> Datacard::Points() const{
+  set<Key> points;
+  if(!keys_.empty()){
+    for(const auto &component: signals_){
+      for(const auto &point: component->Points()) points.insert(point.first);
+    }
+  }
+  if(points.empty()) points.insert(Key());
+  return points;
+}
+
+/*!\brief Name of a scan point for file names, e.g. "mprod_700_mlsp_1"
+ */
+string Datacard::PointName(const Key &key) const{
+  string name = "";
+  for(size_t ikey = 0; ikey < key.size() && ikey < keys_.size(); ++ikey){
+    if(ikey != 0) name += "_";
+    name += CodeToPlainText(keys_.at(ikey).Name())+"_"+FormatNumber(key.at(ikey), 8);
+  }
+  return name;
+}
+
+/*!\brief Number of histogram bins in each region, 1 for counting datacards
+ */
+size_t Datacard::NumBins() const{
+  return is_shape_ ? axis_.Nbins() : 1;
+}
+
+/*!\brief Number of weights recorded per entry: the nominal one and an up and
+  down variation for each systematic
+*/
+size_t Datacard::NumVariations() const{
+  return 1+2*systematics_.size();
+}
+
+/*!\brief Position of a region, variation and bin in Datacard::Point::sumw_
+
+  Variation 0 is nominal, 2*isyst+1 and 2*isyst+2 are the up and down
+  variations of systematic isyst.
+*/
+size_t Datacard::Index(size_t iregion, size_t ivariation, size_t ibin) const{
+  return (iregion*NumVariations()+ivariation)*NumBins()+ibin;
+}
+
+/*!\brief Sets scalar functions identifying the signal scan point, e.g.
+  {"mprod", "mlsp"}. One datacard is written per point.
+*/
+Datacard & Datacard::ScanKeys(const vector<NamedFunc> &keys){
+  for(const auto &key: keys) CheckScalar(key);
+  keys_ = keys;
+  return *this;
+}
+
+Datacard & Datacard::Weight(const NamedFunc &weight){
+  CheckScalar(weight);
+  weight_ = weight;
+  return *this;
+}
+
+/*!\brief Adds a nuisance parameter from weight variations, recorded in the
+  same event loop as the nominal yields
+*/
+Datacard & Datacard::AddSystematic(const Systematic &systematic){
+  CheckScalar(systematic.up_);
+  CheckScalar(systematic.down_);
+  systematics_.push_back(systematic);
+  return *this;
+}
+
+/*!\brief Adds a flat lnN uncertainty applied to all simulated processes
+ */
+Datacard & Datacard::AddLogNormal(const string &name, double kappa){
+  log_normals_.emplace_back(name, kappa);
+  return *this;
+}
+
+/*!\brief Sets whether statistical uncertainties of simulated yields are
+  included
+*/
+Datacard & Datacard::McStats(bool mc_stats){
+  mc_stats_ = mc_stats;
+  return *this;
+}
+
+void Datacard::AddProcesses(const vector<shared_ptr<Process> > &processes){
+  if(regions_.empty()) ERROR("Datacard "+name_+" needs at least one region");
+  for(const auto &process: processes){
+    switch(process->type_){
+    case Process::Type::data:
+      datas_.emplace_back(new SingleDatacard(*this, process));
+      break;
+    case Process::Type::background:
+      backgrounds_.emplace_back(new SingleDatacard(*this, process));
+      break;
+    case Process::Type::signal:
+      signals_.emplace_back(new SingleDatacard(*this, process));
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void Datacard::CheckScalar(const NamedFunc &func) const{
+  if(!func.IsScalar()) ERROR("Datacard "+name_+" needs scalar functions, but "+func.Name()+" is a vector");
+}
+
+const Datacard::SingleDatacard * Datacard::FindComponent(const Process *process) const{
+  for(const auto &list: {&backgrounds_, &signals_, &datas_}){
+    for(const auto &component: *list){
+      if(component->process_.get() == process) return component.get();
+    }
+  }
+  return nullptr;
+}
+
+/*!\brief Writes histograms region/process and region/process_systematicUp
+  (Down) for the given components, and region/data_obs if the components are
+  the backgrounds and data
+*/
+void Datacard::WriteShapes(const string &file_name,
+                           const vector<const SingleDatacard*> &components,
+                           const Key &key,
+                           double luminosity) const{
+  TFile file(file_name.c_str(), "recreate");
+  if(file.IsZombie()) ERROR("Could not open "+file_name);
+  const vector<double> &edges = axis_.Bins();
+  bool have_backgrounds = false, have_data = false;
+  for(const auto &component: components){
+    if(component->process_->type_ == Process::Type::background) have_backgrounds = true;
+    if(component->process_->type_ == Process::Type::data) have_data = true;
+  }
+  for(size_t iregion = 0; iregion < regions_.size(); ++iregion){
+    TDirectory *dir = file.mkdir(regions_.at(iregion).name_.c_str());
+    dir->cd();
+    vector<GammaParams> observed(NumBins());
+    for(const auto &component: components){
+      const Process *process = component->process_.get();
+      bool is_data = process->type_ == Process::Type::data;
+      string proc_name = CodeToPlainText(process->name_);
+      for(size_t ivar = 0; ivar < (is_data ? 1 : NumVariations()); ++ivar){
+        vector<GammaParams> yields = Yield(process, luminosity, key, ivar);
+        if(ivar == 0 && (is_data || (!have_data && have_backgrounds))){
+          for(size_t ibin = 0; ibin < NumBins(); ++ibin) observed.at(ibin) += yields.at(iregion*NumBins()+ibin);
+        }
+        if(is_data) continue;
+        string hist_name = proc_name;
+        if(ivar > 0){
+          hist_name += "_"+systematics_.at((ivar-1)/2).name_+(ivar % 2 == 1 ? "Up" : "Down");
+        }
+        TH1D hist(hist_name.c_str(), "", NumBins(), &edges.at(0));
+        for(size_t ibin = 0; ibin < NumBins(); ++ibin){
+          const GammaParams &yield = yields.at(iregion*NumBins()+ibin);
+          hist.SetBinContent(ibin+1, yield.Yield());
+          hist.SetBinError(ibin+1, yield.Uncertainty());
+        }
+        hist.Write();
+      }
+    }
+    if(have_backgrounds || have_data){
+      TH1D hist("data_obs", "", NumBins(), &edges.at(0));
+      for(size_t ibin = 0; ibin < NumBins(); ++ibin){
+        hist.SetBinContent(ibin+1, observed.at(ibin).Yield());
+        hist.SetBinError(ibin+1, observed.at(ibin).Uncertainty());
+      }
+      hist.Write();
+    }
+  }
+  file.Close();
+}
+
+/*!\brief Writes the text datacard of scan point key
+ */
+void Datacard::WriteCard(const string &file_name,
+                         const string &shapes_file,
+                         const string &signal_shapes_file,
+                         const Key &key,
+                         double luminosity) const{
+  ofstream file(file_name);
+  if(!file) ERROR("Could not open "+file_name);
+
+  // Columns are the processes in each region, signals first
+  vector<const SingleDatacard*> components;
+  for(const auto &component: signals_) components.push_back(component.get());
+  for(const auto &component: backgrounds_) components.push_back(component.get());
+  vector<vector<GammaParams> > nominal, observed(regions_.size(), vector<GammaParams>(NumBins()));
+  for(const auto &component: components){
+    nominal.push_back(Yield(component->process_.get(), luminosity, key));
+  }
+  for(size_t iregion = 0; iregion < regions_.size(); ++iregion){
+    for(size_t ibin = 0; ibin < NumBins(); ++ibin){
+      size_t index = iregion*NumBins()+ibin;
+      if(datas_.empty()){
+        for(size_t icomp = signals_.size(); icomp < components.size(); ++icomp){
+          observed.at(iregion).at(ibin) += nominal.at(icomp).at(index);
+        }
+      }else{
+        for(const auto &component: datas_){
+          observed.at(iregion).at(ibin) += Yield(component->process_.get(), 1.).at(index);
+        }
+      }
+    }
+  }
+
+  file << "# Datacard " << name_;
+  if(!key.empty()) file << " for " << PointName(key);
+  file << '\n';
+  if(datas_.empty()) file << "# No data process: the observation is the expected background\n";
+  file << "imax " << regions_.size() << "  number of channels\n"
+       << "jmax " << max(components.size(), static_cast<size_t>(1))-1 << "  number of backgrounds\n"
+       << "kmax *  number of nuisance parameters\n"
+       << "------------\n";
+  if(is_shape_){
+    vector<vector<string> > shapes;
+    shapes.push_back({"shapes", "*", "*", shapes_file, "$CHANNEL/$PROCESS", "$CHANNEL/$PROCESS_$SYSTEMATIC"});
+    for(const auto &component: signals_){
+      shapes.push_back({"shapes", CodeToPlainText(component->process_->name_), "*", signal_shapes_file,
+            "$CHANNEL/$PROCESS", "$CHANNEL/$PROCESS_$SYSTEMATIC"});
+    }
+    WriteColumns(file, shapes);
+    file << "------------\n";
+  }
+
+  vector<vector<string> > rows(2);
+  rows.at(0).push_back("bin");
+  rows.at(1).push_back("observation");
+  for(size_t iregion = 0; iregion < regions_.size(); ++iregion){
+    double total = 0.;
+    for(const auto &yield: observed.at(iregion)) total += yield.Yield();
+    rows.at(0).push_back(regions_.at(iregion).name_);
+    rows.at(1).push_back(is_shape_ ? "-1" : FormatNumber(total));
+  }
+  WriteColumns(file, rows);
+  file << "------------\n";
+
+  // Process rows and nuisances share one column per region and process
+  rows.assign(4, vector<string>());
+  rows.at(0) = {"bin", ""};
+  rows.at(1) = {"process", ""};
+  rows.at(2) = {"process", ""};
+  rows.at(3) = {"rate", ""};
+  for(size_t iregion = 0; iregion < regions_.size(); ++iregion){
+    for(size_t icomp = 0; icomp < components.size(); ++icomp){
+      double rate = 0.;
+      for(size_t ibin = 0; ibin < NumBins(); ++ibin) rate += nominal.at(icomp).at(iregion*NumBins()+ibin).Yield();
+      int index = icomp < signals_.size() ? -static_cast<int>(icomp) : static_cast<int>(icomp-signals_.size())+1;
+      rows.at(0).push_back(regions_.at(iregion).name_);
+      rows.at(1).push_back(CodeToPlainText(components.at(icomp)->process_->name_));
+      rows.at(2).push_back(to_string(index));
+      rows.at(3).push_back(is_shape_ ? "-1" : FormatNumber(rate));
+    }
+  }
+  size_t num_columns = rows.at(0).size();
+  rows.push_back(vector<string>());
+
+  for(const auto &log_normal: log_normals_){
+    vector<string> row = {log_normal.first, "lnN"};
+    row.resize(num_columns, FormatNumber(log_normal.second, 4));
+    rows.push_back(row);
+  }
+
+  for(size_t isyst = 0; isyst < systematics_.size(); ++isyst){
+    const Systematic &syst = systematics_.at(isyst);
+    vector<string> row = {syst.name_, is_shape_ ? "shape" : "lnN"};
+    for(size_t iregion = 0; iregion < regions_.size(); ++iregion){
+      for(size_t icomp = 0; icomp < components.size(); ++icomp){
+        if(is_shape_){
+          row.push_back("1");
+          continue;
+        }
+        const Process *process = components.at(icomp)->process_.get();
+        double up = Yield(process, luminosity, key, 2*isyst+1).at(iregion).Yield();
+        double down = Yield(process, luminosity, key, 2*isyst+2).at(iregion).Yield();
+        row.push_back(LogNormalKappa(nominal.at(icomp).at(iregion).Yield(), up, down, syst.has_down_));
+      }
+    }
+    rows.push_back(row);
+  }
+
+  if(mc_stats_ && !is_shape_){
+    for(size_t iregion = 0; iregion < regions_.size(); ++iregion){
+      for(size_t icomp = 0; icomp < components.size(); ++icomp){
+        const GammaParams &yield = nominal.at(icomp).at(iregion);
+        if(yield.Yield() <= 0.) continue;
+        vector<string> row = {"stat_"+regions_.at(iregion).name_+"_"
+                              +CodeToPlainText(components.at(icomp)->process_->name_), "lnN"};
+        row.resize(num_columns, "-");
+        row.at(2+iregion*components.size()+icomp) = FormatNumber(1.+yield.Uncertainty()/yield.Yield(), 4);
+        rows.push_back(row);
+      }
+    }
+  }
+  WriteColumns(file, rows);
+  if(mc_stats_ && is_shape_) file << "* autoMCStats 0\n";
+}
@@ -50,6 +50,7 @@
 
 #include "core/plot_opt.hpp"
 #include "core/utilities.hpp"
+#include "core/shard_io.hpp"
 
 using namespace PlotOptTypes;
 
@@ -69,7 +70,7 @@ EfficiencyPlot::SingleEfficiencyPlot::SingleEfficiencyPlot(
   raw_numerator_hist_(numerator_hist),
   proc_and_hist_cut_(figure.cut_ && process->cut_),
   numerator_cut_(figure.numerator_cut_),
-  cut_vector_(),
+  cut_mask_(),
   wgt_vector_(),
   val_vector_(),
   numerator_cut_vector_(){
@@ -79,6 +80,32 @@ EfficiencyPlot::SingleEfficiencyPlot::SingleEfficiencyPlot(
   raw_denominator_hist_.SetBinErrorOption(TH1::kPoisson);
 }
 
+/*!\brief EfficiencyPlot components can be merged across shards
+ */
+bool EfficiencyPlot::SingleEfficiencyPlot::CanMerge() const{
+  return true;
+}
+
+/*!\brief Writes the denominator and numerator histograms
+ */
+void EfficiencyPlot::SingleEfficiencyPlot::WriteState(std::ostream &out){
+  ShardIO::WriteHist(out, raw_denominator_hist_);
+  ShardIO::WriteHist(out, raw_numerator_hist_);
+}
+
+/*!\brief Adds histograms written by another shard
+ */
+void EfficiencyPlot::SingleEfficiencyPlot::MergeState(std::istream &in){
+  ShardIO::AddHist(in, raw_denominator_hist_);
+  ShardIO::AddHist(in, raw_numerator_hist_);
+}
+
+/*!\brief Approximate memory of the numerator and denominator histograms
+ */
+size_t EfficiencyPlot::SingleEfficiencyPlot::EstimateBytes() const{
+  return 2*(sizeof(TH1D) + 2*sizeof(double)*static_cast<size_t>(raw_denominator_hist_.GetNcells()));
+}
+
 void EfficiencyPlot::SingleEfficiencyPlot::RecordEvent(const Baby &baby){
   const EfficiencyPlot& stack = static_cast<const EfficiencyPlot&>(figure_);
   size_t min_vec_size;
@@ -88,14 +115,14 @@ void EfficiencyPlot::SingleEfficiencyPlot::RecordEvent(const Baby &baby){
   if(cut.IsScalar()){
     if(!cut.GetScalar(baby)) return;
   }else{
-    cut_vector_ = cut.GetVector(baby);
-    if(!HavePass(cut_vector_)) return;
+    cut.GetMask(baby, cut_mask_);
+    if(!HavePass(cut_mask_)) return;
     have_vec = true;
-    min_vec_size = cut_vector_.size();
+    min_vec_size = cut_mask_.Size();
   }
 
   if (numerator_cut_.IsVector()) {
-    numerator_cut_vector_ = numerator_cut_.GetVector(baby);
+    numerator_cut_.GetVector(baby, numerator_cut_vector_);
     have_vec = true;
     min_vec_size = numerator_cut_vector_.size();
   }
@@ -105,7 +132,7 @@ void EfficiencyPlot::SingleEfficiencyPlot::RecordEvent(const Baby &baby){
   if(wgt.IsScalar()){
     wgt_scalar = wgt.GetScalar(baby);
   }else{
-    wgt_vector_ = wgt.GetVector(baby);
+    wgt.GetVector(baby, wgt_vector_);
     if(!have_vec || wgt_vector_.size() < min_vec_size){
       have_vec = true;
       min_vec_size = wgt_vector_.size();
@@ -117,7 +144,7 @@ void EfficiencyPlot::SingleEfficiencyPlot::RecordEvent(const Baby &baby){
   if(val.IsScalar()){
     val_scalar = val.GetScalar(baby);
   }else{
-    val_vector_ = val.GetVector(baby);
+    val.GetVector(baby, val_vector_);
     if(!have_vec || val_vector_.size() < min_vec_size){
       have_vec = true;
       min_vec_size = val_vector_.size();
@@ -132,8 +159,9 @@ void EfficiencyPlot::SingleEfficiencyPlot::RecordEvent(const Baby &baby){
         raw_numerator_hist_.Fill(val_scalar, wgt_scalar);
     }
   }else{
-    for(size_t i = 0; i < min_vec_size; ++i){
-      if(cut.IsVector() && !cut_vector_.at(i)) continue;
+    if(cut.IsVector() && cut_mask_.Size() < min_vec_size) min_vec_size = cut_mask_.Size();
+    for(size_t i = cut.IsVector() ? cut_mask_.NextSet(0) : 0; i < min_vec_size;
+        i = cut.IsVector() ? cut_mask_.NextSet(i+1) : i+1){
       //avoid negative weight events failing numerator since these might make numerator > denominator
       //TODO: is there some alternative to deal with negative weights?
       if(wgt.IsScalar()) {
@@ -533,6 +561,10 @@ std::string EfficiencyPlot::GetTag() const{
   return tag_;
 }
 
+std::vector<NamedFunc> EfficiencyPlot::GetFunctions() const{
+  return {xaxis_.var_, cut_, numerator_cut_, weight_};
+}
+
 std::set<const Process*> EfficiencyPlot::GetProcesses() const{
   std::set<const Process*> processes;
   for(const auto &proc: backgrounds_){
@@ -0,0 +1,102 @@
+/*! \class EventBlock
+
+  \brief Structure-of-arrays buffer of scalar Baby variables for a block of
+  consecutive events
+
+  PlotMaker appends the current entry of a Baby with EventBlock::Append(),
+  which evaluates each registered column once and stores the value in a
+  contiguous array per column. When the block is full, every NamedFunc with a
+  block function (see NamedFunc::HasBlock()) is evaluated for all of its
+  events at once, and figure components that support it consume the results
+  in FigureComponent::RecordBlock(). The columns needed by a function are
+  registered with EventBlock::AddColumns().
+*/
+#include "core/event_block.hpp"
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+/*!\brief Standard constructor
+
+  \param[in] capacity Maximum number of events in the block
+*/
+EventBlock::EventBlock(size_t capacity):
+  capacity_(capacity > 0 ? capacity : 1),
+  size_(0),
+  functions_(),
+  columns_(),
+  indices_(){
+}
+
+/*!\brief Registers every column needed by the block function of function
+
+  Columns already registered are skipped. Must be called while the block is
+  empty.
+
+  \param[in] function Function whose NamedFunc::BlockColumns() are added
+*/
+void EventBlock::AddColumns(const NamedFunc &function){
+  if(size_ != 0) ERROR("Cannot add columns to a block containing events");
+  for(const auto &column: function.BlockColumns()){
+    if(indices_.count(column.Name())) continue;
+    indices_[column.Name()] = functions_.size();
+    functions_.push_back(column);
+    columns_.emplace_back(capacity_);
+  }
+}
+
+/*!\brief Stores the value of every column for the current entry of baby
+
+  \param[in] baby Baby positioned at the entry to append
+*/
+void EventBlock::Append(const Baby &baby){
+  if(Full()) ERROR("Cannot append to full block");
+  for(size_t icol = 0; icol < functions_.size(); ++icol){
+    columns_[icol][size_] = functions_[icol].GetScalar(baby);
+  }
+  ++size_;
+}
+
+/*!\brief Removes all events, keeping the registered columns
+ */
+void EventBlock::Clear(){
+  size_ = 0;
+}
+
+/*!\brief Number of events currently in the block
+ */
+size_t EventBlock::Size() const{
+  return size_;
+}
+
+/*!\brief Maximum number of events in the block
+ */
+size_t EventBlock::Capacity() const{
+  return capacity_;
+}
+
+/*!\brief Check if no more events can be appended
+ */
+bool EventBlock::Full() const{
+  return size_ >= capacity_;
+}
+
+/*!\brief Number of registered columns
+ */
+size_t EventBlock::NumColumns() const{
+  return functions_.size();
+}
+
+/*!\brief Values of a column
+
+  \param[in] name Name of the column's function
+
+  \return Array with one value per event up to EventBlock::Size(), followed by
+  unused entries
+*/
+const NamedFunc::VectorType & EventBlock::Column(const string &name) const{
+  auto index = indices_.find(name);
+  if(index == indices_.end()) ERROR("Column "+name+" was not added to the block");
+  return columns_[index->second];
+}
@@ -0,0 +1,252 @@
+/*! \class EventCache
+
+  \brief In-memory columnar copy of the branches a Baby actually uses
+
+  When caching is enabled in the PlotMaker, the first event loop over a Baby
+  records which variables are accessed and stores their values, one column per
+  variable, for every entry passing an optional preselection. Later
+  PlotMaker::MakePlots() calls in the same program iterate over the cached rows
+  only and the Baby accessors copy values out of memory instead of
+  decompressing baskets from disk.
+
+  Variables first used in a later pass are read from disk for the rows already
+  cached and appended to the cache, so a cache built for one set of plots can
+  serve any other set. A global memory budget is shared by all caches. If it is
+  exceeded while a Baby is first recorded, that Baby's cache is dropped and the
+  Baby is always read from disk. If it is exceeded while adding variables in a
+  later pass, only the new variables are left uncached.
+
+  The cache is owned by the Baby and is only ever used by the thread processing
+  that Baby, so it needs no locking apart from the shared memory counter.
+*/
+
+/*! \class EventCache::ColumnBase
+
+  \brief Type-erased interface to a single cached variable
+*/
+
+/*! \class EventCache::Column
+
+  \brief Cached values of a single variable, one per row
+
+  Vector variables are stored as a single concatenated array with the end
+  offset of each row.
+*/
+#include "core/event_cache.hpp"
+
+#include <algorithm>
+
+#include "core/baby.hpp"
+
+using namespace std;
+
+atomic<size_t> EventCache::budget_(0);
+atomic<size_t> EventCache::total_bytes_(0);
+
+/*!\brief Standard constructor
+
+  \param[in] factories Function creating the column for each Baby variable, as
+  returned by Baby::CacheColumns()
+*/
+EventCache::EventCache(const vector<ColumnFactory> &factories):
+  factories_(factories),
+  columns_(factories.size()),
+  disabled_(factories.size(), false),
+  used_(),
+  entries_(),
+  entry_(0),
+  row_(0),
+  bytes_(0),
+  active_(false),
+  recording_(false),
+  complete_(false),
+  overflow_(false){
+}
+
+EventCache::~EventCache(){
+  Release(bytes_);
+}
+
+/*!\brief Prepare cache for an event loop over its Baby
+
+  \return True if the cache is used during this loop
+*/
+bool EventCache::Start(){
+  active_ = !overflow_ && budget_ > 0;
+  recording_ = active_ && !complete_;
+  row_ = 0;
+  return active_;
+}
+
+/*!\brief Set current entry while building the list of rows
+
+  \param[in] entry TChain entry just loaded into the Baby
+*/
+void EventCache::SetEntry(long entry){
+  entry_ = entry;
+  row_ = entries_.size();
+}
+
+/*!\brief Set current row while looping over a complete cache
+
+  \param[in] row Row just loaded into the Baby
+*/
+void EventCache::SetRow(size_t row){
+  row_ = row;
+  entry_ = entries_[row];
+}
+
+/*!\brief Store variables used in current entry
+
+  Variables used for the first time are back-filled for all earlier rows by
+  reloading those entries from disk, so the Baby's current entry is reloaded
+  afterwards and any cached accessor values are lost.
+
+  \param[in,out] baby Baby owning this cache, positioned at current entry
+
+  \param[in] keep Whether current entry passes the preselection. Ignored once
+  the list of rows is complete.
+*/
+void EventCache::EndEntry(Baby &baby, bool keep){
+  if(!active_) return;
+  if(recording_){
+    if(!keep) return;
+    entries_.push_back(entry_);
+  }
+
+  size_t added = 0;
+  size_t first_missing = row_;
+  for(const auto &icol: used_){
+    first_missing = min(first_missing, columns_[icol]->Size());
+  }
+  if(first_missing < row_){
+    for(size_t row = first_missing; row < row_; ++row){
+      baby.GetEntry(entries_[row]);
+      for(const auto &icol: used_){
+        if(columns_[icol]->Size() == row) added += columns_[icol]->Append(baby);
+      }
+    }
+    baby.GetEntry(entry_);
+  }
+  for(const auto &icol: used_){
+    if(columns_[icol]->Size() == row_) added += columns_[icol]->Append(baby);
+  }
+
+  bytes_ += added;
+  if((total_bytes_ += added) <= budget_) return;
+  if(recording_){
+    Clear();
+    overflow_ = true;
+  }else{
+    DropPartialColumns(true);
+  }
+}
+
+/*!\brief Finish event loop over Baby
+
+  \param[in] full_pass Whether all entries of the Baby were processed
+*/
+void EventCache::Finish(bool full_pass){
+  if(!active_) return;
+  if(recording_){
+    if(full_pass){
+      complete_ = true;
+    }else{
+      Clear();
+    }
+  }else if(!full_pass){
+    DropPartialColumns(false);
+  }
+  recording_ = false;
+  active_ = false;
+}
+
+/*!\brief Discard all cached data and reset budget overflow
+ */
+void EventCache::Clear(){
+  Release(bytes_);
+  bytes_ = 0;
+  for(auto &column: columns_){
+    column.reset();
+  }
+  disabled_.assign(disabled_.size(), false);
+  used_.clear();
+  entries_.clear();
+  entries_.shrink_to_fit();
+  row_ = 0;
+  active_ = false;
+  recording_ = false;
+  complete_ = false;
+  overflow_ = false;
+}
+
+bool EventCache::Active() const{
+  return active_;
+}
+
+bool EventCache::Complete() const{
+  return complete_;
+}
+
+size_t EventCache::NumRows() const{
+  return entries_.size();
+}
+
+long EventCache::Entry(size_t row) const{
+  return entries_.at(row);
+}
+
+size_t EventCache::NumColumns() const{
+  return used_.size();
+}
+
+size_t EventCache::Bytes() const{
+  return bytes_;
+}
+
+/*!\brief Set maximum memory used by all caches combined
+
+  \param[in] bytes Memory budget. 0 disables caching.
+*/
+void EventCache::SetBudget(size_t bytes){
+  budget_ = bytes;
+}
+
+size_t EventCache::Budget(){
+  return budget_;
+}
+
+size_t EventCache::TotalBytes(){
+  return total_bytes_;
+}
+
+void EventCache::Touch(size_t icol){
+  if(disabled_[icol]) return;
+  columns_[icol] = factories_[icol]();
+  used_.push_back(icol);
+}
+
+void EventCache::Release(size_t bytes){
+  total_bytes_ -= bytes;
+}
+
+/*!\brief Remove columns not filled for every row
+
+  \param[in] disable If true, removed columns are never cached again
+*/
+void EventCache::DropPartialColumns(bool disable){
+  auto partial = [this](size_t icol){
+    return columns_[icol]->Size() < entries_.size();
+  };
+  for(const auto &icol: used_){
+    if(!partial(icol)) continue;
+    size_t bytes = columns_[icol]->Bytes();
+    Release(bytes);
+    bytes_ -= bytes;
+    columns_[icol].reset();
+    if(disable) disabled_[icol] = true;
+  }
+  used_.erase(remove_if(used_.begin(), used_.end(),
+                        [this](size_t icol){return columns_[icol] == nullptr;}),
+              used_.end());
+}
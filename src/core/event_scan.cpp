@@ -28,7 +28,7 @@ void EventScan::SingleScan::RecordEvent(const Baby &baby){
   if(full_cut_.IsScalar()){
     if(!full_cut_.GetScalar(baby)) return;
   }else{
-    cut_vector_ = full_cut_.GetVector(baby);
+    full_cut_.GetVector(baby, cut_vector_);
   }
   
   size_t max_size = 0;
@@ -37,7 +37,7 @@ void EventScan::SingleScan::RecordEvent(const Baby &baby){
     if(col.IsScalar()){
       if(max_size < 1) max_size = 1;
     }else{
-      val_vectors_.at(icol) = col.GetVector(baby);
+      col.GetVector(baby, val_vectors_.at(icol));
       if(val_vectors_.at(icol).size() > max_size){
         max_size = val_vectors_.at(icol).size();
       }
@@ -113,6 +113,12 @@ set<const Process*> EventScan::GetProcesses() const{
   return processes;
 }
 
+vector<NamedFunc> EventScan::GetFunctions() const{
+  vector<NamedFunc> functions = columns_;
+  functions.push_back(cut_);
+  return functions;
+}
+
 Figure::FigureComponent * EventScan::GetComponent(const Process *process){
   for(const auto &scan: scans_){
     if(scan->process_.get() == process) return scan.get();
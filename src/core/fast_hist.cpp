@@ -0,0 +1,147 @@
+/*! \class FastHist
+
+  \brief Lightweight weighted histogram filled in the event loop and added to
+  a ROOT histogram afterwards
+
+  TH1::Fill goes through virtual dispatch, a binary search over the bin edges
+  (figures always book variable-width bins, see Axis) and ROOT's bookkeeping
+  on every call. FastHist copies the binning of a TH1D or TH2D and keeps the
+  sums of weights and squared weights in contiguous arrays indexed by ROOT's
+  global bin number. For nearly equally spaced edges, as produced by
+  Axis(nbins, xmin, xmax), the bin is computed arithmetically and corrected
+  against the stored edges, so each value lands in exactly the bin TH1::Fill
+  would choose.
+
+  FastHist::AddTo() adds the bin contents, errors, statistics (sums used by
+  TH1::GetMean and TH1::GetStats) and number of entries to a ROOT histogram
+  with the same binning. Up to the order in which weights are summed, the
+  result is what the same calls to TH1::Fill would have produced.
+*/
+#include "core/fast_hist.hpp"
+
+#include <cmath>
+
+#include <iterator>
+
+#include "TArrayD.h"
+#include "TAxis.h"
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  //! Relative deviation from equal spacing below which edges count as regular
+  const double regular_tolerance = 1e-6;
+}
+
+/*!\brief Single cell, used as the y binning of 1D histograms
+ */
+FastHist::BinFinder::BinFinder():
+  nbins_(-1),
+  xmin_(0.),
+  xmax_(0.),
+  scale_(0.),
+  fixed_(false),
+  regular_(false),
+  edges_(){
+}
+
+/*!\brief Copies the binning of a ROOT axis
+
+  \param[in] axis Axis whose bins are used
+*/
+FastHist::BinFinder::BinFinder(const TAxis &axis):
+  nbins_(axis.GetNbins()),
+  xmin_(axis.GetXmin()),
+  xmax_(axis.GetXmax()),
+  scale_(nbins_/(xmax_-xmin_)),
+  fixed_(!axis.IsVariableBinSize()),
+  regular_(false),
+  edges_(){
+  if(fixed_) return;
+  for(int bin = 1; bin <= nbins_+1; ++bin){
+    edges_.push_back(axis.GetBinLowEdge(bin));
+  }
+  double width = (xmax_-xmin_)/nbins_;
+  regular_ = true;
+  for(int bin = 0; bin < nbins_ && regular_; ++bin){
+    double expected = xmin_+bin*width;
+    regular_ = fabs(edges_[bin]-expected) <= regular_tolerance*width;
+  }
+}
+
+/*!\brief Number of bins including under- and overflow
+ */
+int FastHist::BinFinder::NumCells() const{
+  return nbins_+2;
+}
+
+/*!\brief Standard constructor
+
+  \param[in] hist_template 1D or 2D histogram whose binning is used
+*/
+FastHist::FastHist(const TH1 &hist_template):
+  x_(*hist_template.GetXaxis()),
+  y_(),
+  dimension_(hist_template.GetDimension()),
+  sumw_(),
+  sumw2_(),
+  stats_(),
+  entries_(0.){
+  if(dimension_ > 2) ERROR("FastHist only supports 1D and 2D histograms");
+  if(dimension_ == 2) y_ = BinFinder(*hist_template.GetYaxis());
+  sumw_.assign(x_.NumCells()*y_.NumCells(), 0.);
+  sumw2_.assign(sumw_.size(), 0.);
+}
+
+/*!\brief Adds the contents to a ROOT histogram with the same binning
+
+  \param[in,out] hist Histogram to add to
+*/
+void FastHist::AddTo(TH1 &hist) const{
+  if(Empty()) return;
+  if(hist.GetNcells() != static_cast<int>(sumw_.size())){
+    ERROR("Histogram has "+to_string(hist.GetNcells())+" cells instead of "+to_string(sumw_.size()));
+  }
+  double stats[7] = {0., 0., 0., 0., 0., 0., 0.};
+  hist.GetStats(stats);
+  double entries = hist.GetEntries();
+  TArrayD *sumw2 = hist.GetSumw2N() > 0 ? hist.GetSumw2() : nullptr;
+  for(size_t bin = 0; bin < sumw_.size(); ++bin){
+    if(sumw_[bin] == 0. && sumw2_[bin] == 0.) continue;
+    hist.SetBinContent(bin, hist.GetBinContent(bin)+sumw_[bin]);
+    if(sumw2 != nullptr) sumw2->fArray[bin] += sumw2_[bin];
+  }
+  int num_stats = dimension_ == 2 ? 7 : 4;
+  for(int i = 0; i < num_stats; ++i){
+    stats[i] += stats_[i];
+  }
+  hist.PutStats(stats);
+  hist.SetEntries(entries+entries_);
+}
+
+/*!\brief Adds the contents to a ROOT histogram and empties this histogram
+
+  \param[in,out] hist Histogram to add to
+*/
+void FastHist::FlushTo(TH1 &hist){
+  AddTo(hist);
+  Reset();
+}
+
+/*!\brief Sets all bins, statistics and the number of entries to 0
+ */
+void FastHist::Reset(){
+  if(Empty()) return;
+  fill(sumw_.begin(), sumw_.end(), 0.);
+  fill(sumw2_.begin(), sumw2_.end(), 0.);
+  fill(begin(stats_), end(stats_), 0.);
+  entries_ = 0.;
+}
+
+/*!\brief Check if no values were filled since construction or the last reset
+ */
+bool FastHist::Empty() const{
+  return entries_ == 0.;
+}
@@ -10,3 +10,26 @@ Figure::FigureComponent::FigureComponent(const Figure &figure,
   process_(process),
   mutex_(){
 }
+
+/*!\brief Approximate memory in bytes held by the component once filled, used
+  by PlotMaker to plan event loops under a memory budget
+
+  The default covers components storing a few numbers per process.
+*/
+size_t Figure::FigureComponent::EstimateBytes() const{
+  return 1 << 12;
+}
+
+/*!\brief Writes the accumulated results for merging with other shards (see
+  ShardIO). Only valid if CanMerge() is true.
+*/
+void Figure::FigureComponent::WriteState(ostream &/*out*/){
+  ERROR("Components of this figure cannot be merged across shards");
+}
+
+/*!\brief Adds results written by WriteState() in another shard. Only valid if
+  CanMerge() is true.
+*/
+void Figure::FigureComponent::MergeState(istream &/*in*/){
+  ERROR("Components of this figure cannot be merged across shards");
+}
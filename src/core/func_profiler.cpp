@@ -0,0 +1,347 @@
+/*! \class FuncProfiler
+
+  \brief Opt-in measurement of call counts, time and pass rates of every
+  NamedFunc
+
+  When enabled, every NamedFunc built afterwards by the constructors, the
+  operators or FunctionParser wraps its functions so that each evaluation is
+  counted. One in FuncProfiler::SamplePeriod() calls is timed with
+  steady_clock, and the total time is extrapolated from the sampled calls.
+  Times are inclusive: a cut "a&&b" includes the time spent in "a" and "b".
+  For scalar functions and vector elements, the fraction of non-zero results is
+  reported as the pass rate if all results were 0 or 1.
+
+  Since instrumentation happens when a NamedFunc is built, the profiler must be
+  enabled before the functions of interest are constructed, either by calling
+  FuncProfiler::Enable() at the start of the program or by setting the
+  environment variable NAMEDFUNC_PROFILE=1, which also covers NamedFuncs built
+  during static initialization. Turning the profiler on or off clears the cache
+  of parsed expressions, so strings parsed before are parsed again. Disabled, the profiler adds no cost to
+  evaluation.
+
+  Counters are kept per thread and per function and are only summed when a
+  report is made, so the report must be made while no events are processed.
+  Functions are reported under the name they had when built, and functions with
+  the same name are reported together. Calls to single vector elements are
+  reported separately from calls building the full vector, with "[i]"
+  appended to the name.
+*/
+#include "core/func_profiler.hpp"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "core/utilities.hpp"
+#include "core/function_parser.hpp"
+
+using namespace std;
+
+using ScalarType = NamedFunc::ScalarType;
+using VectorType = NamedFunc::VectorType;
+using ScalarFunc = NamedFunc::ScalarFunc;
+using VectorFunc = NamedFunc::VectorFunc;
+using ElementFunc = NamedFunc::ElementFunc;
+
+namespace{
+  using Clock = chrono::steady_clock;
+
+  /*!\brief Counters for one registered function in one thread
+   */
+  struct Stats{
+    long calls_;//!<Number of evaluations
+    long timed_calls_;//!<Number of evaluations that were timed
+    double timed_seconds_;//!<Total time of timed evaluations
+    long results_;//!<Number of scalar results seen
+    long passes_;//!<Number of non-zero scalar results
+    long non_boolean_;//!<Number of scalar results other than 0 or 1
+  };
+
+  /*!\brief Counters of one thread, indexed by function id
+
+    A deque so that references stay valid when functions registered during
+    evaluation extend it.
+  */
+  using Buffer = deque<Stats>;
+
+  /*!\brief Summed counters of all functions with the same name
+   */
+  struct Entry{
+    string name_;
+    long calls_;
+    double seconds_;
+    long results_;
+    long passes_;
+    long non_boolean_;
+  };
+
+  //Function-local statics, since NamedFuncs may be built during static initialization
+  atomic<bool> & EnabledFlag(){
+    static atomic<bool> enabled([](){
+        const char *env = getenv("NAMEDFUNC_PROFILE");
+        return env != nullptr && string(env) != "" && string(env) != "0";
+      }());
+    return enabled;
+  }
+
+  atomic<unsigned long> & Period(){
+    static atomic<unsigned long> period(16);
+    return period;
+  }
+
+  mutex & RegistryMutex(){
+    static mutex m;
+    return m;
+  }
+
+  vector<string> & Names(){
+    static vector<string> names;
+    return names;
+  }
+
+  map<string, size_t> & Ids(){
+    static map<string, size_t> ids;
+    return ids;
+  }
+
+  vector<shared_ptr<Buffer> > & Buffers(){
+    static vector<shared_ptr<Buffer> > buffers;
+    return buffers;
+  }
+
+  Stats & GetStats(size_t id){
+    thread_local shared_ptr<Buffer> buffer;
+    if(!buffer){
+      buffer = make_shared<Buffer>();
+      lock_guard<mutex> lock(RegistryMutex());
+      Buffers().push_back(buffer);
+    }
+    if(id >= buffer->size()) buffer->resize(id+1, Stats{0, 0, 0., 0, 0, 0});
+    return (*buffer)[id];
+  }
+
+  void RecordResult(Stats &stats, ScalarType result){
+    ++stats.results_;
+    if(result != 0.) ++stats.passes_;
+    if(result != 0. && result != 1.) ++stats.non_boolean_;
+  }
+
+  /*!\brief Evaluate call, timing it if it is selected by the sampling period
+   */
+  template<typename Call>
+  auto Timed(Stats &stats, const Call &call) -> decltype(call()){
+    if(stats.calls_++ % Period().load(memory_order_relaxed) != 0) return call();
+    auto start = Clock::now();
+    auto result = call();
+    stats.timed_seconds_ += chrono::duration<double>(Clock::now()-start).count();
+    ++stats.timed_calls_;
+    return result;
+  }
+
+  vector<Entry> Collect(){
+    lock_guard<mutex> lock(RegistryMutex());
+    const vector<string> &names = Names();
+    map<string, Entry> entries;
+    for(size_t id = 0; id < names.size(); ++id){
+      Stats total{0, 0, 0., 0, 0, 0};
+      for(const auto &buffer: Buffers()){
+        if(id >= buffer->size()) continue;
+        const Stats &stats = (*buffer)[id];
+        total.calls_ += stats.calls_;
+        total.timed_calls_ += stats.timed_calls_;
+        total.timed_seconds_ += stats.timed_seconds_;
+        total.results_ += stats.results_;
+        total.passes_ += stats.passes_;
+        total.non_boolean_ += stats.non_boolean_;
+      }
+      if(total.calls_ == 0) continue;
+      double seconds = total.timed_calls_ > 0
+        ? total.timed_seconds_*total.calls_/total.timed_calls_ : 0.;
+      Entry &entry = entries.emplace(names.at(id), Entry{names.at(id), 0, 0., 0, 0, 0}).first->second;
+      entry.calls_ += total.calls_;
+      entry.seconds_ += seconds;
+      entry.results_ += total.results_;
+      entry.passes_ += total.passes_;
+      entry.non_boolean_ += total.non_boolean_;
+    }
+    vector<Entry> result;
+    for(const auto &entry: entries){
+      result.push_back(entry.second);
+    }
+    stable_sort(result.begin(), result.end(),
+                [](const Entry &a, const Entry &b){return a.seconds_ > b.seconds_;});
+    return result;
+  }
+
+  bool IsBoolean(const Entry &entry){
+    return entry.results_ > 0 && entry.non_boolean_ == 0;
+  }
+
+  string JsonEscape(const string &s){
+    string result;
+    for(const auto &c: s){
+      if(c == '"' || c == '\\') result += '\\';
+      result += c;
+    }
+    return result;
+  }
+}
+
+/*!\brief Turn instrumentation of subsequently built NamedFuncs on or off
+
+  \param[in] enable Whether to instrument
+*/
+void FuncProfiler::Enable(bool enable){
+  if(EnabledFlag().exchange(enable) != enable) FunctionParser::ClearCache();
+}
+
+bool FuncProfiler::Enabled(){
+  return EnabledFlag().load(memory_order_relaxed);
+}
+
+/*!\brief Set how often calls are timed
+
+  \param[in] period Time one in every period calls. 1 times every call.
+*/
+void FuncProfiler::SamplePeriod(unsigned long period){
+  Period() = max(period, 1ul);
+}
+
+unsigned long FuncProfiler::SamplePeriod(){
+  return Period();
+}
+
+/*!\brief Get id for instrumented functions reported under name
+
+  Functions registered with the same name share an id, so building a
+  NamedFunc through several setters does not leave unused ids behind.
+
+  \param[in] name Name under which function is reported
+
+  \return Id to pass to FuncProfiler::Wrap()
+*/
+size_t FuncProfiler::Register(const string &name){
+  lock_guard<mutex> lock(RegistryMutex());
+  auto id = Ids().emplace(name, Names().size());
+  if(id.second) Names().push_back(name);
+  return id.first->second;
+}
+
+/*!\brief Get scalar function recording calls, time and results of function
+
+  \param[in] id Id returned by FuncProfiler::Register()
+
+  \param[in] function Function to instrument
+
+  \return Instrumented function
+*/
+function<ScalarFunc> FuncProfiler::Wrap(size_t id, const function<ScalarFunc> &function){
+  return [id, function](const Baby &b){
+    Stats &stats = GetStats(id);
+    ScalarType result = Timed(stats, [&](){return function(b);});
+    RecordResult(stats, result);
+    return result;
+  };
+}
+
+/*!\brief Get vector function recording calls and time of function
+
+  \param[in] id Id returned by FuncProfiler::Register()
+
+  \param[in] function Function to instrument
+
+  \return Instrumented function
+*/
+function<VectorFunc> FuncProfiler::Wrap(size_t id, const function<VectorFunc> &function){
+  return [id, function](const Baby &b){
+    Stats &stats = GetStats(id);
+    return Timed(stats, [&](){return function(b);});
+  };
+}
+
+/*!\brief Get element function recording calls, time and results of function
+
+  \param[in] id Id returned by FuncProfiler::Register()
+
+  \param[in] function Function to instrument
+
+  \return Instrumented function
+*/
+function<ElementFunc> FuncProfiler::Wrap(size_t id, const function<ElementFunc> &function){
+  return [id, function](const Baby &b, size_t i){
+    Stats &stats = GetStats(id);
+    ScalarType result = Timed(stats, [&](){return function(b, i);});
+    RecordResult(stats, result);
+    return result;
+  };
+}
+
+/*!\brief Zero all counters
+ */
+void FuncProfiler::Reset(){
+  lock_guard<mutex> lock(RegistryMutex());
+  for(auto &buffer: Buffers()){
+    fill(buffer->begin(), buffer->end(), Stats{0, 0, 0., 0, 0, 0});
+  }
+}
+
+/*!\brief Print functions ranked by total time
+
+  \param[in,out] stream Stream to print to
+
+  \param[in] max_lines Maximum number of functions to print
+*/
+void FuncProfiler::Report(ostream &stream, size_t max_lines){
+  vector<Entry> entries = Collect();
+  if(entries.size() == 0) return;
+  stream << "NamedFunc profile (inclusive time, 1 in " << SamplePeriod() << " calls timed):" << endl;
+  stream << setw(12) << "Time [s]" << setw(14) << "Calls" << setw(12) << "ns/call"
+         << setw(10) << "Pass" << "  Function" << endl;
+  for(size_t i = 0; i < entries.size() && i < max_lines; ++i){
+    const Entry &entry = entries.at(i);
+    stream << setw(12) << RoundNumber(entry.seconds_, 3)
+           << setw(14) << entry.calls_
+           << setw(12) << RoundNumber(1e9*entry.seconds_/entry.calls_, 1)
+           << setw(10) << (IsBoolean(entry) ? string(RoundNumber(100.*entry.passes_/entry.results_, 1).Data())+"%" : string("-"))
+           << "  " << entry.name_ << endl;
+  }
+  if(entries.size() > max_lines){
+    stream << "... " << entries.size()-max_lines << " more functions" << endl;
+  }
+}
+
+/*!\brief Write counters of all functions to a JSON file
+
+  \param[in] file_name Path of output file
+*/
+void FuncProfiler::WriteJson(const string &file_name){
+  vector<Entry> entries = Collect();
+  ofstream file(file_name);
+  if(!file) ERROR("Could not open "+file_name);
+  file << "{\"sample_period\": " << SamplePeriod() << ", \"functions\": [";
+  for(size_t i = 0; i < entries.size(); ++i){
+    const Entry &entry = entries.at(i);
+    file << (i == 0 ? "\n" : ",\n")
+         << "  {\"name\": \"" << JsonEscape(entry.name_) << "\""
+         << ", \"calls\": " << entry.calls_
+         << ", \"seconds\": " << entry.seconds_
+         << ", \"pass_rate\": ";
+    if(IsBoolean(entry)){
+      file << static_cast<double>(entry.passes_)/entry.results_;
+    }else{
+      file << "null";
+    }
+    file << "}";
+  }
+  file << "\n]}" << endl;
+  cout << "Wrote NamedFunc profile to " << file_name << endl;
+}
@@ -14,18 +14,49 @@
 
   Parentheses and brackets are parsed recursively and can be arbitrarily nested.
 
-  Currently has support for the basic arithmetic, logical, and comparison
-  operators. Future versions may support ROOT's function syntax,
-  e.g. Sum\$(jets_pt).
+  Supports the basic arithmetic, logical, and comparison operators, the
+  conditional operator "c ? a : b", the math functions abs, sqrt, pow, min and
+  max, and ROOT's reductions over vectors Sum\$, Max\$, Min\$, Length\$,
+  Any\$ and All\$, e.g. "Sum\$(photon_sig && photon_pt>15)". Math functions
+  and the conditional operator act element-wise when given vectors. Reductions
+  of a scalar treat it as a vector of length one, and Max\$ and Min\$ of an
+  empty vector return 0.
+
+  Names defined with ObjectSelection::Define() resolve to the mask of selected
+  objects, and "Count\$(sel)", "Leading\$(sel)" and "Sum\$(x, sel)" give the
+  number of objects, index of the first object and sum of x over the objects
+  selected by sel, read from the selection computed once per event.
+
+  Functions and operators on Baby vectors go through single element access
+  (see NamedFunc::ElementFunction()), so reductions read directly from branch
+  storage without building intermediate vectors.
+
+  Parsed expressions are interned in a process-wide cache keyed on the string
+  with whitespace removed (see FunctionParser::Intern()). Constructing a
+  NamedFunc from a string that was already parsed, or containing a
+  parenthesized group or function argument that was already parsed, copies the
+  cached result instead of running the parser again. The cache is cleared
+  when an ObjectSelection is defined and when FuncProfiler is turned on or
+  off, since both change what a string parses to.
 */
 #include "core/function_parser.hpp"
 
 #include <cstdlib>
 #include <cctype>
+#include <cmath>
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
 
 #include "core/utilities.hpp"
 #include "core/named_func.hpp"
 #include "core/functions.hpp"
+#include "core/object_selection.hpp"
+#include "core/vector_arena.hpp"
 
 using namespace std;
 
@@ -33,6 +64,303 @@ using ScalarType = NamedFunc::ScalarType;
 using VectorType = NamedFunc::VectorType;
 using ScalarFunc = NamedFunc::ScalarFunc;
 using VectorFunc = NamedFunc::VectorFunc;
+using SizeFunc = NamedFunc::SizeFunc;
+using ElementFunc = NamedFunc::ElementFunc;
+using ResultType = NamedFunc::ResultType;
+
+namespace{
+  using UnaryOp = ScalarType (*)(ScalarType);
+  using BinaryOp = ScalarType (*)(ScalarType, ScalarType);
+
+  enum class Reduction{sum, max, min, length, any, all};
+
+  /*!\brief Result type of an operation on values of types a and b that keeps
+    integers integer, e.g. min, max or a ternary
+  */
+  ResultType CommonType(ResultType a, ResultType b){
+    if(a == b) return a;
+    if(a == ResultType::real || b == ResultType::real) return ResultType::real;
+    return ResultType::integer;
+  }
+
+  /*!\brief Check if name refers to a function supported by the parser
+   */
+  bool IsFunctionName(const string &name){
+    static const set<string> names = {"Sum$", "Max$", "Min$", "Length$", "Any$", "All$",
+                                      "Count$", "Leading$",
+                                      "abs", "sqrt", "pow", "min", "max"};
+    return names.find(name) != names.end();
+  }
+
+  /*!\brief Reduce size elements obtained from get to a single value
+
+    \param[in] type Reduction to perform
+
+    \param[in] size Number of elements
+
+    \param[in] get Callable returning element i
+
+    \return Result of reduction
+  */
+  template<typename Getter>
+    ScalarType Reduce(Reduction type, size_t size, const Getter &get){
+    switch(type){
+    case Reduction::length:
+      return size;
+    case Reduction::sum:{
+      ScalarType sum = 0.;
+      for(size_t i = 0; i < size; ++i) sum += get(i);
+      return sum;
+    }
+    case Reduction::max:{
+      if(size == 0) return 0.;
+      ScalarType result = get(0);
+      for(size_t i = 1; i < size; ++i) result = max(result, get(i));
+      return result;
+    }
+    case Reduction::min:{
+      if(size == 0) return 0.;
+      ScalarType result = get(0);
+      for(size_t i = 1; i < size; ++i) result = min(result, get(i));
+      return result;
+    }
+    case Reduction::any:
+      for(size_t i = 0; i < size; ++i){
+        if(get(i)) return 1.;
+      }
+      return 0.;
+    case Reduction::all:
+      for(size_t i = 0; i < size; ++i){
+        if(!get(i)) return 0.;
+      }
+      return 1.;
+    default:
+      ERROR("Unknown reduction");
+      return 0.;
+    }
+  }
+
+  /*!\brief Get scalar NamedFunc reducing f with given reduction
+   */
+  NamedFunc ApplyReduction(const string &name, const NamedFunc &f, Reduction type){
+    if(f.IsScalar()){
+      function<ScalarFunc> sf = f.ScalarFunction();
+      return NamedFunc(name, [sf,type](const Baby &b){
+          return Reduce(type, 1, [&](size_t){return sf(b);});
+        });
+    }else if(f.HasElements()){
+      function<SizeFunc> size = f.SizeFunction();
+      function<ElementFunc> element = f.ElementFunction();
+      return NamedFunc(name, [size,element,type](const Baby &b){
+          return Reduce(type, size(b), [&](size_t i){return element(b, i);});
+        });
+    }else{
+      function<VectorFunc> vf = f.VectorFunction();
+      return NamedFunc(name, [vf,type](const Baby &b){
+          VectorType v = vf(b);
+          ScalarType result = Reduce(type, v.size(), [&](size_t i){return v[i];});
+          VectorArena::Recycle(v);
+          return result;
+        });
+    }
+  }
+
+  /*!\brief Get element access to f, broadcasting scalars
+
+    \return Size and element functions. Scalars get unbounded size. Both are
+    invalid for vectors without element access.
+  */
+  pair<function<SizeFunc>, function<ElementFunc> > ElementAccess(const NamedFunc &f){
+    if(f.HasElements()) return make_pair(f.SizeFunction(), f.ElementFunction());
+    if(!f.IsScalar()) return make_pair(function<SizeFunc>(), function<ElementFunc>());
+    function<ScalarFunc> sf = f.ScalarFunction();
+    function<SizeFunc> size = [](const Baby &){return numeric_limits<size_t>::max();};
+    function<ElementFunc> element = [sf](const Baby &b, size_t){return sf(b);};
+    return make_pair(size, element);
+  }
+
+  /*!\brief Get NamedFunc applying op to f, element-wise for vectors
+   */
+  NamedFunc ApplyUnaryFunction(const string &name, const NamedFunc &f, UnaryOp op){
+    if(f.IsScalar()){
+      function<ScalarFunc> sf = f.ScalarFunction();
+      return NamedFunc(name, [sf,op](const Baby &b){
+          return op(sf(b));
+        });
+    }else if(f.HasElements()){
+      function<ElementFunc> element = f.ElementFunction();
+      return NamedFunc(name, f.SizeFunction(), [element,op](const Baby &b, size_t i){
+          return op(element(b, i));
+        });
+    }else{
+      function<VectorFunc> vf = f.VectorFunction();
+      return NamedFunc(name, [vf,op](const Baby &b){
+          VectorType v = vf(b);
+          for(auto &x: v) x = op(x);
+          return v;
+        });
+    }
+  }
+
+  /*!\brief Get NamedFunc applying op to f and g, element-wise for vectors
+   */
+  NamedFunc ApplyBinaryFunction(const string &name, const NamedFunc &f, const NamedFunc &g, BinaryOp op){
+    if(f.IsScalar() && g.IsScalar()){
+      function<ScalarFunc> sf = f.ScalarFunction();
+      function<ScalarFunc> sg = g.ScalarFunction();
+      return NamedFunc(name, [sf,sg,op](const Baby &b){
+          return op(sf(b), sg(b));
+        });
+    }
+    auto ef = ElementAccess(f);
+    auto eg = ElementAccess(g);
+    if(ef.first && eg.first){
+      function<SizeFunc> size_f = ef.first, size_g = eg.first;
+      function<ElementFunc> elem_f = ef.second, elem_g = eg.second;
+      return NamedFunc(name,
+                       [size_f,size_g](const Baby &b){
+                         return min(size_f(b), size_g(b));
+                       },
+                       [elem_f,elem_g,op](const Baby &b, size_t i){
+                         return op(elem_f(b, i), elem_g(b, i));
+                       });
+    }
+    return NamedFunc(name, [f,g,op](const Baby &b){
+        VectorType vf = f.IsVector() ? f.GetVector(b) : VectorType();
+        VectorType vg = g.IsVector() ? g.GetVector(b) : VectorType();
+        ScalarType sf = f.IsScalar() ? f.GetScalar(b) : 0.;
+        ScalarType sg = g.IsScalar() ? g.GetScalar(b) : 0.;
+        size_t size = f.IsScalar() ? vg.size() : g.IsScalar() ? vf.size() : min(vf.size(), vg.size());
+        VectorType result = VectorArena::Get(size);
+        for(size_t i = 0; i < size; ++i){
+          result[i] = op(f.IsScalar() ? sf : vf[i], g.IsScalar() ? sg : vg[i]);
+        }
+        VectorArena::Recycle(vf);
+        VectorArena::Recycle(vg);
+        return result;
+      });
+  }
+
+  /*!\brief Get NamedFunc returning if_true where condition holds and if_false
+    elsewhere
+
+    Only the selected branch is evaluated for scalars, and for each element when
+    all operands provide element access, so "n>0 ? x[0] : -1" is safe.
+  */
+  NamedFunc ApplyConditional(const string &name, const NamedFunc &condition,
+                             const NamedFunc &if_true, const NamedFunc &if_false){
+    if(condition.IsScalar() && if_true.IsScalar() && if_false.IsScalar()){
+      function<ScalarFunc> sc = condition.ScalarFunction();
+      function<ScalarFunc> st = if_true.ScalarFunction();
+      function<ScalarFunc> sf = if_false.ScalarFunction();
+      return NamedFunc(name, [sc,st,sf](const Baby &b){
+          return sc(b) ? st(b) : sf(b);
+        });
+    }
+    auto ec = ElementAccess(condition);
+    auto et = ElementAccess(if_true);
+    auto ef = ElementAccess(if_false);
+    if(ec.first && et.first && ef.first){
+      function<SizeFunc> size_c = ec.first, size_tr = et.first, size_f = ef.first;
+      function<ElementFunc> elem_c = ec.second, elem_t = et.second, elem_f = ef.second;
+      return NamedFunc(name,
+                       [size_c,size_tr,size_f](const Baby &b){
+                         return min(size_c(b), min(size_tr(b), size_f(b)));
+                       },
+                       [elem_c,elem_t,elem_f](const Baby &b, size_t i){
+                         return elem_c(b, i) ? elem_t(b, i) : elem_f(b, i);
+                       });
+    }
+    return NamedFunc(name, [condition,if_true,if_false](const Baby &b){
+        const NamedFunc *funcs[3] = {&condition, &if_true, &if_false};
+        VectorType vecs[3];
+        size_t size = numeric_limits<size_t>::max();
+        for(size_t ifunc = 0; ifunc < 3; ++ifunc){
+          if(!funcs[ifunc]->IsVector()) continue;
+          funcs[ifunc]->GetVector(b, vecs[ifunc]);
+          size = min(size, vecs[ifunc].size());
+        }
+        auto get = [&](size_t ifunc, size_t i){
+          return funcs[ifunc]->IsVector() ? vecs[ifunc][i] : funcs[ifunc]->GetScalar(b);
+        };
+        VectorType result = VectorArena::Get(size);
+        for(size_t i = 0; i < size; ++i){
+          result[i] = get(0, i) ? get(1, i) : get(2, i);
+        }
+        for(auto &vec: vecs) VectorArena::Recycle(vec);
+        return result;
+      });
+  }
+
+  /*!\brief Name of the object selection passed as argument to func_name
+   */
+  string SelectionName(const NamedFunc &arg, const string &func_name, const string &name){
+    if(!ObjectSelection::Exists(arg.Name())){
+      ERROR(arg.Name()+" in \""+name+"\" is not an object selection as required by "+func_name+".");
+    }
+    return arg.Name();
+  }
+
+  /*!\brief Build NamedFunc for call to a supported function
+
+    \param[in] func_name Name of function, e.g. "Sum$"
+
+    \param[in] args Parsed arguments
+
+    \param[in] name String representation of the full call
+
+    \return NamedFunc evaluating the call
+  */
+  NamedFunc BuildFunction(const string &func_name, const vector<NamedFunc> &args, const string &name){
+    size_t num_args = (func_name == "pow" || func_name == "min" || func_name == "max") ? 2 : 1;
+    if(func_name == "Sum$" && args.size() == 2) num_args = 2;
+    if(args.size() != num_args){
+      ERROR(func_name+" takes "+to_string(num_args)+" argument(s), but "
+            +to_string(args.size())+" were given in \""+name+"\".");
+    }
+    ResultType type = args.at(0).Type();
+    ResultType counted = CommonType(type, ResultType::integer);
+    if(func_name == "Sum$" && args.size() == 2){
+      return ObjectSelection::Sum(SelectionName(args.at(1), func_name, name), args.at(0)).Name(name);
+    }
+    if(func_name == "Count$") return ObjectSelection::Count(SelectionName(args.at(0), func_name, name)).Name(name);
+    if(func_name == "Leading$") return ObjectSelection::Leading(SelectionName(args.at(0), func_name, name)).Name(name);
+    if(func_name == "Sum$") return ApplyReduction(name, args.at(0), Reduction::sum).Type(counted);
+    if(func_name == "Max$") return ApplyReduction(name, args.at(0), Reduction::max).Type(type);
+    if(func_name == "Min$") return ApplyReduction(name, args.at(0), Reduction::min).Type(type);
+    if(func_name == "Length$") return ApplyReduction(name, args.at(0), Reduction::length).Type(ResultType::integer);
+    if(func_name == "Any$") return ApplyReduction(name, args.at(0), Reduction::any).Type(ResultType::boolean);
+    if(func_name == "All$") return ApplyReduction(name, args.at(0), Reduction::all).Type(ResultType::boolean);
+    if(func_name == "abs") return ApplyUnaryFunction(name, args.at(0), static_cast<UnaryOp>(fabs)).Type(counted);
+    if(func_name == "sqrt") return ApplyUnaryFunction(name, args.at(0), static_cast<UnaryOp>(sqrt));
+    if(func_name == "pow") return ApplyBinaryFunction(name, args.at(0), args.at(1), static_cast<BinaryOp>(pow));
+    if(func_name == "min") return ApplyBinaryFunction(name, args.at(0), args.at(1), static_cast<BinaryOp>(fmin))
+                             .Type(CommonType(type, args.at(1).Type()));
+    if(func_name == "max") return ApplyBinaryFunction(name, args.at(0), args.at(1), static_cast<BinaryOp>(fmax))
+                             .Type(CommonType(type, args.at(1).Type()));
+    ERROR("Unknown function "+func_name);
+    return NamedFunc(name, [](const Baby &){return 0.;});
+  }
+}
+
+namespace{
+  /*!\brief Mutex protecting the interned expressions
+
+    Function-local static so that NamedFuncs constructed from strings during
+    static initialization in other translation units can use the cache.
+  */
+  mutex & InternMutex(){
+    static mutex m;
+    return m;
+  }
+
+  /*!\brief Interned expressions keyed on string with whitespace removed
+   */
+  unordered_map<string, shared_ptr<const NamedFunc> > & InternedFuncs(){
+    static unordered_map<string, shared_ptr<const NamedFunc> > funcs;
+    return funcs;
+  }
+}
 
 /*!\brief Standard constructor from string representing a function
 
@@ -91,6 +419,63 @@ NamedFunc FunctionParser::ResolveAsNamedFunc() const{
                 });
 }
 
+/*!\brief Gets shared, parsed NamedFunc for a string, parsing it only once
+
+  Thread-safe. Strings differing only in whitespace share the same NamedFunc,
+  so the returned pointer can be used to identify identical expressions.
+
+  \param[in] function_string String representing a number, variable, function,
+  cut, etc.
+
+  \return Pointer to cached NamedFunc for function_string
+*/
+shared_ptr<const NamedFunc> FunctionParser::Intern(const string &function_string){
+  string key = function_string;
+  ReplaceAll(key, " ", "");
+  return Intern(key, [&key](){
+      return FunctionParser(key).ResolveAsNamedFunc();
+    });
+}
+
+/*!\brief Discards all interned expressions
+
+  Pointers previously returned by FunctionParser::Intern() remain valid.
+*/
+void FunctionParser::ClearCache(){
+  lock_guard<mutex> lock(InternMutex());
+  InternedFuncs().clear();
+}
+
+/*!\brief Get number of interned expressions, including sub-expressions
+ */
+size_t FunctionParser::CacheSize(){
+  lock_guard<mutex> lock(InternMutex());
+  return InternedFuncs().size();
+}
+
+/*!\brief Look up key in cache, calling parse and storing result on a miss
+
+  The lock is not held while parsing, since parsing interns sub-expressions. If
+  two threads parse the same string, the first result stored is kept.
+
+  \param[in] key Whitespace-free string representation
+
+  \param[in] parse Function producing the NamedFunc for key
+
+  \return Pointer to cached NamedFunc for key
+*/
+shared_ptr<const NamedFunc> FunctionParser::Intern(const string &key,
+                                                    const function<NamedFunc()> &parse){
+  {
+    lock_guard<mutex> lock(InternMutex());
+    auto found = InternedFuncs().find(key);
+    if(found != InternedFuncs().end()) return found->second;
+  }
+  auto func = make_shared<const NamedFunc>(parse());
+  lock_guard<mutex> lock(InternMutex());
+  return InternedFuncs().emplace(key, func).first->second;
+}
+
 /*!\brief Constructs FunctionParser from list of \link Token Tokens\endlink
 
   Used by FunctionParser to recursively process lists of \link Token
@@ -136,7 +521,8 @@ void FunctionParser::Tokenize() const{
     }else if(isalpha(start_char) || start_char == '_'){
       size_t count = 1;
       while(start+count < input_string_.size()
-            && (isalnum(input_string_[start+count]) || input_string_[start+count] == '_')){
+            && (isalnum(input_string_[start+count]) || input_string_[start+count] == '_'
+                || input_string_[start+count] == '$')){
         ++count;
       }
       tokens_.push_back(Token(input_string_.substr(start, count), Token::Type::variable_name));
@@ -181,43 +567,92 @@ void FunctionParser::ResolveVariables() const{
     if(token.type_ == Token::Type::variable_name){
       // if(Functions::func_map.find(token.string_rep_) != Functions::func_map.end()){
       // 	token = Functions::func_map.at(token.string_rep_);
-      if(token.string_rep_ == "SampleType"){
+      if(IsFunctionName(token.string_rep_)){
+        token.type_ = Token::Type::function_name;
+      } else if(token.string_rep_ == "SampleType"){
         token = Functions::SampleType;
       } else if(token.string_rep_ == "boostSignalRegion"){
         token = Functions::boostSignalRegion;
       } else if(token.string_rep_ == "boostControlRegion"){
         token = Functions::boostControlRegion;
       }
+      else if(ObjectSelection::Exists(token.string_rep_)){
+        token.function_ = ObjectSelection::Mask(token.string_rep_);
+        token.type_ = Token::Type::resolved_vector;
+      }
       else {
-        token.function_ = Baby::GetFunction(token.string_rep_);
+        token.function_ = Baby::GetFunction(token.string_rep_).Pure(true).BlockColumn();
         token.type_ = token.function_.IsScalar() ? Token::Type::resolved_scalar : Token::Type::resolved_vector;
       }
     }else if(token.type_ == Token::Type::number){
       char *cp = nullptr;
       NamedFunc::ScalarType val = strtod(&token.string_rep_[0], &cp);
-      token.function_ = NamedFunc(token.string_rep_,
-                                  [val](const Baby &){
-                                    return val;
-                                  });
+      token.function_ = NamedFunc(val).Name(token.string_rep_);
       token.type_ = Token::Type::resolved_scalar;
     }
   }
 }
 
 /*!\brief Recursively evaluates contents of parenthesis and brackets
- */
+
+  Parentheses following a function name are evaluated as an argument list and
+  merged with the function name into a single Token.
+*/
 void FunctionParser::EvaluateGroupings() const{
   for(size_t i_open = 0; i_open < tokens_.size(); ++i_open){
     size_t i_close = FindClose(i_open);
     if(i_close <= i_open || i_close >= tokens_.size()) continue;
 
-    FunctionParser fp(vector<Token>(tokens_.cbegin()+i_open+1, tokens_.cbegin()+i_close));
-    Token merged = fp.ResolveAsToken();
+    if(i_open > 0
+       && tokens_.at(i_open-1).type_ == Token::Type::function_name
+       && tokens_.at(i_open).type_ == Token::Type::open_paren){
+      ApplyFunction(i_open-1, i_close);
+      --i_open;
+      continue;
+    }
+
+    Token merged;
+    if(i_close > i_open+1) merged = Token(*InternRange(i_open+1, i_close));
 
     CondenseTokens(i_open+1, i_close, merged);
   }
 }
 
+/*!\brief Replaces a function call with a single Token
+
+  \param[in] i_func Position of function name Token
+
+  \param[in] i_close Position of parenthesis closing the argument list
+*/
+void FunctionParser::ApplyFunction(size_t i_func, size_t i_close) const{
+  const string func_name = tokens_.at(i_func).string_rep_;
+  vector<NamedFunc> args;
+  size_t i_start = i_func+2;
+  int depth = 0;
+  for(size_t i = i_start; i <= i_close; ++i){
+    Token::Type type = tokens_.at(i).type_;
+    if(i == i_close || (depth == 0 && type == Token::Type::comma)){
+      if(i == i_start){
+        ERROR("Empty argument to "+func_name+" in \""+input_string_+"\".");
+      }
+      args.push_back(*InternRange(i_start, i));
+      i_start = i+1;
+    }else if(type == Token::Type::open_paren || type == Token::Type::open_square){
+      ++depth;
+    }else if(type == Token::Type::close_paren || type == Token::Type::close_square){
+      --depth;
+    }
+  }
+
+  string name = ConcatenateTokenStrings(i_func, i_close+1);
+  bool pure = true;
+  for(const auto &arg: args){
+    pure = pure && arg.IsPure();
+  }
+  Token merged(BuildFunction(func_name, args, name).Pure(pure));
+  CondenseTokens(i_func, i_close+1, merged);
+}
+
 /*!\brief Merges parenthesis \link Token Tokens\endlink with the contents
 
   Searches for patten {open paren}{value}{close paren} and replaces with single
@@ -265,13 +700,8 @@ void FunctionParser::ApplySubscripts() const{
       continue;
     }
 
-    function<VectorFunc> vec_func = vec.function_.VectorFunction();
-    function<ScalarFunc> sub_func = sub.function_.ScalarFunction();
-    function<ScalarFunc> function = [vec_func,sub_func](const Baby &b){
-      return vec_func(b).at(sub_func(b));
-    };
     string name = ConcatenateTokenStrings(i, i+4);
-    Token merged(NamedFunc(name, function));
+    Token merged(vec.function_[sub.function_].Name(name));
 
     CondenseTokens(i, i+4, merged);
   }
@@ -329,6 +759,9 @@ void FunctionParser::DisambiguatePlusMinus() const{
     case Token::Type::logical_not:
     case Token::Type::open_paren:
     case Token::Type::open_square:
+    case Token::Type::comma:
+    case Token::Type::question:
+    case Token::Type::colon:
       cur.type_ = unary_type;
       break;
     case Token::Type::unknown:
@@ -532,6 +965,36 @@ void FunctionParser::Or() const{
   }
 }
 
+/*!\brief Merges "?" and ":" \link Token Tokens\endlink with their operands
+
+  Searches for patten {value}{?}{value}{:}{value} and replaces with single
+  Token. The conditional operator is right-associative, so the search starts
+  from the end.
+*/
+void FunctionParser::Conditional() const{
+  if(tokens_.size() < 5) return;
+  for(size_t i = tokens_.size()-4; i-- > 0;){
+    if(i+4 >= tokens_.size()) continue;
+    Token &condition = tokens_.at(i);
+    Token &question = tokens_.at(i+1);
+    Token &if_true = tokens_.at(i+2);
+    Token &colon = tokens_.at(i+3);
+    Token &if_false = tokens_.at(i+4);
+
+    if(condition.type_ != Token::Type::resolved_scalar && condition.type_ != Token::Type::resolved_vector) continue;
+    if(if_true.type_ != Token::Type::resolved_scalar && if_true.type_ != Token::Type::resolved_vector) continue;
+    if(if_false.type_ != Token::Type::resolved_scalar && if_false.type_ != Token::Type::resolved_vector) continue;
+    if(question.type_ != Token::Type::question || colon.type_ != Token::Type::colon) continue;
+
+    string name = ConcatenateTokenStrings(i, i+5);
+    bool pure = condition.function_.IsPure() && if_true.function_.IsPure() && if_false.function_.IsPure();
+    ResultType type = CommonType(if_true.function_.Type(), if_false.function_.Type());
+    Token merged(ApplyConditional(name, condition.function_, if_true.function_, if_false.function_).Pure(pure).Type(type));
+
+    CondenseTokens(i, i+5, merged);
+  }
+}
+
 /*!\brief Check that we have a single Token with a valid NamedFun
  */
 void FunctionParser::CheckSolved() const{
@@ -579,6 +1042,7 @@ void FunctionParser::Solve() const{
   EqualOrNot();
   And();
   Or();
+  Conditional();
   CheckSolved();
   CleanupName();
   solved_ = true;
@@ -645,6 +1109,22 @@ string FunctionParser::ConcatenateTokenStrings(size_t i_start, size_t i_end) con
   return result;
 }
 
+/*!\brief Gets interned NamedFunc for \link Token Tokens\endlink in range
+  [i_start, i_end), parsing them only if not already cached
+
+  \param[in] i_start Index of first Token
+
+  \param[in] i_end Index one past last Token
+
+  \return Pointer to cached NamedFunc for the range
+*/
+shared_ptr<const NamedFunc> FunctionParser::InternRange(size_t i_start, size_t i_end) const{
+  return Intern(ConcatenateTokenStrings(i_start, i_end), [this, i_start, i_end](){
+      FunctionParser fp(vector<Token>(tokens_.cbegin()+i_start, tokens_.cbegin()+i_end));
+      return fp.ResolveAsNamedFunc();
+    });
+}
+
 /*!\brief Replace \link Token Tokens\endlink in range [i_start, i_end) with
   replacement
 
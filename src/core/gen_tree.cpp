@@ -0,0 +1,292 @@
+/*! \class GenTree
+
+  \brief Generator decay tree of the current event, built once per entry
+
+  Truth-matching functions typically loop over mc_id, mc_mom and mc_momidx
+  looking for, e.g., the leptons from the Z, and every function repeats the
+  scan. GenTree::Get() instead builds for each event
+  - the list of daughters of each particle, from mc_momidx,
+  - the ancestors of each particle as a bitset, and
+  - the indices of the particles with each PDG id,
+  so that questions like "which particles come from the Higgs" or "is this
+  lepton a descendant of a Z" are answered without looping over the record:
+
+  \code
+  NamedFunc lep_from_z("lep_from_z", [](const Baby &b) -> NamedFunc::ScalarType{
+      const GenTree &tree = GenTree::Get(b);
+      int i = tree.FirstAbsFrom({11, 13, 15}, 23);
+      return i < 0 ? 0 : abs(tree.Id(i));
+    });
+  \endcode
+
+  The tree is kept per thread and rebuilt when Baby::EventId() changes, so all
+  functions evaluated for the same event share one build and no locking is
+  needed. The returned reference is valid until the calling thread gets the
+  tree of another event.
+*/
+#include "core/gen_tree.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace{
+  const vector<int> no_indices;//!<Returned for missing particles or ids
+}
+
+/*!\brief Get the tree of the current event of baby, building it if needed
+ */
+const GenTree & GenTree::Get(const Baby &baby){
+  thread_local GenTree tree;
+  size_t event_id = baby.EventId();
+  if(event_id == 0 || tree.event_id_ != event_id){
+    tree.Build(baby);
+    tree.event_id_ = event_id;
+  }
+  return tree;
+}
+
+/*!\brief Number of particles in the generator record
+ */
+size_t GenTree::Size() const{
+  return ids_.size();
+}
+
+/*!\brief PDG id of particle i, or 0 if out of range
+ */
+int GenTree::Id(int i) const{
+  return i >= 0 && static_cast<size_t>(i) < Size() ? ids_[i] : 0;
+}
+
+/*!\brief Index of the mother of particle i, or -1 if there is none
+ */
+int GenTree::Mother(int i) const{
+  return i >= 0 && static_cast<size_t>(i) < Size() ? mothers_[i] : -1;
+}
+
+/*!\brief PDG id of the mother of particle i as stored in mc_mom, or 0 if out
+  of range
+*/
+int GenTree::MotherId(int i) const{
+  return i >= 0 && static_cast<size_t>(i) < Size() ? mother_ids_[i] : 0;
+}
+
+/*!\brief Indices of the daughters of particle i in increasing order
+ */
+const vector<int> & GenTree::Daughters(int i) const{
+  return i >= 0 && static_cast<size_t>(i) < Size() ? daughters_[i] : no_indices;
+}
+
+/*!\brief Indices of the particles with PDG id (sign included) in increasing
+  order
+*/
+const vector<int> & GenTree::Indices(int id) const{
+  auto found = indices_.find(id);
+  return found == indices_.end() ? no_indices : found->second;
+}
+
+/*!\brief Check if particle ancestor is a mother, grandmother, etc. of
+  particle i
+*/
+bool GenTree::IsAncestor(int ancestor, int i) const{
+  if(i < 0 || ancestor < 0 || static_cast<size_t>(i) >= Size()
+     || static_cast<size_t>(ancestor) >= Size()) return false;
+  return (ancestors_[i*num_words_ + ancestor/64] >> (ancestor%64)) & 1u;
+}
+
+/*!\brief Check if particle i descends from a particle with |PDG id| abs_id
+ */
+bool GenTree::IsDescendantOf(int i, int abs_id) const{
+  for(const auto &ancestor: Indices(abs_id)){
+    if(IsAncestor(ancestor, i)) return true;
+  }
+  if(abs_id == 0) return false;
+  for(const auto &ancestor: Indices(-abs_id)){
+    if(IsAncestor(ancestor, i)) return true;
+  }
+  return false;
+}
+
+/*!\brief Follows the chain of copies of particle i (daughters with the same
+  PDG id, e.g. after radiation) to its last element
+
+  \return Index of the last copy, i itself if it has none, or -1 if i is out
+  of range
+*/
+int GenTree::LastCopy(int i) const{
+  if(i < 0 || static_cast<size_t>(i) >= Size()) return -1;
+  for(size_t step = 0; step < Size(); ++step){
+    int next = -1;
+    for(const auto &daughter: daughters_[i]){
+      if(ids_[daughter] == ids_[i]){
+        next = daughter;
+        break;
+      }
+    }
+    if(next < 0) break;
+    i = next;
+  }
+  return i;
+}
+
+/*!\brief Index of the first particle with one of the PDG ids (sign
+  included), or -1 if there is none
+*/
+int GenTree::First(initializer_list<int> ids) const{
+  int first = -1;
+  for(const auto &id: ids){
+    const vector<int> &indices = Indices(id);
+    if(!indices.empty() && (first < 0 || indices.front() < first)) first = indices.front();
+  }
+  return first;
+}
+
+/*!\brief Index of the first particle with one of the PDG ids (sign included)
+  whose mother has PDG id mother_id according to mc_mom, or -1 if there is none
+*/
+int GenTree::First(initializer_list<int> ids, int mother_id) const{
+  int first = -1;
+  for(const auto &id: ids){
+    for(const auto &i: Indices(id)){
+      if(first >= 0 && i > first) break;
+      if(mother_ids_[i] == mother_id){
+        first = i;
+        break;
+      }
+    }
+  }
+  return first;
+}
+
+/*!\brief Index of the last particle with one of the PDG ids (sign included),
+  or -1 if there is none
+*/
+int GenTree::Last(initializer_list<int> ids) const{
+  int last = -1;
+  for(const auto &id: ids){
+    const vector<int> &indices = Indices(id);
+    if(!indices.empty() && indices.back() > last) last = indices.back();
+  }
+  return last;
+}
+
+/*!\brief Index of the first particle with one of the |PDG ids|, or -1 if
+  there is none
+*/
+int GenTree::FirstAbs(initializer_list<int> abs_ids) const{
+  int first = -1;
+  for(const auto &abs_id: abs_ids){
+    for(const auto &id: {abs_id, -abs_id}){
+      const vector<int> &indices = Indices(id);
+      if(!indices.empty() && (first < 0 || indices.front() < first)) first = indices.front();
+    }
+  }
+  return first;
+}
+
+/*!\brief Index of the first particle with one of the |PDG ids| descending from
+  a particle with |PDG id| ancestor_abs_id, e.g. FirstAbsFrom({11, 13}, 23) for
+  the first light lepton from a Z
+
+  \return Index of the particle, or -1 if there is none
+*/
+int GenTree::FirstAbsFrom(initializer_list<int> abs_ids, int ancestor_abs_id) const{
+  int first = -1;
+  for(const auto &abs_id: abs_ids){
+    for(const auto &id: {abs_id, -abs_id}){
+      for(const auto &i: Indices(id)){
+        if(first >= 0 && i > first) break;
+        if(IsDescendantOf(i, ancestor_abs_id)){
+          first = i;
+          break;
+        }
+      }
+    }
+  }
+  return first;
+}
+
+/*!\brief Daughters of the last copy of the first particle with |PDG id|
+  abs_id, e.g. DaughtersOf(25) for the decay products of the Higgs
+
+  \return Indices of the daughters, empty if there is no such particle
+*/
+const vector<int> & GenTree::DaughtersOf(int abs_id) const{
+  return Daughters(LastCopy(FirstAbs({abs_id})));
+}
+
+GenTree::GenTree():
+  event_id_(0),
+  num_words_(0),
+  ids_(),
+  mothers_(),
+  mother_ids_(),
+  daughters_(),
+  ancestors_(),
+  indices_(){
+}
+
+/*!\brief Fills the tree from the mc_* branches of the current entry of baby
+
+  Buffers are reused between events to avoid allocations.
+*/
+void GenTree::Build(const Baby &baby){
+  const vector<int> &ids = *baby.mc_id();
+  const vector<int> &mothers = *baby.mc_momidx();
+  const vector<int> &mother_ids = *baby.mc_mom();
+  size_t num_particles = ids.size();
+
+  ids_.assign(ids.begin(), ids.end());
+  mothers_.assign(num_particles, -1);
+  mother_ids_.assign(num_particles, 0);
+  if(daughters_.size() < num_particles) daughters_.resize(num_particles);
+  for(size_t i = 0; i < num_particles; ++i) daughters_[i].clear();
+  for(auto &entry: indices_) entry.second.clear();
+
+  for(size_t i = 0; i < num_particles; ++i){
+    if(i < mother_ids.size()) mother_ids_[i] = mother_ids[i];
+    indices_[ids_[i]].push_back(i);
+    if(i >= mothers.size()) continue;
+    int mother = mothers[i];
+    if(mother < 0 || static_cast<size_t>(mother) >= num_particles
+       || static_cast<size_t>(mother) == i) continue;
+    mothers_[i] = mother;
+  }
+  for(size_t i = 0; i < num_particles; ++i){
+    if(mothers_[i] >= 0) daughters_[mothers_[i]].push_back(i);
+  }
+  BuildAncestors();
+}
+
+/*!\brief Fills the ancestor bitsets by walking up each chain of mothers once
+
+  The bitset of a particle is that of its mother plus the mother itself.
+  Chains are processed from the top down so every bitset is computed once. A
+  mother link closing a loop is ignored.
+*/
+void GenTree::BuildAncestors(){
+  size_t num_particles = Size();
+  num_words_ = (num_particles + 63)/64;
+  ancestors_.assign(num_particles*num_words_, 0);
+
+  enum class State: char {todo, in_chain, done};
+  vector<State> state(num_particles, State::todo);
+  vector<int> chain;
+  for(size_t start = 0; start < num_particles; ++start){
+    chain.clear();
+    for(int i = start; i >= 0 && state[i] == State::todo; i = mothers_[i]){
+      state[i] = State::in_chain;
+      chain.push_back(i);
+    }
+    for(auto i = chain.rbegin(); i != chain.rend(); ++i){
+      int mother = mothers_[*i];
+      if(mother >= 0 && state[mother] == State::done){
+        copy(ancestors_.begin() + mother*num_words_,
+             ancestors_.begin() + (mother+1)*num_words_,
+             ancestors_.begin() + *i*num_words_);
+        ancestors_[*i*num_words_ + mother/64] |= static_cast<uint64_t>(1) << (mother%64);
+      }
+      state[*i] = State::done;
+    }
+  }
+}
@@ -413,6 +413,8 @@ void WriteBaseHeader(const set<Variable> &vars,
   file << "#ifndef H_BABY\n";
   file << "#define H_BABY\n\n";
 
+  file << "#include <cstddef>\n\n";
+
   file << "#include <vector>\n";
   file << "#include <set>\n";
   file << "#include <memory>\n";
@@ -421,6 +423,8 @@ void WriteBaseHeader(const set<Variable> &vars,
   file << "#include \"TChain.h\"\n\n";
   file << "#include \"TString.h\"\n\n";
 
+  file << "#include \"core/event_cache.hpp\"\n\n";
+
   file << "class Process;\n";
   file << "class NamedFunc;\n\n";
 
@@ -448,7 +452,9 @@ void WriteBaseHeader(const set<Variable> &vars,
   file << "  virtual ~Baby() = default;\n\n";
 
   file << "  long GetEntries() const;\n";
-  file << "  virtual void GetEntry(long entry);\n\n";
+  file << "  virtual void GetEntry(long entry);\n";
+  file << "  void LoadEntry() const;\n";
+  file << "  std::size_t EventId() const;\n\n";
 
   file << "  const std::set<std::string> & FileNames() const;\n\n";
   file << "  int SampleType() const;\n";
@@ -479,13 +485,18 @@ void WriteBaseHeader(const set<Variable> &vars,
 
   file << "  static NamedFunc GetFunction(const std::string &var_name);\n\n";
 
+  file << "  EventCache & Cache();\n";
+  file << "  static const std::vector<EventCache::ColumnFactory> & CacheColumns();\n\n";
+
   file << "  std::unique_ptr<Activator> Activate();\n\n";
 
   file << "protected:\n";
   file << "  virtual void Initialize();\n\n";
 
   file << "  std::unique_ptr<TChain> chain_;//!<Chain to load variables from\n";
-  file << "  long entry_;//!<Current entry\n\n";
+  file << "  long chain_entry_;//!<Current entry of the TChain\n";
+  file << "  mutable long entry_;//!<Current entry in the current tree of the TChain, -1 until loaded\n";
+  file << "  std::size_t event_id_;//!<Identifier of current event, see Baby::EventId()\n\n";
 
   file << "private:\n";
   file << "  friend class Activator;\n\n";
@@ -502,12 +513,14 @@ void WriteBaseHeader(const set<Variable> &vars,
 
   file << "  void * event_veto_data_;\n\n";
 
+  file << "  std::unique_ptr<EventCache> cache_;//!<In-memory copy of used variables, kept across event loops\n\n";
+
   file << "  void ActivateChain();\n";
   file << "  void DeactivateChain();\n\n";
 
   for(const auto &var: vars){
     if(!var.ImplementInBase()) continue;
-    file << "  "
+    file << "  mutable "
          << var.DecoratedType() << " "
          << var.Name() << "_;//!<Cached value of " << var.Name() << '\n';
     file << "  TBranch *b_" << var.Name() << "_;//!<Branch from which "
@@ -552,6 +565,7 @@ void WriteBaseSource(const set<Variable> &vars){
 
   file << "#include \"core/baby.hpp\"\n\n";
 
+  file << "#include <atomic>\n";
   file << "#include <mutex>\n";
   file << "#include <type_traits>\n";
   file << "#include <utility>\n";
@@ -595,7 +609,7 @@ void WriteBaseSource(const set<Variable> &vars){
   file << "    return NamedFunc(name,\n";
   file << "                     [baby_func](const Baby &b){\n";
   file << "                       return ScalarType((b.*baby_func)());\n";
-  file << "                     });\n";
+  file << "                     }).Type(NamedFunc::TypeOf<T>());\n";
   file << "  }\n\n";
 
   file << "  /*!\\brief Get NamedFunc for a function returning a vector\n\n";
@@ -604,6 +618,9 @@ void WriteBaseSource(const set<Variable> &vars){
 
   file << "    \\param[in] name Name of function/variable\n\n";
 
+  file << "    Elements are read directly from the branch buffer, so reductions and\n";
+  file << "    element-wise operations need not copy the branch into a VectorType.\n\n";
+
   file << "    \\return NamedFunc that returns appropriate vectorr\n";
   file << "  */\n";
   file << "  template<typename T>\n";
@@ -611,9 +628,11 @@ void WriteBaseSource(const set<Variable> &vars){
   file << "                          const string &name){\n";
   file << "    return NamedFunc(name,\n";
   file << "                     [baby_func](const Baby &b){\n";
-  file << "                       const auto &raw = (b.*baby_func)();\n";
-  file << "                       return VectorType(raw->cbegin(), raw->cend());\n";
-  file << "                     });\n";
+  file << "                       return (b.*baby_func)()->size();\n";
+  file << "                     },\n";
+  file << "                     [baby_func](const Baby &b, size_t i){\n";
+  file << "                       return ScalarType((*(b.*baby_func)())[i]);\n";
+  file << "                     }).Type(NamedFunc::TypeOf<T>());\n";
   file << "  }\n\n";
 
   bool have_vector_double = false;
@@ -649,6 +668,9 @@ void WriteBaseSource(const set<Variable> &vars){
   file << "           const set<const Process*> &processes):\n";
   file << "  processes_(processes),\n";
   file << "  chain_(nullptr),\n";
+  file << "  chain_entry_(0),\n";
+  file << "  entry_(-1),\n";
+  file << "  event_id_(0),\n";
   file << "  file_names_(file_names),\n";
   file << "  total_entries_(0),\n";
   auto last_base = vars.cbegin();
@@ -659,10 +681,11 @@ void WriteBaseSource(const set<Variable> &vars){
       found_in_base = true;
     }
   }
+  file << "  cached_total_entries_(false),\n";
   if(vars.size() == 0 || !found_in_base){
-    file << "  cached_total_entries_(false){\n";
+    file << "  cache_(nullptr){\n";
   }else{
-    file << "  cached_total_entries_(false),\n";
+    file << "  cache_(nullptr),\n";
     for(auto var = vars.cbegin(); var != last_base; ++var){
       if(!var->ImplementInBase()) continue;
       file << "  " << var->Name() << "_{},\n";
@@ -694,6 +717,10 @@ void WriteBaseSource(const set<Variable> &vars){
 
   file << "/*!\\brief Change current entry\n\n";
 
+  file << "  The TChain is only positioned when a variable is first read from it (see\n";
+  file << "  Baby::LoadEntry()), so entries whose variables all come from the EventCache\n";
+  file << "  do not touch the files.\n\n";
+
   file << "  \\param[in] entry Entry number to load\n";
   file << "*/\n";
   file << "void Baby::GetEntry(long entry){\n";
@@ -701,8 +728,31 @@ void WriteBaseSource(const set<Variable> &vars){
     if(!var.ImplementInBase()) continue;
     file << "  c_" << var.Name() << "_ = false;\n";
   }
+  file << "  static atomic<size_t> last_event_id(0);\n";
+  file << "  event_id_ = ++last_event_id;\n";
+  file << "  chain_entry_ = entry;\n";
+  file << "  entry_ = -1;\n";
+  file << "}\n\n";
+
+  file << "/*!\\brief Position the TChain at the current entry if not yet done\n\n";
+
+  file << "  Called by the variable getters before reading a branch, and needed before\n";
+  file << "  reading the TChain directly.\n";
+  file << "*/\n";
+  file << "void Baby::LoadEntry() const{\n";
+  file << "  if(entry_ >= 0) return;\n";
   file << "  lock_guard<mutex> lock(Multithreading::root_mutex);\n";
-  file << "  entry_ = chain_->LoadTree(entry);\n";
+  file << "  entry_ = chain_->LoadTree(chain_entry_);\n";
+  file << "}\n\n";
+
+  file << "/*!\\brief Identifier of the current event\n\n";
+
+  file << "  Different for every call to Baby::GetEntry() of any Baby in the process,\n";
+  file << "  including calls loading the same entry again, so values computed for an\n";
+  file << "  event can be cached under it. 0 before the first entry is loaded.\n";
+  file << "*/\n";
+  file << "size_t Baby::EventId() const{\n";
+  file << "  return event_id_;\n";
   file << "}\n\n";
 
   file << "const std::set<std::string> & Baby::FileNames() const{\n";
@@ -793,6 +843,33 @@ void WriteBaseSource(const set<Variable> &vars){
   }
   file << "}\n\n";
 
+  file << "/*! \\brief Get in-memory cache of variables, creating it if necessary\n\n";
+
+  file << "  \\return Cache owned by this Baby\n";
+  file << "*/\n";
+  file << "EventCache & Baby::Cache(){\n";
+  file << "  if(!cache_) cache_ = unique_ptr<EventCache>(new EventCache(CacheColumns()));\n";
+  file << "  return *cache_;\n";
+  file << "}\n\n";
+
+  file << "/*! \\brief Get functions creating an EventCache column for each variable\n\n";
+
+  file << "  Only variables implemented in this base class can be cached. The index of a\n";
+  file << "  variable in the returned list is the one passed to EventCache::Read by its\n";
+  file << "  accessor.\n\n";
+
+  file << "  \\return Column factories in alphabetical order of variable name\n";
+  file << "*/\n";
+  file << "const vector<EventCache::ColumnFactory> & Baby::CacheColumns(){\n";
+  file << "  static const vector<EventCache::ColumnFactory> columns = {\n";
+  for(const auto &var: vars){
+    if(!var.ImplementInBase()) continue;
+    file << "    EventCache::Factory(&Baby::" << var.Name() << "),\n";
+  }
+  file << "  };\n";
+  file << "  return columns;\n";
+  file << "}\n\n";
+
   file << "unique_ptr<Baby::Activator> Baby::Activate(){\n";
   file << "  return unique_ptr<Baby::Activator>(new Baby::Activator(*this));\n";
   file << "}\n\n";
@@ -822,6 +899,7 @@ void WriteBaseSource(const set<Variable> &vars){
   file << "  chain_.reset();\n";
   file << "}\n\n";
 
+  size_t icol = 0;
   for(const auto &var: vars){
     if(!var.ImplementInBase()) continue;
     file << "/*! \\brief Get " << var.Name() << " for current event and cache it\n\n";
@@ -830,7 +908,10 @@ void WriteBaseSource(const set<Variable> &vars){
     file << "*/\n";
     file << var.DecoratedType() << " const & Baby::" << var.Name() << "() const{\n";
     file << "  if(!c_" << var.Name() << "_ && b_" << var.Name() << "_){\n";
-    file << "    b_" << var.Name() << "_->GetEntry(entry_);\n";
+    file << "    if(!cache_ || !cache_->Read(" << icol++ << ", " << var.Name() << "_)){\n";
+    file << "      LoadEntry();\n";
+    file << "      b_" << var.Name() << "_->GetEntry(entry_);\n";
+    file << "    }\n";
     file << "    c_" << var.Name() << "_ = true;\n";
     file << "  }\n";
     file << "  return " << var.Name() << "_;\n";
@@ -990,6 +1071,7 @@ void WriteSpecializedSource(const set<Variable> &vars, const string &type){
       file << "*/\n";
       file << var.DecoratedType(type) << " const & Baby_" << type << "::" << var.Name() << "() const{\n";
       file << "  if(!c_" << var.Name() << "_ && b_" << var.Name() << "_){\n";
+      file << "    LoadEntry();\n";
       file << "    b_" << var.Name() << "_->GetEntry(entry_);\n";
       file << "    c_" << var.Name() << "_ = true;\n";
       file << "  }\n";
@@ -46,6 +46,8 @@
 #include "TFile.h"
 
 #include "core/utilities.hpp"
+#include "core/shard_io.hpp"
+#include "core/event_block.hpp"
 
 using namespace std;
 using namespace PlotOptTypes;
@@ -151,7 +153,9 @@ Hist1D::SingleHist1D::SingleHist1D(const Hist1D &figure,
   FigureComponent(figure, process),
   raw_hist_(hist),
   scaled_hist_(),
+  fill_hist_(hist),
   proc_and_hist_cut_(figure.cut_ && process->cut_),
+  cut_mask_(),
   cut_vector_(),
   wgt_vector_(),
   val_vector_(){
@@ -162,25 +166,40 @@ Hist1D::SingleHist1D::SingleHist1D(const Hist1D &figure,
 }
 
 void Hist1D::SingleHist1D::RecordEvent(const Baby &baby){
-  const Hist1D& stack = static_cast<const Hist1D&>(figure_);
-  size_t min_vec_size;
-  bool have_vec = false;
-
   const NamedFunc &cut = proc_and_hist_cut_;
   if(cut.IsScalar()){
     if(!cut.GetScalar(baby)) return;
+    RecordPassing(baby, nullptr);
   }else{
-    cut_vector_ = cut.GetVector(baby);
-    if(!HavePass(cut_vector_)) return;
+    cut.GetMask(baby, cut_mask_);
+    if(!HavePass(cut_mask_)) return;
+    RecordPassing(baby, &cut_mask_);
+  }
+}
+
+/*!\brief Fills the entry, whose cut has already been evaluated
+
+  \param[in] baby Entry to record
+
+  \param[in] mask Elements passing a vector cut, or nullptr if the cut is scalar
+  and passed
+*/
+void Hist1D::SingleHist1D::RecordPassing(const Baby &baby,
+                                         const BitMask *mask){
+  const Hist1D& stack = static_cast<const Hist1D&>(figure_);
+  size_t min_vec_size = 0;
+  bool have_vec = false;
+  if(mask != nullptr){
     have_vec = true;
-    min_vec_size = cut_vector_.size();
+    min_vec_size = mask->Size();
   }
+
   const NamedFunc &wgt = stack.weight_;
   NamedFunc::ScalarType wgt_scalar = 0.;
   if(wgt.IsScalar()){
     wgt_scalar = wgt.GetScalar(baby);
   }else{
-    wgt_vector_ = wgt.GetVector(baby);
+    wgt.GetVector(baby, wgt_vector_);
     if(!have_vec || wgt_vector_.size() < min_vec_size){
       have_vec = true;
       min_vec_size = wgt_vector_.size();
@@ -192,7 +211,7 @@ void Hist1D::SingleHist1D::RecordEvent(const Baby &baby){
   if(val.IsScalar()){
     val_scalar = val.GetScalar(baby);
   }else{
-    val_vector_ = val.GetVector(baby);
+    val.GetVector(baby, val_vector_);
     if(!have_vec || val_vector_.size() < min_vec_size){
       have_vec = true;
       min_vec_size = val_vector_.size();
@@ -200,16 +219,84 @@ void Hist1D::SingleHist1D::RecordEvent(const Baby &baby){
   }
 
   if(!have_vec){
-    raw_hist_.Fill(val_scalar, wgt_scalar);
+    fill_hist_.Fill(val_scalar, wgt_scalar);
   }else{
-    for(size_t i = 0; i < min_vec_size; ++i){
-      if(cut.IsVector() && !cut_vector_.at(i)) continue;
-      raw_hist_.Fill(val.IsScalar() ? val_scalar : val_vector_.at(i),
-                     wgt.IsScalar() ? wgt_scalar : wgt_vector_.at(i));
+    for(size_t i = mask != nullptr ? mask->NextSet(0) : 0; i < min_vec_size;
+        i = mask != nullptr ? mask->NextSet(i+1) : i+1){
+      fill_hist_.Fill(val.IsScalar() ? val_scalar : val_vector_.at(i),
+                      wgt.IsScalar() ? wgt_scalar : wgt_vector_.at(i));
     }
   }
 }
 
+/*!\brief Check if the cut, weight and plotted variable can all be evaluated
+  over an EventBlock
+*/
+bool Hist1D::SingleHist1D::CanRecordBlock() const{
+  const Hist1D& stack = static_cast<const Hist1D&>(figure_);
+  return proc_and_hist_cut_.HasBlock() && stack.weight_.HasBlock() && stack.xaxis_.var_.HasBlock();
+}
+
+/*!\brief Records all events of block passing pass and the histogram cut
+
+  Equivalent to calling RecordEvent for each event of the block with a
+  non-zero entry in pass. Only valid if CanRecordBlock() is true.
+
+  \param[in] block Events to record
+
+  \param[in] pass Result of the process cut for each event of block
+*/
+void Hist1D::SingleHist1D::RecordBlock(const EventBlock &block,
+                                       const NamedFunc::VectorType &pass){
+  const Hist1D& stack = static_cast<const Hist1D&>(figure_);
+  proc_and_hist_cut_.GetBlock(block, cut_vector_);
+  stack.weight_.GetBlock(block, wgt_vector_);
+  stack.xaxis_.var_.GetBlock(block, val_vector_);
+  for(size_t i = 0; i < block.Size(); ++i){
+    if(pass[i] && cut_vector_[i]) fill_hist_.Fill(val_vector_[i], wgt_vector_[i]);
+  }
+}
+
+/*!\brief Adds the entries recorded for the Baby to raw_hist_
+ */
+void Hist1D::SingleHist1D::FinishBaby(const Baby &/*baby*/){
+  FlushFills();
+}
+
+/*!\brief Adds entries recorded in fill_hist_ to raw_hist_
+
+  Entries are recorded in a FastHist during the event loop, so raw_hist_ is
+  only up to date after this is called. PlotMaker does so after each Baby.
+*/
+void Hist1D::SingleHist1D::FlushFills(){
+  fill_hist_.FlushTo(raw_hist_);
+}
+
+/*!\brief Hist1D components can be merged across shards
+ */
+bool Hist1D::SingleHist1D::CanMerge() const{
+  return true;
+}
+
+/*!\brief Writes the raw histogram, including pending fills
+ */
+void Hist1D::SingleHist1D::WriteState(ostream &out){
+  FlushFills();
+  ShardIO::WriteHist(out, raw_hist_);
+}
+
+/*!\brief Adds a raw histogram written by another shard
+ */
+void Hist1D::SingleHist1D::MergeState(istream &in){
+  ShardIO::AddHist(in, raw_hist_);
+}
+
+/*!\brief Approximate memory of the raw, scaled and pending histograms
+ */
+size_t Hist1D::SingleHist1D::EstimateBytes() const{
+  return 3*(sizeof(TH1D) + 2*sizeof(double)*static_cast<size_t>(raw_hist_.GetNcells()));
+}
+
 /*! Get the maximum of the histogram
 
   \param[in] max_bound Returns the highest bin content c satisfying
@@ -539,6 +626,10 @@ std::string Hist1D::GetTag() const {
   return tag_;
 }
 
+vector<NamedFunc> Hist1D::GetFunctions() const{
+  return {xaxis_.var_, cut_, weight_};
+}
+
 Figure::FigureComponent * Hist1D::GetComponent(const Process *process){
   const auto &component_list = GetComponentList(process);
   for(const auto &component: component_list){
@@ -637,6 +728,9 @@ Hist1D & Hist1D::DrawPlot(const bool &draw_plot) {
   unstacked contents at 1 fb^{-1}
 */
 void Hist1D::RefreshScaledHistos(){
+  for(auto &component: backgrounds_) component->FlushFills();
+  for(auto &component: signals_) component->FlushFills();
+  for(auto &component: datas_) component->FlushFills();
   InitializeHistos();
   MergeOverflow();
   ScaleHistos();
@@ -32,6 +32,31 @@ Hist2D::SingleHist2D::SingleHist2D(const Hist2D &figure,
   yval_vector_(){
 }
 
+/*!\brief Hist2D components can be merged across shards
+ */
+bool Hist2D::SingleHist2D::CanMerge() const{
+  return true;
+}
+
+/*!\brief Writes the state of the clusterizer
+ */
+void Hist2D::SingleHist2D::WriteState(ostream &out){
+  clusterizer_.WriteState(out);
+}
+
+/*!\brief Adds points and histogram written by another shard
+ */
+void Hist2D::SingleHist2D::MergeState(istream &in){
+  clusterizer_.MergeState(in);
+}
+
+/*!\brief Approximate memory of the clusterizer, see
+  Clustering::Clusterizer::EstimateBytes()
+*/
+size_t Hist2D::SingleHist2D::EstimateBytes() const{
+  return clusterizer_.EstimateBytes();
+}
+
 void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   const Hist2D& hist = static_cast<const Hist2D&>(figure_);
   size_t min_vec_size;
@@ -41,7 +66,7 @@ void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   if(cut.IsScalar()){
     if(!cut.GetScalar(baby)) return;
   }else{
-    cut_vector_ = cut.GetVector(baby);
+    cut.GetVector(baby, cut_vector_);
     if(!HavePass(cut_vector_)) return;
     have_vec = true;
     min_vec_size = cut_vector_.size();
@@ -52,7 +77,7 @@ void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   if(wgt.IsScalar()){
     wgt_scalar = wgt.GetScalar(baby);
   }else{
-    wgt_vector_ = wgt.GetVector(baby);
+    wgt.GetVector(baby, wgt_vector_);
     if(!have_vec || wgt_vector_.size() < min_vec_size){
       have_vec = true;
       min_vec_size = wgt_vector_.size();
@@ -64,7 +89,7 @@ void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   if(xval.IsScalar()){
     xval_scalar = xval.GetScalar(baby);
   }else{
-    xval_vector_ = xval.GetVector(baby);
+    xval.GetVector(baby, xval_vector_);
     if(!have_vec || xval_vector_.size() < min_vec_size){
       have_vec = true;
       min_vec_size = xval_vector_.size();
@@ -76,7 +101,7 @@ void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   if(yval.IsScalar()){
     yval_scalar = yval.GetScalar(baby);
   }else{
-    yval_vector_ = yval.GetVector(baby);
+    yval.GetVector(baby, yval_vector_);
     if(!have_vec || yval_vector_.size() < min_vec_size){
       have_vec = true;
       min_vec_size = yval_vector_.size();
@@ -534,6 +559,10 @@ std::string Hist2D::GetTag() const{
   return tag_;
 }
 
+vector<NamedFunc> Hist2D::GetFunctions() const{
+  return {xaxis_.var_, yaxis_.var_, cut_, weight_};
+}
+
 Figure::FigureComponent * Hist2D::GetComponent(const Process *process){
   const auto &component_list = GetComponentList(process);
   for(const auto &component: component_list){
@@ -0,0 +1,139 @@
+/*! \file make_manifest.cxx
+
+  \brief Writes or checks the SampleManifest of directories of picos
+
+  For each directory, every file matching the pattern is opened once to record
+  its entries, cluster boundaries and branch sizes, and the manifest is written
+  next to the files. With --check, the existing manifest is compared against
+  the directory instead, listing files that are missing from it, stale or, with
+  checksums, modified, and the exit code is non-zero if anything is out of
+  date.
+
+  Usage: make_manifest.exe [--pattern GLOB] [--tree NAME] [--no_checksums]
+                           [--check] DIR [DIR...]
+*/
+#include "core/test.hpp"
+
+#include <cstdlib>
+#include <cstdio>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "TError.h"
+
+#include "core/sample_manifest.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  string pattern = "*.root";
+  string tree_name = "tree";
+  bool checksums = true;
+  bool check = false;
+  vector<string> directories;
+
+  /*!\brief Reports files of directory whose manifest record is missing or out
+    of date
+
+    \return Number of such files
+  */
+  int CheckDirectory(const string &directory){
+    SampleManifest manifest(directory);
+    if(!manifest.Read()){
+      cout << directory << ": no manifest" << endl;
+      return 1;
+    }
+    int num_bad = 0;
+    for(const auto &path: Glob(directory+"/"+pattern)){
+      const SampleManifest::FileInfo *info = manifest.Find(Basename(path));
+      string problem = "";
+      if(info == nullptr){
+        problem = "missing";
+      }else if(!manifest.IsCurrent(*info)){
+        problem = "stale";
+      }else if(checksums && !info->checksum_.empty() && !manifest.VerifyChecksum(*info)){
+        problem = "checksum mismatch";
+      }
+      if(problem == "") continue;
+      cout << path << ": " << problem << endl;
+      ++num_bad;
+    }
+    cout << directory << ": " << manifest.Files().size() << " files in manifest, "
+         << num_bad << " out of date" << endl;
+    return num_bad;
+  }
+}
+
+int main(int argc, char *argv[]){
+  gErrorIgnoreLevel = 6000;
+  GetOptions(argc, argv);
+  if(directories.empty()){
+    cout << "Usage: make_manifest.exe [--pattern GLOB] [--tree NAME] [--no_checksums] [--check] DIR [DIR...]" << endl;
+    return 1;
+  }
+
+  int num_bad = 0;
+  for(const auto &directory: directories){
+    if(check){
+      num_bad += CheckDirectory(directory);
+      continue;
+    }
+    SampleManifest manifest = SampleManifest::Scan(directory, pattern, tree_name, checksums);
+    manifest.Write();
+    long entries = 0;
+    for(const auto &info: manifest.Files()) entries += info.entries_;
+    cout << "Wrote " << SampleManifest::PathFor(directory) << " with " << manifest.Files().size()
+         << " files and " << AddCommas(entries) << " entries" << endl;
+  }
+  return num_bad == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void GetOptions(int argc, char *argv[]){
+  while(true){
+    static struct option long_options[] = {
+      {"pattern", required_argument, 0, 'p'},
+      {"tree", required_argument, 0, 't'},
+      {"no_checksums", no_argument, 0, 0},
+      {"check", no_argument, 0, 'c'},
+      {0, 0, 0, 0}
+    };
+
+    char opt = -1;
+    int option_index;
+    opt = getopt_long(argc, argv, "p:t:c", long_options, &option_index);
+
+    if( opt == -1) break;
+
+    string optname;
+    switch(opt){
+    case 'p':
+      pattern = optarg;
+      break;
+    case 't':
+      tree_name = optarg;
+      break;
+    case 'c':
+      check = true;
+      break;
+    case 0:
+      optname = long_options[option_index].name;
+      if(optname == "no_checksums"){
+        checksums = false;
+      }else{
+        printf("Bad option! Found option name %s\n", optname.c_str());
+      }
+      break;
+    default:
+      printf("Bad option! getopt_long returned character code 0%o\n", opt);
+      break;
+    }
+  }
+  for(int iarg = optind; iarg < argc; ++iarg){
+    directories.push_back(argv[iarg]);
+  }
+}
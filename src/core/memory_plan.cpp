@@ -0,0 +1,111 @@
+/*! \class MemoryPlan
+
+  \brief Number of Babies to open at once within an approximate memory budget
+
+  The memory of a PlotMaker run is dominated by the filled figures, whose
+  components are allocated when pushed and live until the figures are
+  printed, and by the Babies open at the same time, one per thread, each
+  holding the baskets of the current cluster of its TChain. Only the latter
+  can be traded for speed, so given estimates of both, MemoryPlan chooses the
+  most Babies processed at once such that they, all figures and the reserved
+  memory (the EventCache budget) fit the budget.
+
+  If even the figures alone do not fit, one Baby at a time is used and
+  MemoryPlan::Fits() is false.
+*/
+#include "core/memory_plan.hpp"
+
+#include <algorithm>
+#include <memory>
+
+#include "core/sample_manifest.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+const size_t MemoryPlan::chain_overhead_bytes = 16ul << 20;
+const size_t MemoryPlan::unknown_baby_bytes = 256ul << 20;
+
+/*!\brief Builds the plan
+
+  \param[in] figure_bytes Estimated memory of each figure, summed over its
+  components
+
+  \param[in] baby_bytes Estimated memory of one open Baby
+
+  \param[in] reserved_bytes Memory used independently of the plan
+
+  \param[in] max_threads Largest number of Babies to process at once
+
+  \param[in] budget Memory allowed in total
+*/
+MemoryPlan::MemoryPlan(const vector<size_t> &figure_bytes,
+                       size_t baby_bytes,
+                       size_t reserved_bytes,
+                       size_t max_threads,
+                       size_t budget):
+  figure_bytes_(figure_bytes),
+  baby_bytes_(baby_bytes),
+  reserved_bytes_(reserved_bytes),
+  budget_(budget),
+  num_threads_(1){
+  size_t used = reserved_bytes_ + FigureBytes();
+  if(used < budget_ && baby_bytes_ > 0) num_threads_ = (budget_-used)/baby_bytes_;
+  num_threads_ = max(min(num_threads_, max(max_threads, static_cast<size_t>(1))), static_cast<size_t>(1));
+}
+
+/*!\brief Upper estimate of the memory of an open Baby reading files
+
+  Uses the branch sizes and clusters in the SampleManifest of each file: the
+  compressed and uncompressed baskets of the largest cluster average among the
+  files, plus a fixed overhead for the chain. If any file has no manifest
+  record, MemoryPlan::unknown_baby_bytes is assumed.
+*/
+size_t MemoryPlan::EstimateBabyBytes(const set<string> &files){
+  size_t cluster_bytes = 0;
+  for(const auto &file: files){
+    shared_ptr<const SampleManifest::FileInfo> info = SampleManifest::Lookup(file);
+    if(info == nullptr) return unknown_baby_bytes;
+    long long bytes = 0;
+    for(const auto &branch: info->branch_bytes_){
+      bytes += branch.second.first + branch.second.second;
+    }
+    size_t num_clusters = max(info->clusters_.size(), static_cast<size_t>(1));
+    cluster_bytes = max(cluster_bytes, static_cast<size_t>(bytes)/num_clusters);
+  }
+  return chain_overhead_bytes + cluster_bytes;
+}
+
+/*!\brief Number of Babies to process at once
+ */
+size_t MemoryPlan::NumThreads() const{
+  return num_threads_;
+}
+
+/*!\brief Estimated memory of all figures
+ */
+size_t MemoryPlan::FigureBytes() const{
+  size_t bytes = 0;
+  for(const auto &figure: figure_bytes_) bytes += figure;
+  return bytes;
+}
+
+/*!\brief Check if the run is expected to stay within the budget
+ */
+bool MemoryPlan::Fits() const{
+  return reserved_bytes_ + FigureBytes() + num_threads_*baby_bytes_ <= budget_;
+}
+
+/*!\brief Prints the estimates and the chosen schedule
+ */
+void MemoryPlan::Print(ostream &out) const{
+  size_t total = FigureBytes();
+  out << "Memory plan for a budget of " << RoundNumber(budget_, 1, 1<<20) << " MB: "
+      << figure_bytes_.size() << " figures need ~" << RoundNumber(total, 1, 1<<20)
+      << " MB, each open baby ~" << RoundNumber(baby_bytes_, 1, 1<<20) << " MB";
+  if(reserved_bytes_ > 0) out << ", event cache " << RoundNumber(reserved_bytes_, 1, 1<<20) << " MB";
+  out << "." << endl;
+  out << "Running with up to " << num_threads_ << (num_threads_ == 1 ? " baby" : " babies")
+      << " open at once." << endl;
+  if(!Fits()) out << "WARNING: the estimated memory exceeds the budget even with one baby at a time." << endl;
+}
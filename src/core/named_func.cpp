@@ -38,16 +38,62 @@
   extra vectors being constructed (and often copied if care is not taken with
   results) even when evaluating a simple scalar value.
 
+  A vector NamedFunc may additionally provide a size function and an element
+  function returning a single entry of the vector. Baby variables stored as
+  vectors provide them, reading directly from the branch buffer, and the
+  operators above propagate them whenever every operand is either a scalar or
+  has element access. Consumers such as the reductions in FunctionParser
+  (e.g. Sum\$) use them to loop over elements without ever building a
+  VectorType. The vector function remains valid and is built from the element
+  function in that case.
+
+  A scalar NamedFunc may also provide a block function, evaluating it for every
+  event of an EventBlock at once into a VectorType. Scalar Baby variables
+  parsed by FunctionParser read their values from a column of the block (see
+  NamedFunc::BlockColumn()), constants fill the result, and the arithmetic,
+  comparison and logical operators above combine the block results of their
+  operands in simple loops over the events, which the compiler can vectorize.
+  The block function is only set if every operand has one, and the Baby
+  variables that must be loaded into the block are listed by
+  NamedFunc::BlockColumns(). "&&" and "||" do not short-circuit in block mode,
+  which is safe since only pure functions have a block function.
+
+  Every NamedFunc also records the kind of value it returns
+  (NamedFunc::ResultType): comparisons and logical operators return booleans,
+  integer and boolean Baby variables and arithmetic between them return
+  integers, and everything else, including functions built from lambdas unless
+  set with NamedFunc::Type(), returns reals. Values are always passed as
+  ScalarType. Vector cuts can be evaluated directly into a BitMask with
+  NamedFunc::GetMask(), which uses the result type to pick the faster way of
+  evaluating the cut.
+
+  Vectors built during evaluation take their storage from the VectorArena of the
+  evaluating thread, and operators return the storage of operands they have
+  consumed to it, so that vector expressions avoid the global heap once the
+  pool is warm. Consumers storing a result every event should use
+  NamedFunc::GetVector(const Baby&, VectorType&) to recycle the previous one.
+
   \see FunctionParser for allowed expression syntax for constructing a
   NamedFunc.
 */
 #include "core/named_func.hpp"
 
+#include <cmath>
+
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <utility>
 
 #include "core/utilities.hpp"
+#include "core/event_block.hpp"
+#include "core/vector_kernels.hpp"
+#include "core/vector_arena.hpp"
+#include "core/bit_mask.hpp"
 #include "core/function_parser.hpp"
+#include "core/cut_optimizer.hpp"
+#include "core/func_profiler.hpp"
 
 using namespace std;
 
@@ -55,8 +101,250 @@ using ScalarType = NamedFunc::ScalarType;
 using VectorType = NamedFunc::VectorType;
 using ScalarFunc = NamedFunc::ScalarFunc;
 using VectorFunc = NamedFunc::VectorFunc;
+using SizeFunc = NamedFunc::SizeFunc;
+using ElementFunc = NamedFunc::ElementFunc;
+using BlockFunc = NamedFunc::BlockFunc;
+using ResultType = NamedFunc::ResultType;
 
 namespace{
+  /*!\brief Result type of "+", "-", "*" or "%" between operands of types a
+    and b
+  */
+  ResultType ArithmeticType(ResultType a, ResultType b){
+    if(a == ResultType::real || b == ResultType::real) return ResultType::real;
+    return ResultType::integer;
+  }
+
+  /*!\brief Get a functor building the full vector from element access
+
+    \param[in] size Function returning length of vector
+
+    \param[in] element Function returning single element of vector
+
+    \return Functor which takes a Baby and returns all elements as a vector
+  */
+  function<VectorFunc> ElementsToVector(const function<SizeFunc> &size,
+                                        const function<ElementFunc> &element){
+    return [size, element](const Baby &b){
+      VectorType v = VectorArena::Get(size(b));
+      for(size_t i = 0; i < v.size(); ++i){
+        v[i] = element(b, i);
+      }
+      return v;
+    };
+  }
+
+  /*!\brief Get element access applying unary operator op to elements of f
+
+    \param[in] f Function to which op is applied
+
+    \param[in] op Unary operator to apply to each element of f
+
+    \return Size and element functions of result, or invalid functions if f
+    does not provide element access
+  */
+  template<typename Operator>
+    pair<function<SizeFunc>, function<ElementFunc> > ApplyElementOp(const NamedFunc &f,
+                                                                    const Operator &op){
+    if(!f.HasElements()) return make_pair(function<SizeFunc>(), function<ElementFunc>());
+    function<ScalarType(ScalarType)> op_c(op);
+    function<ElementFunc> e = f.ElementFunction();
+    function<ElementFunc> eo = [e,op_c](const Baby &b, size_t i){
+      return op_c(e(b, i));
+    };
+    return make_pair(f.SizeFunction(), eo);
+  }
+
+  /*!\brief Get element access applying binary operator op between elements of
+    a and b
+
+    Scalar operands are broadcast to every element. The result has element access
+    only if at least one operand is a vector and every vector operand provides
+    element access.
+
+    \param[in] a Left hand operand
+
+    \param[in] b Right hand operand
+
+    \param[in] op Binary operator to apply
+
+    \return Size and element functions of result, possibly invalid
+  */
+  template<typename Operator>
+    pair<function<SizeFunc>, function<ElementFunc> > ApplyElementOp(const NamedFunc &a,
+                                                                    const NamedFunc &b,
+                                                                    const Operator &op){
+    function<ScalarType(ScalarType,ScalarType)> op_c(op);
+    function<SizeFunc> so;
+    function<ElementFunc> eo;
+    if(a.HasElements() && b.HasElements()){
+      function<SizeFunc> sa = a.SizeFunction(), sb = b.SizeFunction();
+      function<ElementFunc> ea = a.ElementFunction(), eb = b.ElementFunction();
+      so = [sa,sb](const Baby &baby){
+        return min(sa(baby), sb(baby));
+      };
+      eo = [ea,eb,op_c](const Baby &baby, size_t i){
+        return op_c(ea(baby, i), eb(baby, i));
+      };
+    }else if(a.HasElements() && b.IsScalar()){
+      function<ElementFunc> ea = a.ElementFunction();
+      function<ScalarFunc> fb = b.ScalarFunction();
+      so = a.SizeFunction();
+      eo = [ea,fb,op_c](const Baby &baby, size_t i){
+        return op_c(ea(baby, i), fb(baby));
+      };
+    }else if(a.IsScalar() && b.HasElements()){
+      function<ScalarFunc> fa = a.ScalarFunction();
+      function<ElementFunc> eb = b.ElementFunction();
+      so = b.SizeFunction();
+      eo = [fa,eb,op_c](const Baby &baby, size_t i){
+        return op_c(fa(baby), eb(baby, i));
+      };
+    }
+    return make_pair(so, eo);
+  }
+
+  /*!\brief Get element access applying "&&" between elements of a and b
+
+    Replaces generic template with short-circuiting "and" logic for each
+    element. \see ApplyElementOp().
+  */
+  template<>
+    pair<function<SizeFunc>, function<ElementFunc> > ApplyElementOp(const NamedFunc &a,
+                                                                    const NamedFunc &b,
+                                                                    const logical_and<ScalarType> &/*op*/){
+    function<SizeFunc> so;
+    function<ElementFunc> eo;
+    if(a.HasElements() && b.HasElements()){
+      function<SizeFunc> sa = a.SizeFunction(), sb = b.SizeFunction();
+      function<ElementFunc> ea = a.ElementFunction(), eb = b.ElementFunction();
+      so = [sa,sb](const Baby &baby){
+        return min(sa(baby), sb(baby));
+      };
+      eo = [ea,eb](const Baby &baby, size_t i){
+        return ea(baby, i) && eb(baby, i);
+      };
+    }else if(a.HasElements() && b.IsScalar()){
+      function<ElementFunc> ea = a.ElementFunction();
+      function<ScalarFunc> fb = b.ScalarFunction();
+      so = a.SizeFunction();
+      eo = [ea,fb](const Baby &baby, size_t i){
+        return ea(baby, i) && fb(baby);
+      };
+    }else if(a.IsScalar() && b.HasElements()){
+      function<ScalarFunc> fa = a.ScalarFunction();
+      function<ElementFunc> eb = b.ElementFunction();
+      so = b.SizeFunction();
+      eo = [fa,eb](const Baby &baby, size_t i){
+        return fa(baby) && eb(baby, i);
+      };
+    }
+    return make_pair(so, eo);
+  }
+
+  /*!\brief Get element access applying "||" between elements of a and b
+
+    Replaces generic template with short-circuiting "or" logic for each
+    element. \see ApplyElementOp().
+  */
+  template<>
+    pair<function<SizeFunc>, function<ElementFunc> > ApplyElementOp(const NamedFunc &a,
+                                                                    const NamedFunc &b,
+                                                                    const logical_or<ScalarType> &/*op*/){
+    function<SizeFunc> so;
+    function<ElementFunc> eo;
+    if(a.HasElements() && b.HasElements()){
+      function<SizeFunc> sa = a.SizeFunction(), sb = b.SizeFunction();
+      function<ElementFunc> ea = a.ElementFunction(), eb = b.ElementFunction();
+      so = [sa,sb](const Baby &baby){
+        return min(sa(baby), sb(baby));
+      };
+      eo = [ea,eb](const Baby &baby, size_t i){
+        return ea(baby, i) || eb(baby, i);
+      };
+    }else if(a.HasElements() && b.IsScalar()){
+      function<ElementFunc> ea = a.ElementFunction();
+      function<ScalarFunc> fb = b.ScalarFunction();
+      so = a.SizeFunction();
+      eo = [ea,fb](const Baby &baby, size_t i){
+        return ea(baby, i) || fb(baby);
+      };
+    }else if(a.IsScalar() && b.HasElements()){
+      function<ScalarFunc> fa = a.ScalarFunction();
+      function<ElementFunc> eb = b.ElementFunction();
+      so = b.SizeFunction();
+      eo = [fa,eb](const Baby &baby, size_t i){
+        return fa(baby) || eb(baby, i);
+      };
+    }
+    return make_pair(so, eo);
+  }
+
+  /*!\brief Get block function applying unary operator op to f
+
+    \param[in] f Function to which op is applied
+
+    \param[in] op Unary operator to apply to each event of the block
+
+    \return Block function and columns of result, or invalid function if f
+    does not have a block function
+  */
+  template<typename Operator>
+    pair<function<BlockFunc>, vector<NamedFunc> > ApplyBlockOp(const NamedFunc &f,
+                                                               const Operator &op){
+    if(!f.HasBlock()) return make_pair(function<BlockFunc>(), vector<NamedFunc>());
+    function<BlockFunc> bf = f.BlockFunction();
+    function<BlockFunc> bo = [bf,op](const EventBlock &block, VectorType &result){
+      bf(block, result);
+      for(size_t i = 0; i < result.size(); ++i){
+        result[i] = op(result[i]);
+      }
+    };
+    return make_pair(bo, f.BlockColumns());
+  }
+
+  /*!\brief Get block function applying binary operator op between a and b
+
+    \param[in] a Left hand operand
+
+    \param[in] b Right hand operand
+
+    \param[in] op Binary operator to apply to each event of the block
+
+    \return Block function and union of the columns of a and b, or invalid
+    function unless both operands have a block function
+  */
+  template<typename Operator>
+    pair<function<BlockFunc>, vector<NamedFunc> > ApplyBlockOp(const NamedFunc &a,
+                                                               const NamedFunc &b,
+                                                               const Operator &op){
+    if(!a.HasBlock() || !b.HasBlock()) return make_pair(function<BlockFunc>(), vector<NamedFunc>());
+    const VectorKernels::Operation kernel = VectorKernels::OperationOf<Operator>::value;
+    function<BlockFunc> ba = a.BlockFunction(), bb = b.BlockFunction();
+    function<BlockFunc> bo = [ba,bb,op](const EventBlock &block, VectorType &result){
+      VectorType other = VectorArena::Get(0);
+      ba(block, result);
+      bb(block, other);
+      if(kernel != VectorKernels::Operation::none){
+        VectorKernels::Apply(kernel, result.data(), other.data(), result.data(), result.size());
+      }else{
+        for(size_t i = 0; i < result.size(); ++i){
+          result[i] = op(result[i], other[i]);
+        }
+      }
+      VectorArena::Recycle(other);
+    };
+    vector<NamedFunc> columns = a.BlockColumns();
+    for(const auto &column: b.BlockColumns()){
+      bool found = false;
+      for(const auto &existing: columns){
+        found = found || existing.Name() == column.Name();
+      }
+      if(!found) columns.push_back(column);
+    }
+    return make_pair(bo, columns);
+  }
+
   /*!\brief Get a functor applying unary operator op to f
 
     \param[in] f Function which takes a Baby and returns a single value
@@ -127,6 +415,7 @@ namespace{
                                                               const function<ScalarFunc> &sfb,
                                                               const function<VectorFunc> &vfb,
                                                               const Operator &op){
+    const VectorKernels::Operation kernel = VectorKernels::OperationOf<Operator>::value;
     function<ScalarType(ScalarType,ScalarType)> op_c(op);
     function<ScalarFunc> sfo;
     function<VectorFunc> vfo;
@@ -135,33 +424,54 @@ namespace{
         return op_c(sfa(b), sfb(b));
       };
     }else if(static_cast<bool>(sfa) && static_cast<bool>(vfb)){
-      vfo = [sfa,vfb,op_c](const Baby &b){
-        ScalarType sa = sfa(b);
-        VectorType vb = vfb(b);
-        VectorType vo(vb.size());
-        for(size_t i = 0; i < vo.size(); ++i){
-          vo.at(i) = op_c(sa, vb.at(i));
-        }
-        return vo;
-      };
+      if(kernel != VectorKernels::Operation::none){
+        vfo = [sfa,vfb](const Baby &b){
+          ScalarType sa = sfa(b);
+          VectorType vo = vfb(b);
+          VectorKernels::Apply(kernel, sa, vo.data(), vo.data(), vo.size());
+          return vo;
+        };
+      }else{
+        vfo = [sfa,vfb,op_c](const Baby &b){
+          ScalarType sa = sfa(b);
+          VectorType vo = vfb(b);
+          for(auto &x: vo){
+            x = op_c(sa, x);
+          }
+          return vo;
+        };
+      }
     }else if(static_cast<bool>(vfa) && static_cast<bool>(sfb)){
-      vfo = [vfa,sfb,op_c](const Baby &b){
-        VectorType va = vfa(b);
-        ScalarType sb = sfb(b);
-        VectorType vo(va.size());
-        for(size_t i = 0; i < vo.size(); ++i){
-          vo.at(i) = op_c(va.at(i), sb);
-        }
-        return vo;
-      };
+      if(kernel != VectorKernels::Operation::none){
+        vfo = [vfa,sfb](const Baby &b){
+          VectorType vo = vfa(b);
+          ScalarType sb = sfb(b);
+          VectorKernels::Apply(kernel, vo.data(), sb, vo.data(), vo.size());
+          return vo;
+        };
+      }else{
+        vfo = [vfa,sfb,op_c](const Baby &b){
+          VectorType vo = vfa(b);
+          ScalarType sb = sfb(b);
+          for(auto &x: vo){
+            x = op_c(x, sb);
+          }
+          return vo;
+        };
+      }
     }else if(static_cast<bool>(vfa) && static_cast<bool>(vfb)){
       vfo = [vfa,vfb,op_c](const Baby &b){
-        VectorType va = vfa(b);
+        VectorType vo = vfa(b);
         VectorType vb = vfb(b);
-        VectorType vo(va.size() > vb.size() ? vb.size() : va.size());
-        for(size_t i = 0; i < vo.size(); ++i){
-          vo.at(i) = op_c(va.at(i), vb.at(i));
+        if(vb.size() < vo.size()) vo.resize(vb.size());
+        if(kernel != VectorKernels::Operation::none){
+          VectorKernels::Apply(kernel, vo.data(), vb.data(), vo.data(), vo.size());
+        }else{
+          for(size_t i = 0; i < vo.size(); ++i){
+            vo[i] = op_c(vo[i], vb[i]);
+          }
         }
+        VectorArena::Recycle(vb);
         return vo;
       };
     }
@@ -199,35 +509,31 @@ namespace{
     }else if(static_cast<bool>(sfa) && static_cast<bool>(vfb)){
       vfo = [sfa,vfb](const Baby &b){
         ScalarType sa = sfa(b);
-        if(!sa){
-          return VectorType(vfb(b).size(), false);
-        }else{
-          return vfb(b);
-        }
+        VectorType vo = vfb(b);
+        if(!sa) fill(vo.begin(), vo.end(), 0.);
+        return vo;
       };
     }else if(static_cast<bool>(vfa) && static_cast<bool>(sfb)){
       vfo = [vfa,sfb](const Baby &b){
-        VectorType va = vfa(b);
-        VectorType vo(va.size());
+        VectorType vo = vfa(b);
         bool evaluated = false;
         ScalarType sb = 0.;
-        for(size_t i = 0; i < vo.size(); ++i){
-          if(!evaluated && va.at(i)){
+        for(auto &x: vo){
+          if(!evaluated && x){
             evaluated = true;
             sb = sfb(b);
           }
-          vo.at(i) = va.at(i)&&sb;
+          x = x&&sb;
         }
         return vo;
       };
     }else if(static_cast<bool>(vfa) && static_cast<bool>(vfb)){
       vfo = [vfa,vfb](const Baby &b){
-        VectorType va = vfa(b);
+        VectorType vo = vfa(b);
         VectorType vb = vfb(b);
-        VectorType vo(va.size() > vb.size() ? vb.size() : va.size());
-        for(size_t i = 0; i < vo.size(); ++i){
-          vo.at(i) = va.at(i)&&vb.at(i);
-        }
+        if(vb.size() < vo.size()) vo.resize(vb.size());
+        VectorKernels::Apply(VectorKernels::Operation::logical_and, vo.data(), vb.data(), vo.data(), vo.size());
+        VectorArena::Recycle(vb);
         return vo;
       };
     }
@@ -265,35 +571,31 @@ namespace{
     }else if(static_cast<bool>(sfa) && static_cast<bool>(vfb)){
       vfo = [sfa,vfb](const Baby &b){
         ScalarType sa = sfa(b);
-        if(sa){
-          return VectorType(vfb(b).size(), true);
-        }else{
-          return vfb(b);
-        }
+        VectorType vo = vfb(b);
+        if(sa) fill(vo.begin(), vo.end(), 1.);
+        return vo;
       };
     }else if(static_cast<bool>(vfa) && static_cast<bool>(sfb)){
       vfo = [vfa,sfb](const Baby &b){
-        VectorType va = vfa(b);
-        VectorType vo(va.size());
+        VectorType vo = vfa(b);
         bool evaluated = false;
         ScalarType sb = 0.;
-        for(size_t i = 0; i < vo.size(); ++i){
-          if(!(evaluated || va.at(i))){
+        for(auto &x: vo){
+          if(!(evaluated || x)){
             evaluated = true;
             sb = sfb(b);
           }
-          vo.at(i) = va.at(i)||sb;
+          x = x||sb;
         }
         return vo;
       };
     }else if(static_cast<bool>(vfa) && static_cast<bool>(vfb)){
       vfo = [vfa,vfb](const Baby &b){
-        VectorType va = vfa(b);
+        VectorType vo = vfa(b);
         VectorType vb = vfb(b);
-        VectorType vo(va.size() > vb.size() ? vb.size() : va.size());
-        for(size_t i = 0; i < vo.size(); ++i){
-          vo.at(i) = va.at(i)||vb.at(i);
-        }
+        if(vb.size() < vo.size()) vo.resize(vb.size());
+        VectorKernels::Apply(VectorKernels::Operation::logical_or, vo.data(), vb.data(), vo.data(), vo.size());
+        VectorArena::Recycle(vb);
         return vo;
       };
     }
@@ -311,8 +613,16 @@ NamedFunc::NamedFunc(const std::string &name,
                      const std::function<ScalarFunc> &function):
   name_(name),
   scalar_func_(function),
-  vector_func_(){
+  vector_func_(),
+  size_func_(),
+  element_func_(),
+  block_func_(),
+  block_columns_(),
+  conjuncts_(),
+  pure_(false),
+  type_(ResultType::real){
   CleanName();
+  Instrument();
 }
 
 /*!\brief Constructor of a vector NamedFunc
@@ -325,18 +635,58 @@ NamedFunc::NamedFunc(const std::string &name,
                      const std::function<VectorFunc> &function):
   name_(name),
   scalar_func_(),
-  vector_func_(function){
+  vector_func_(function),
+  size_func_(),
+  element_func_(),
+  block_func_(),
+  block_columns_(),
+  conjuncts_(),
+  pure_(false),
+  type_(ResultType::real){
   CleanName();
+  Instrument();
   }
 
+/*!\brief Constructor of a vector NamedFunc with access to single elements
+
+  \param[in] name Text representation of function
+
+  \param[in] size_function Functor taking a Baby and returning the vector length
+
+  \param[in] element_function Functor taking a Baby and an index and returning
+  a single element
+*/
+NamedFunc::NamedFunc(const std::string &name,
+                     const std::function<SizeFunc> &size_function,
+                     const std::function<ElementFunc> &element_function):
+  name_(name),
+  scalar_func_(),
+  vector_func_(ElementsToVector(size_function, element_function)),
+  size_func_(size_function),
+  element_func_(element_function),
+  block_func_(),
+  block_columns_(),
+  conjuncts_(),
+  pure_(false),
+  type_(ResultType::real){
+  CleanName();
+  Instrument();
+}
+
 /*!\brief Constructor using FunctionParser to produce a real function from a
   string
 
+  Each distinct string is only parsed once per program (see
+  FunctionParser::Intern()). A cut made of "&&" gets its own
+  CutOptimizer::Chain, so that copies of the same string learn their
+  evaluation order separately.
+
   \param[in] function C++/"TTree::Draw"-like expression containing constants,
   Baby variables, operators, parenthesis, brackets, etc.
 */
 NamedFunc::NamedFunc(const string &function):
-  NamedFunc(FunctionParser(function).ResolveAsNamedFunc()){
+  NamedFunc(*FunctionParser::Intern(function)){
+  NewChain();
 }
 
 /*!\brief Constructor using FunctionParser to produce a real function from a
@@ -366,7 +716,14 @@ NamedFunc::NamedFunc(const TString &function):
 NamedFunc::NamedFunc(ScalarType x):
   name_(ToString(x)),
   scalar_func_([x](const Baby&){return x;}),
-  vector_func_(){
+  vector_func_(),
+  size_func_(),
+  element_func_(),
+  block_func_([x](const EventBlock &block, VectorType &result){result.assign(block.Size(), x);}),
+  block_columns_(),
+  conjuncts_(),
+  pure_(true),
+  type_(isfinite(x) && trunc(x) == x ? ResultType::integer : ResultType::real){
 }
 
 /*!\brief Get the string representation of this function
@@ -400,6 +757,14 @@ NamedFunc & NamedFunc::Function(const std::function<ScalarFunc> &f){
   if(!static_cast<bool>(f)) return *this;
   scalar_func_ = f;
   vector_func_ = function<VectorFunc>();
+  size_func_ = function<SizeFunc>();
+  element_func_ = function<ElementFunc>();
+  block_func_ = function<BlockFunc>();
+  block_columns_.clear();
+  conjuncts_.clear();
+  pure_ = false;
+  type_ = ResultType::real;
+  Instrument();
   return *this;
 }
 
@@ -416,6 +781,50 @@ NamedFunc & NamedFunc::Function(const std::function<VectorFunc> &f){
   if(!static_cast<bool>(f)) return *this;
   scalar_func_ = function<ScalarFunc>();
   vector_func_ = f;
+  size_func_ = function<SizeFunc>();
+  element_func_ = function<ElementFunc>();
+  block_func_ = function<BlockFunc>();
+  block_columns_.clear();
+  conjuncts_.clear();
+  pure_ = false;
+  type_ = ResultType::real;
+  Instrument();
+  return *this;
+}
+
+/*!\brief Set function to vector function with access to single elements
+
+  This function overwrites the vector function and invalidates the scalar
+  function if set. Nothing is changed unless both size_function and
+  element_function are valid.
+
+  \param[in] size_function Valid function taking a Baby and returning the
+  vector length
+
+  \param[in] element_function Valid function taking a Baby and an index and
+  returning a single element
+
+  \param[in] vector_function Optional function building the full vector with
+  the same elements, e.g. with a VectorKernels loop in an operator. If
+  invalid, the vector is built from the single elements.
+
+  \return Reference to *this
+*/
+NamedFunc & NamedFunc::Function(const std::function<SizeFunc> &size_function,
+                                const std::function<ElementFunc> &element_function,
+                                const std::function<VectorFunc> &vector_function){
+  if(!static_cast<bool>(size_function) || !static_cast<bool>(element_function)) return *this;
+  scalar_func_ = function<ScalarFunc>();
+  vector_func_ = static_cast<bool>(vector_function) ? vector_function
+    : ElementsToVector(size_function, element_function);
+  size_func_ = size_function;
+  element_func_ = element_function;
+  block_func_ = function<BlockFunc>();
+  block_columns_.clear();
+  conjuncts_.clear();
+  pure_ = false;
+  type_ = ResultType::real;
+  Instrument();
   return *this;
 }
 
@@ -435,6 +844,83 @@ const function<VectorFunc> & NamedFunc::VectorFunction() const{
   return vector_func_;
 }
 
+/*!\brief Return the (possibly invalid) vector length function
+
+  \return The (possibly invalid) size function associated to *this
+*/
+const function<SizeFunc> & NamedFunc::SizeFunction() const{
+  return size_func_;
+}
+
+/*!\brief Return the (possibly invalid) single element function
+
+  \return The (possibly invalid) element function associated to *this
+*/
+const function<ElementFunc> & NamedFunc::ElementFunction() const{
+  return element_func_;
+}
+
+/*!\brief Set function evaluating the scalar function over an EventBlock
+
+  Nothing is changed unless the block function is valid and *this is scalar.
+  The block function must give the same result as the scalar function for
+  every event of the block.
+
+  \param[in] block_function Valid function filling its second argument with
+  one result per event of the block
+
+  \param[in] block_columns Scalar functions whose values block_function reads
+  from the block with EventBlock::Column()
+
+  \return Reference to *this
+*/
+NamedFunc & NamedFunc::BlockFunction(const std::function<BlockFunc> &block_function,
+                                     const std::vector<NamedFunc> &block_columns){
+  if(!static_cast<bool>(block_function) || !IsScalar()) return *this;
+  block_func_ = block_function;
+  block_columns_ = block_columns;
+  return *this;
+}
+
+/*!\brief Return the (possibly invalid) block function
+
+  \return The (possibly invalid) block function associated to *this
+*/
+const function<BlockFunc> & NamedFunc::BlockFunction() const{
+  return block_func_;
+}
+
+/*!\brief Get scalar functions which must be loaded into an EventBlock to
+  evaluate the block function
+
+  \return Columns read by the block function
+*/
+const vector<NamedFunc> & NamedFunc::BlockColumns() const{
+  return block_columns_;
+}
+
+/*!\brief Make the block function read this scalar function's values from a
+  column of the EventBlock
+
+  Used for Baby variables, which are then loaded once per event into the
+  block and read as contiguous arrays by every function built from them.
+
+  \return Reference to *this
+*/
+NamedFunc & NamedFunc::BlockColumn(){
+  if(!IsScalar()) return *this;
+  NamedFunc column = *this;
+  column.block_func_ = function<BlockFunc>();
+  column.block_columns_.clear();
+  string name = name_;
+  block_func_ = [name](const EventBlock &block, VectorType &result){
+    const VectorType &values = block.Column(name);
+    result.assign(values.cbegin(), values.cbegin()+block.Size());
+  };
+  block_columns_ = {column};
+  return *this;
+}
+
 /*!\brief Check if scalar function is valid
 
   \return True if scalar function is valid; false otherwise.
@@ -451,6 +937,78 @@ bool NamedFunc::IsVector() const{
   return static_cast<bool>(vector_func_);
 }
 
+/*!\brief Check if single elements of vector result can be accessed directly
+
+  \return True if size and element functions are valid; false otherwise.
+*/
+bool NamedFunc::HasElements() const{
+  return static_cast<bool>(size_func_) && static_cast<bool>(element_func_);
+}
+
+/*!\brief Check if scalar function can be evaluated over an EventBlock
+
+  \return True if block function is valid; false otherwise.
+*/
+bool NamedFunc::HasBlock() const{
+  return static_cast<bool>(block_func_);
+}
+
+/*!\brief Check if function may be freely reordered with other functions
+
+  Functions parsed from strings are pure unless they contain a subscript, which
+  may throw if evaluated without its guard. Functions built from C++ lambdas
+  are not pure unless explicitly marked with NamedFunc::Pure().
+
+  \return True if evaluation has no side effects and cannot throw
+*/
+bool NamedFunc::IsPure() const{
+  return pure_;
+}
+
+/*!\brief Mark function as pure (no side effects, cannot throw) or not
+
+  Setting a new function with NamedFunc::Function() resets the flag.
+
+  \param[in] pure Whether function is pure
+
+  \return Reference to *this
+*/
+NamedFunc & NamedFunc::Pure(bool pure){
+  pure_ = pure;
+  return *this;
+}
+
+/*!\brief Get the kind of value returned by the function
+
+  \return Boolean, integer or real
+*/
+ResultType NamedFunc::Type() const{
+  return type_;
+}
+
+/*!\brief Set the kind of value returned by the function
+
+  Setting a new function with NamedFunc::Function() resets the type to real.
+
+  \param[in] type Boolean, integer or real
+
+  \return Reference to *this
+*/
+NamedFunc & NamedFunc::Type(ResultType type){
+  type_ = type;
+  return *this;
+}
+
+/*!\brief Get operands of a chain of scalar "&&"
+
+  Nested "&&" operations are flattened, so a&&(b&&c) has conjuncts a, b, and c.
+
+  \return Operands of "&&", or empty list if *this is not a scalar "&&"
+*/
+const vector<NamedFunc> & NamedFunc::Conjuncts() const{
+  return conjuncts_;
+}
+
 /*!\brief Evaluate scalar function with b as argument
 
   \param[in] b Baby to pass to scalar function
@@ -471,6 +1029,59 @@ VectorType NamedFunc::GetVector(const Baby &b) const{
   return vector_func_(b);
 }
 
+/*!\brief Evaluate vector function with b as argument, recycling the storage
+  previously held by result
+
+  Preferred over GetVector(const Baby&) for members overwritten every event,
+  since the old values go back to the VectorArena instead of being freed.
+
+  \param[in] b Baby to pass to vector function
+
+  \param[in,out] result Set to the result of applying vector function to b
+*/
+void NamedFunc::GetVector(const Baby &b, VectorType &result) const{
+  VectorArena::Recycle(result);
+  result = vector_func_(b);
+}
+
+/*!\brief Evaluate vector function with b as argument into a mask of non-zero
+  results
+
+  Boolean results come from comparisons and logical operators, whose vector
+  functions evaluate the operands once and combine them with VectorKernels,
+  which is faster than calling the composed element function for each
+  element. Other functions with element access, e.g. Baby variables used
+  directly as cuts, are tested element by element without building a
+  VectorType.
+
+  \param[in] b Baby to pass to vector function
+
+  \param[out] result One bit per element, set if the element is non-zero
+*/
+void NamedFunc::GetMask(const Baby &b, BitMask &result) const{
+  if(HasElements() && type_ != ResultType::boolean){
+    size_t size = size_func_(b);
+    result.Resize(size);
+    for(size_t i = 0; i < size; ++i){
+      if(element_func_(b, i)) result.Set(i);
+    }
+  }else{
+    VectorType values = vector_func_(b);
+    result.Assign(values);
+    VectorArena::Recycle(values);
+  }
+}
+
+/*!\brief Evaluate scalar function for every event of block
+
+  \param[in] block Events containing every column in NamedFunc::BlockColumns()
+
+  \param[out] result One result per event of block
+*/
+void NamedFunc::GetBlock(const EventBlock &block, VectorType &result) const{
+  block_func_(block, result);
+}
+
 /*!\brief Add func to *this
 
   \param[in] func Function to be added to *this
@@ -479,11 +1090,19 @@ VectorType NamedFunc::GetVector(const Baby &b) const{
 */
 NamedFunc & NamedFunc::operator += (const NamedFunc &func){
   name_ = "("+name_ + ")+(" + func.name_ + ")";
+  bool pure = pure_ && func.pure_;
+  ResultType type = ArithmeticType(type_, func.type_);
+  auto ep = ApplyElementOp(*this, func, plus<ScalarType>());
+  auto bp = ApplyBlockOp(*this, func, plus<ScalarType>());
   auto fp = ApplyOp(scalar_func_, vector_func_,
                     func.scalar_func_, func.vector_func_,
                     plus<ScalarType>());
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  Function(fp.first);
+  Function(fp.second);
+  Function(ep.first, ep.second, fp.second);
+  BlockFunction(bp.first, bp.second);
+  pure_ = pure;
+  type_ = type;
   return *this;
 }
 
@@ -495,11 +1114,19 @@ NamedFunc & NamedFunc::operator += (const NamedFunc &func){
 */
 NamedFunc & NamedFunc::operator -= (const NamedFunc &func){
   name_ = "("+name_ + ")-(" + func.name_ + ")";
+  bool pure = pure_ && func.pure_;
+  ResultType type = ArithmeticType(type_, func.type_);
+  auto ep = ApplyElementOp(*this, func, minus<ScalarType>());
+  auto bp = ApplyBlockOp(*this, func, minus<ScalarType>());
   auto fp = ApplyOp(scalar_func_, vector_func_,
                     func.scalar_func_, func.vector_func_,
                     minus<ScalarType>());
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  Function(fp.first);
+  Function(fp.second);
+  Function(ep.first, ep.second, fp.second);
+  BlockFunction(bp.first, bp.second);
+  pure_ = pure;
+  type_ = type;
   return *this;
 }
 
@@ -511,11 +1138,19 @@ NamedFunc & NamedFunc::operator -= (const NamedFunc &func){
 */
 NamedFunc & NamedFunc::operator *= (const NamedFunc &func){
   name_ = "("+name_ + ")*(" + func.name_ + ")";
+  bool pure = pure_ && func.pure_;
+  ResultType type = ArithmeticType(type_, func.type_);
+  auto ep = ApplyElementOp(*this, func, multiplies<ScalarType>());
+  auto bp = ApplyBlockOp(*this, func, multiplies<ScalarType>());
   auto fp = ApplyOp(scalar_func_, vector_func_,
                     func.scalar_func_, func.vector_func_,
                     multiplies<ScalarType>());
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  Function(fp.first);
+  Function(fp.second);
+  Function(ep.first, ep.second, fp.second);
+  BlockFunction(bp.first, bp.second);
+  pure_ = pure;
+  type_ = type;
   return *this;
 }
 
@@ -527,11 +1162,18 @@ NamedFunc & NamedFunc::operator *= (const NamedFunc &func){
 */
 NamedFunc & NamedFunc::operator /= (const NamedFunc &func){
   name_ = "("+name_ + ")/(" + func.name_ + ")";
+  bool pure = pure_ && func.pure_;
+  auto ep = ApplyElementOp(*this, func, divides<ScalarType>());
+  auto bp = ApplyBlockOp(*this, func, divides<ScalarType>());
   auto fp = ApplyOp(scalar_func_, vector_func_,
                     func.scalar_func_, func.vector_func_,
                     divides<ScalarType>());
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  Function(fp.first);
+  Function(fp.second);
+  Function(ep.first, ep.second, fp.second);
+  BlockFunction(bp.first, bp.second);
+  pure_ = pure;
+  type_ = ResultType::real;
   return *this;
 }
 
@@ -543,11 +1185,19 @@ NamedFunc & NamedFunc::operator /= (const NamedFunc &func){
 */
 NamedFunc & NamedFunc::operator %= (const NamedFunc &func){
   name_ = "("+name_ + ")%(" + func.name_ + ")";
+  bool pure = pure_ && func.pure_;
+  ResultType type = ArithmeticType(type_, func.type_);
+  auto ep = ApplyElementOp(*this, func, static_cast<ScalarType (*)(ScalarType ,ScalarType)>(fmod));
+  auto bp = ApplyBlockOp(*this, func, static_cast<ScalarType (*)(ScalarType ,ScalarType)>(fmod));
   auto fp = ApplyOp(scalar_func_, vector_func_,
                     func.scalar_func_, func.vector_func_,
                     static_cast<ScalarType (*)(ScalarType ,ScalarType)>(fmod));
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  Function(fp.first);
+  Function(fp.second);
+  Function(ep.first, ep.second, fp.second);
+  BlockFunction(bp.first, bp.second);
+  pure_ = pure;
+  type_ = type;
   return *this;
 }
 
@@ -558,9 +1208,18 @@ NamedFunc NamedFunc::operator [] (const NamedFunc &func) const{
   if(func.IsVector()) ERROR("Cannot use vector "+func.Name()+" as index");
   const auto &vec = VectorFunction();
   const auto &index = func.ScalarFunction();
+  if(HasElements()){
+    const auto &size = SizeFunction();
+    const auto &element = ElementFunction();
+    return NamedFunc("("+Name()+")["+func.Name()+"]", [size, element, index](const Baby &b){
+        size_t i = index(b);
+        if(i >= size(b)) throw out_of_range("NamedFunc index "+to_string(i)+" out of range");
+        return element(b, i);
+      }).Type(type_);
+  }
   return NamedFunc("("+Name()+")["+func.Name()+"]", [vec, index](const Baby &b){
       return vec(b).at(index(b));
-    });
+    }).Type(type_);
 }
 
 /*!\brief Strip spaces from name
@@ -569,6 +1228,31 @@ void NamedFunc::CleanName(){
   ReplaceAll(name_, " ", "");
 }
 
+/*!\brief Evaluate NamedFunc::conjuncts_, if any, with a new
+  CutOptimizer::Chain
+ */
+void NamedFunc::NewChain(){
+  if(conjuncts_.size() == 0) return;
+  auto chain = make_shared<CutOptimizer::Chain>(name_, conjuncts_);
+  scalar_func_ = [chain](const Baby &b){
+    return chain->Evaluate(b);
+  };
+  if(FuncProfiler::Enabled()) scalar_func_ = FuncProfiler::Wrap(FuncProfiler::Register(name_), scalar_func_);
+}
+
+/*!\brief Wrap functions to record calls and time if FuncProfiler is enabled
+
+  The element function is counted separately from the vector function, under
+  the name followed by "[i]".
+*/
+void NamedFunc::Instrument(){
+  if(!FuncProfiler::Enabled()) return;
+  size_t id = FuncProfiler::Register(name_);
+  if(scalar_func_) scalar_func_ = FuncProfiler::Wrap(id, scalar_func_);
+  if(vector_func_) vector_func_ = FuncProfiler::Wrap(id, vector_func_);
+  if(element_func_) element_func_ = FuncProfiler::Wrap(FuncProfiler::Register(name_+"[i]"), element_func_);
+}
+
 /*!\brief Add two \link NamedFunc NamedFuncs\endlink
 
   \param[in] f Augend
@@ -649,8 +1333,17 @@ NamedFunc operator + (NamedFunc f){
 */
 NamedFunc operator - (NamedFunc f){
   f.Name("-(" + f.Name() + ")");
+  bool pure = f.IsPure();
+  ResultType type = f.Type() == ResultType::boolean ? ResultType::integer : f.Type();
+  auto ep = ApplyElementOp(f, negate<ScalarType>());
+  auto bp = ApplyBlockOp(f, negate<ScalarType>());
+  auto vf = ApplyOp(f.VectorFunction(), negate<ScalarType>());
   f.Function(ApplyOp(f.ScalarFunction(), negate<ScalarType>()));
-  f.Function(ApplyOp(f.VectorFunction(), negate<ScalarType>()));
+  f.Function(vf);
+  f.Function(ep.first, ep.second, vf);
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(type);
   return f;
 }
 
@@ -664,11 +1357,18 @@ NamedFunc operator - (NamedFunc f){
 */
 NamedFunc operator == (NamedFunc f, NamedFunc g){
   f.Name("(" + f.Name() + ")==(" + g.Name() + ")");
+  bool pure = f.IsPure() && g.IsPure();
+  auto ep = ApplyElementOp(f, g, equal_to<ScalarType>());
+  auto bp = ApplyBlockOp(f, g, equal_to<ScalarType>());
   auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
                     g.ScalarFunction(), g.VectorFunction(),
                     equal_to<ScalarType>());
   f.Function(fp.first);
   f.Function(fp.second);
+  f.Function(ep.first, ep.second, fp.second);
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(ResultType::boolean);
   return f;
 }
 
@@ -682,11 +1382,18 @@ NamedFunc operator == (NamedFunc f, NamedFunc g){
 */
 NamedFunc operator != (NamedFunc f, NamedFunc g){
   f.Name("(" + f.Name() + ")!=(" + g.Name() + ")");
+  bool pure = f.IsPure() && g.IsPure();
+  auto ep = ApplyElementOp(f, g, not_equal_to<ScalarType>());
+  auto bp = ApplyBlockOp(f, g, not_equal_to<ScalarType>());
   auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
                     g.ScalarFunction(), g.VectorFunction(),
                     not_equal_to<ScalarType>());
   f.Function(fp.first);
   f.Function(fp.second);
+  f.Function(ep.first, ep.second, fp.second);
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(ResultType::boolean);
   return f;
 }
 
@@ -701,11 +1408,18 @@ NamedFunc operator != (NamedFunc f, NamedFunc g){
 */
 NamedFunc operator > (NamedFunc f, NamedFunc g){
   f.Name("(" + f.Name() + ")>(" + g.Name() + ")");
+  bool pure = f.IsPure() && g.IsPure();
+  auto ep = ApplyElementOp(f, g, greater<ScalarType>());
+  auto bp = ApplyBlockOp(f, g, greater<ScalarType>());
   auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
                     g.ScalarFunction(), g.VectorFunction(),
                     greater<ScalarType>());
   f.Function(fp.first);
   f.Function(fp.second);
+  f.Function(ep.first, ep.second, fp.second);
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(ResultType::boolean);
   return f;
 }
 
@@ -719,11 +1433,18 @@ NamedFunc operator > (NamedFunc f, NamedFunc g){
 */
 NamedFunc operator < (NamedFunc f, NamedFunc g){
   f.Name("(" + f.Name() + ")<(" + g.Name() + ")");
+  bool pure = f.IsPure() && g.IsPure();
+  auto ep = ApplyElementOp(f, g, less<ScalarType>());
+  auto bp = ApplyBlockOp(f, g, less<ScalarType>());
   auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
                     g.ScalarFunction(), g.VectorFunction(),
                     less<ScalarType>());
   f.Function(fp.first);
   f.Function(fp.second);
+  f.Function(ep.first, ep.second, fp.second);
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(ResultType::boolean);
   return f;
 }
 
@@ -739,11 +1460,18 @@ NamedFunc operator < (NamedFunc f, NamedFunc g){
 */
 NamedFunc operator >= (NamedFunc f, NamedFunc g){
   f.Name("(" + f.Name() + ")>=(" + g.Name() + ")");
+  bool pure = f.IsPure() && g.IsPure();
+  auto ep = ApplyElementOp(f, g, greater_equal<ScalarType>());
+  auto bp = ApplyBlockOp(f, g, greater_equal<ScalarType>());
   auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
                     g.ScalarFunction(), g.VectorFunction(),
                     greater_equal<ScalarType>());
   f.Function(fp.first);
   f.Function(fp.second);
+  f.Function(ep.first, ep.second, fp.second);
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(ResultType::boolean);
   return f;
 }
 
@@ -759,11 +1487,18 @@ NamedFunc operator >= (NamedFunc f, NamedFunc g){
 */
 NamedFunc operator <= (NamedFunc f, NamedFunc g){
   f.Name("(" + f.Name() + ")<=(" + g.Name() + ")");
+  bool pure = f.IsPure() && g.IsPure();
+  auto ep = ApplyElementOp(f, g, less_equal<ScalarType>());
+  auto bp = ApplyBlockOp(f, g, less_equal<ScalarType>());
   auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
                     g.ScalarFunction(), g.VectorFunction(),
                     less_equal<ScalarType>());
   f.Function(fp.first);
   f.Function(fp.second);
+  f.Function(ep.first, ep.second, fp.second);
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(ResultType::boolean);
   return f;
 }
 
@@ -773,15 +1508,37 @@ NamedFunc operator <= (NamedFunc f, NamedFunc g){
 
   \param[in] g Right hand operand
 
+  Chains of scalar "&&" are flattened into a single CutOptimizer::Chain, which
+  evaluates the operands in the order written unless CutOptimizer is enabled.
+
   \return NamedFunc returning whether the results of both f and g are true
 */
 NamedFunc operator && (NamedFunc f, NamedFunc g){
+  vector<NamedFunc> conjuncts;
+  if(f.IsScalar() && g.IsScalar()){
+    for(const auto &operand: {f, g}){
+      if(operand.conjuncts_.size() != 0){
+        conjuncts.insert(conjuncts.end(), operand.conjuncts_.cbegin(), operand.conjuncts_.cend());
+      }else{
+        conjuncts.push_back(operand);
+      }
+    }
+  }
   f.Name("(" + f.Name() + ")&&(" + g.Name() + ")");
+  bool pure = f.IsPure() && g.IsPure();
+  auto ep = ApplyElementOp(f, g, logical_and<ScalarType>());
+  auto bp = ApplyBlockOp(f, g, logical_and<ScalarType>());
   auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
                     g.ScalarFunction(), g.VectorFunction(),
                     logical_and<ScalarType>());
   f.Function(fp.first);
   f.Function(fp.second);
+  f.Function(ep.first, ep.second, fp.second);
+  f.conjuncts_ = conjuncts;
+  f.NewChain();
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(ResultType::boolean);
   return f;
 }
 
@@ -795,11 +1552,18 @@ NamedFunc operator && (NamedFunc f, NamedFunc g){
 */
 NamedFunc operator || (NamedFunc f, NamedFunc g){
   f.Name("(" + f.Name() + ")||(" + g.Name() + ")");
+  bool pure = f.IsPure() && g.IsPure();
+  auto ep = ApplyElementOp(f, g, logical_or<ScalarType>());
+  auto bp = ApplyBlockOp(f, g, logical_or<ScalarType>());
   auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
                     g.ScalarFunction(), g.VectorFunction(),
                     logical_or<ScalarType>());
   f.Function(fp.first);
   f.Function(fp.second);
+  f.Function(ep.first, ep.second, fp.second);
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(ResultType::boolean);
   return f;
 }
 
@@ -811,8 +1575,16 @@ NamedFunc operator || (NamedFunc f, NamedFunc g){
 */
 NamedFunc operator ! (NamedFunc f){
   f.Name("!(" + f.Name() + ")");
+  bool pure = f.IsPure();
+  auto ep = ApplyElementOp(f, logical_not<ScalarType>());
+  auto bp = ApplyBlockOp(f, logical_not<ScalarType>());
+  auto vf = ApplyOp(f.VectorFunction(), logical_not<ScalarType>());
   f.Function(ApplyOp(f.ScalarFunction(), logical_not<ScalarType>()));
-  f.Function(ApplyOp(f.VectorFunction(), logical_not<ScalarType>()));
+  f.Function(vf);
+  f.Function(ep.first, ep.second, vf);
+  f.BlockFunction(bp.first, bp.second);
+  f.Pure(pure);
+  f.Type(ResultType::boolean);
   return f;
 }
 
@@ -834,6 +1606,10 @@ bool HavePass(const NamedFunc::VectorType &v){
   return false;
 }
 
+bool HavePass(const BitMask &mask){
+  return mask.Any();
+}
+
 bool HavePass(const std::vector<NamedFunc::VectorType> &vv){
   if(vv.size()==0) return false;
   bool this_pass;
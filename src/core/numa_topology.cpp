@@ -0,0 +1,184 @@
+/*! \class NumaTopology
+
+  \brief CPUs of each NUMA node of the machine, read from sysfs
+
+  On machines with several sockets, memory is attached to one socket (NUMA
+  node) and is slower to reach from the others. Linux places a page on the
+  node of the thread that first writes to it, so a thread that stays on one
+  node keeps its histograms, branch buffers and vector arenas local.
+
+  NumaTopology::Get() reads the nodes once from NumaTopology::sysfs_node_dir,
+  keeping only the CPUs the program is allowed to run on (e.g. by a batch
+  system's cgroup or taskset). Nodes without such CPUs are dropped. If sysfs is
+  unavailable, all allowed CPUs form a single node.
+
+  NumaTopology::WorkerNode() gives the node for the i-th worker of a pool,
+  alternating between nodes so that a pool smaller than the machine still
+  uses the memory bandwidth of every socket. When pinning is enabled,
+  ThreadPool binds each worker to all CPUs of that node rather than to a
+  single CPU, so that several processes on the same machine do not stack
+  their workers on the same cores.
+*/
+#include "core/numa_topology.hpp"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <dirent.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+const string NumaTopology::sysfs_node_dir = "/sys/devices/system/node";
+
+/*!\brief Reads the topology from a sysfs node directory
+
+  \param[in] sysfs_dir Directory containing a subdirectory nodeN with a
+  cpulist file for each node
+
+  \param[in] allowed_cpus CPUs that may be used. If empty, all CPUs listed in
+  sysfs are.
+*/
+NumaTopology::NumaTopology(const string &sysfs_dir,
+                           const set<int> &allowed_cpus):
+  node_ids_(),
+  cpus_(),
+  worker_nodes_(){
+  vector<int> node_ids;
+  DIR *dir = opendir(sysfs_dir.c_str());
+  if(dir != nullptr){
+    for(dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir)){
+      string name = entry->d_name;
+      if(name.size() <= 4 || name.substr(0, 4) != "node"
+         || name.find_first_not_of("0123456789", 4) != string::npos) continue;
+      node_ids.push_back(atoi(name.c_str()+4));
+    }
+    closedir(dir);
+  }
+  sort(node_ids.begin(), node_ids.end());
+
+  set<int> used;
+  for(const auto &node_id: node_ids){
+    ifstream file(sysfs_dir+"/node"+to_string(node_id)+"/cpulist");
+    string list;
+    getline(file, list);
+    vector<int> cpus;
+    for(const auto &cpu: ParseCpuList(list)){
+      if((allowed_cpus.empty() || allowed_cpus.count(cpu) > 0) && used.insert(cpu).second){
+        cpus.push_back(cpu);
+      }
+    }
+    if(cpus.empty()) continue;
+    node_ids_.push_back(node_id);
+    cpus_.push_back(cpus);
+  }
+
+  if(cpus_.empty()){
+    vector<int> cpus(allowed_cpus.cbegin(), allowed_cpus.cend());
+    if(cpus.empty()){
+      for(unsigned cpu = 0; cpu < max(thread::hardware_concurrency(), 1u); ++cpu) cpus.push_back(cpu);
+    }
+    node_ids_.assign(1, 0);
+    cpus_.assign(1, cpus);
+  }
+
+  size_t max_cpus = 0;
+  for(const auto &cpus: cpus_) max_cpus = max(max_cpus, cpus.size());
+  for(size_t icpu = 0; icpu < max_cpus; ++icpu){
+    for(size_t inode = 0; inode < cpus_.size(); ++inode){
+      if(icpu < cpus_.at(inode).size()) worker_nodes_.push_back(inode);
+    }
+  }
+}
+
+/*!\brief Topology of the machine the program runs on, restricted to the CPUs
+  allowed when first called
+*/
+const NumaTopology & NumaTopology::Get(){
+  static const NumaTopology topology(sysfs_node_dir, AllowedCpus());
+  return topology;
+}
+
+/*!\brief CPUs the calling thread may run on, empty if unknown
+ */
+set<int> NumaTopology::AllowedCpus(){
+  set<int> cpus;
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0){
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu){
+      if(CPU_ISSET(cpu, &allowed)) cpus.insert(cpu);
+    }
+  }
+#endif
+  return cpus;
+}
+
+/*!\brief Parses a list of CPUs in sysfs format, e.g. "0-31,64-95"
+ */
+vector<int> NumaTopology::ParseCpuList(const string &list){
+  vector<int> cpus;
+  istringstream iss(list);
+  string range;
+  while(getline(iss, range, ',')){
+    if(range.find_first_not_of(" \t\n") == string::npos) continue;
+    size_t dash = range.find('-');
+    int first = atoi(range.substr(0, dash).c_str());
+    int last = dash == string::npos ? first : atoi(range.substr(dash+1).c_str());
+    if(last < first) ERROR("Bad CPU range "+range);
+    for(int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+size_t NumaTopology::NumNodes() const{
+  return node_ids_.size();
+}
+
+/*!\brief Number of usable CPUs on all nodes
+ */
+size_t NumaTopology::NumCpus() const{
+  return worker_nodes_.size();
+}
+
+/*!\brief Number of the inode-th node as used by the kernel
+ */
+int NumaTopology::NodeId(size_t inode) const{
+  return node_ids_.at(inode);
+}
+
+const vector<int> & NumaTopology::Cpus(size_t inode) const{
+  return cpus_.at(inode);
+}
+
+/*!\brief Node number of a CPU, or -1 if it is not usable
+ */
+int NumaTopology::NodeOfCpu(int cpu) const{
+  for(size_t inode = 0; inode < cpus_.size(); ++inode){
+    if(find(cpus_.at(inode).cbegin(), cpus_.at(inode).cend(), cpu) != cpus_.at(inode).cend()){
+      return node_ids_.at(inode);
+    }
+  }
+  return -1;
+}
+
+/*!\brief Index (as in NumaTopology::Cpus()) of the node on which to run the
+  iworker-th worker thread
+
+  Consecutive workers go to different nodes until a node runs out of CPUs, so
+  each node gets as many workers as it has CPUs. Indices beyond the number of
+  CPUs wrap around.
+*/
+size_t NumaTopology::WorkerNode(size_t iworker) const{
+  return worker_nodes_.at(iworker % worker_nodes_.size());
+}
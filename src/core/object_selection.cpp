@@ -0,0 +1,328 @@
+/*! \class ObjectSelection
+
+  \brief Registry of named object selections computed once per event
+
+  The same object-level requirements, e.g. "photon_sig && photon_drmin>0.4 &&
+  photon_pt>15", appear in the cuts of many figures, and each figure evaluates
+  them again for every event. An object selection gives such a requirement a
+  name:
+
+  \code
+  ObjectSelection::Define("goodPhoton := photon_pt>15 && photon_drmin>0.4 && photon_sig");
+  \endcode
+
+  The first function needing the selection for an event evaluates it and
+  stores which objects pass, both as a mask and as a list of indices. Every
+  other function using the selection for the same event, in any figure, reads
+  the stored result. Results are stored separately for each thread and are
+  recognized as stale with Baby::EventId(), so no locking is needed while
+  looping over events.
+
+  Once defined, the name can be used in any expression parsed by
+  FunctionParser:
+  - "goodPhoton" is a vector with one boolean per object of the collection,
+    e.g. "Sum$(goodPhoton && photon_pt>30)"
+  - "Count$(goodPhoton)" is the number of selected objects
+  - "Leading$(goodPhoton)" is the index of the first selected object, or -1 if
+    there is none, so subscripts need a guard, e.g.
+    "Count$(goodPhoton)>0 && photon_pt[Leading$(goodPhoton)]>30"
+  - "Sum$(photon_pt, goodPhoton)" is the sum of photon_pt over the selected
+    objects, which only reads the selected elements
+
+  Selections may be built on other selections, and cannot be redefined.
+  Defining a selection clears the cache of parsed expressions (see
+  FunctionParser::Intern()), so strings parsed before the definition, in which
+  the name was an unknown variable, are parsed again when next used.
+  NamedFuncs already built from such strings are not changed.
+*/
+#include "core/object_selection.hpp"
+
+#include <cctype>
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include "core/utilities.hpp"
+#include "core/vector_arena.hpp"
+#include "core/function_parser.hpp"
+
+using namespace std;
+
+using ScalarType = NamedFunc::ScalarType;
+using VectorType = NamedFunc::VectorType;
+using ResultType = NamedFunc::ResultType;
+
+namespace{
+  struct Definition{
+    string name_;//!<Name used in expressions
+    NamedFunc selection_;//!<Vector function, non-zero for selected objects
+  };
+
+  //! Selection result for the event last seen by the calling thread
+  struct Result{
+    size_t event_id_;//!<Baby::EventId() of the event, 0 if never computed
+    VectorType mask_;//!<1 for selected objects and 0 otherwise
+    vector<size_t> indices_;//!<Indices of selected objects in increasing order
+  };
+
+  mutex & DefinitionMutex(){
+    static mutex m;
+    return m;
+  }
+
+  /*!\brief Defined selections, indexed by id
+
+    A deque so that functions may keep pointers to definitions while others are
+    added.
+  */
+  deque<Definition> & Definitions(){
+    static deque<Definition> definitions;
+    return definitions;
+  }
+
+  unordered_map<string, size_t> & Ids(){
+    static unordered_map<string, size_t> ids;
+    return ids;
+  }
+
+  /*!\brief Results of the calling thread, indexed by selection id
+
+    A deque so that evaluating a selection built on another one may add results
+    without moving the one being computed.
+  */
+  deque<Result> & LocalResults(){
+    thread_local deque<Result> results;
+    return results;
+  }
+
+  /*!\brief Get definition of selection name
+
+    \param[in] name Name of selection
+
+    \param[out] id Index of selection
+
+    \return Definition, valid for the life of the program
+  */
+  const Definition & Find(const string &name, size_t &id){
+    lock_guard<mutex> lock(DefinitionMutex());
+    auto found = Ids().find(name);
+    if(found == Ids().end()) ERROR("Object selection "+name+" is not defined");
+    id = found->second;
+    return Definitions()[id];
+  }
+
+  /*!\brief Get result of selection id for the current event of baby,
+    evaluating it if not yet done for this event
+  */
+  const Result & Evaluate(size_t id, const NamedFunc &selection, const Baby &baby){
+    deque<Result> &results = LocalResults();
+    while(results.size() <= id) results.push_back(Result{0, VectorType(), vector<size_t>()});
+    Result &result = results[id];
+    size_t event_id = baby.EventId();
+    if(event_id != 0 && result.event_id_ == event_id) return result;
+
+    selection.GetVector(baby, result.mask_);
+    result.indices_.clear();
+    for(size_t i = 0; i < result.mask_.size(); ++i){
+      if(result.mask_[i]){
+        result.mask_[i] = 1.;
+        result.indices_.push_back(i);
+      }else{
+        result.mask_[i] = 0.;
+      }
+    }
+    result.event_id_ = event_id;
+    return result;
+  }
+
+  bool IsIdentifier(const string &name){
+    if(name.empty() || !(isalpha(name[0]) || name[0] == '_')) return false;
+    for(const auto &c: name){
+      if(!(isalnum(c) || c == '_')) return false;
+    }
+    return true;
+  }
+
+  string Trim(const string &s){
+    size_t first = s.find_first_not_of(" \t\n");
+    if(first == string::npos) return "";
+    size_t last = s.find_last_not_of(" \t\n");
+    return s.substr(first, last-first+1);
+  }
+}
+
+/*!\brief Defines a selection from a string "name := expression"
+
+  \param[in] definition Name and vector expression separated by ":="
+*/
+void ObjectSelection::Define(const string &definition){
+  size_t split = definition.find(":=");
+  if(split == string::npos){
+    ERROR("Object selection \""+definition+"\" is not of the form \"name := expression\"");
+  }
+  Define(Trim(definition.substr(0, split)), NamedFunc(Trim(definition.substr(split+2))));
+}
+
+/*!\brief Defines a selection
+
+  \param[in] name Name used to refer to the selection in expressions
+
+  \param[in] selection Vector function, non-zero for selected objects
+*/
+void ObjectSelection::Define(const string &name, const NamedFunc &selection){
+  if(!IsIdentifier(name)) ERROR("Invalid object selection name \""+name+"\"");
+  if(!selection.IsVector()){
+    ERROR("Object selection "+name+" := "+selection.Name()+" is not a vector function");
+  }
+  {
+    lock_guard<mutex> lock(DefinitionMutex());
+    if(Ids().count(name)) ERROR("Object selection "+name+" is already defined");
+    Ids()[name] = Definitions().size();
+    Definitions().push_back(Definition{name, selection});
+  }
+  FunctionParser::ClearCache();
+}
+
+/*!\brief Check if a selection is defined
+
+  \param[in] name Name of selection
+*/
+bool ObjectSelection::Exists(const string &name){
+  lock_guard<mutex> lock(DefinitionMutex());
+  return Ids().count(name) != 0;
+}
+
+/*!\brief Names of all defined selections in order of definition
+ */
+vector<string> ObjectSelection::Names(){
+  lock_guard<mutex> lock(DefinitionMutex());
+  vector<string> names;
+  for(const auto &definition: Definitions()){
+    names.push_back(definition.name_);
+  }
+  return names;
+}
+
+/*!\brief Vector function with 1 for selected objects and 0 otherwise
+
+  \param[in] name Name of selection
+*/
+NamedFunc ObjectSelection::Mask(const string &name){
+  size_t id;
+  const NamedFunc *selection = &Find(name, id).selection_;
+  return NamedFunc(name,
+                   [id, selection](const Baby &b){
+                     return Evaluate(id, *selection, b).mask_.size();
+                   },
+                   [id, selection](const Baby &b, size_t i){
+                     return Evaluate(id, *selection, b).mask_[i];
+                   }).Type(ResultType::boolean).Pure(selection->IsPure());
+}
+
+/*!\brief Scalar function returning the number of selected objects
+
+  \param[in] name Name of selection
+*/
+NamedFunc ObjectSelection::Count(const string &name){
+  size_t id;
+  const NamedFunc *selection = &Find(name, id).selection_;
+  return NamedFunc("Count$("+name+")",
+                   [id, selection](const Baby &b){
+                     return ScalarType(Evaluate(id, *selection, b).indices_.size());
+                   }).Type(ResultType::integer).Pure(selection->IsPure());
+}
+
+/*!\brief Scalar function returning the index of the first selected object, or
+  -1 if none is selected
+
+  Subscripting a vector with -1 throws, so a subscript must be guarded by
+  Count(name)>0.
+
+  \param[in] name Name of selection
+*/
+NamedFunc ObjectSelection::Leading(const string &name){
+  size_t id;
+  const NamedFunc *selection = &Find(name, id).selection_;
+  return NamedFunc("Leading$("+name+")",
+                   [id, selection](const Baby &b){
+                     const vector<size_t> &indices = Evaluate(id, *selection, b).indices_;
+                     return indices.empty() ? -1. : ScalarType(indices.front());
+                   }).Type(ResultType::integer).Pure(selection->IsPure());
+}
+
+/*!\brief Scalar function returning the sum of value over selected objects
+
+  Only the selected elements of value are read if value supports element
+  access. A scalar value is counted once per selected object.
+
+  \param[in] name Name of selection
+
+  \param[in] value Function summed, normally a vector over the same collection
+*/
+NamedFunc ObjectSelection::Sum(const string &name, const NamedFunc &value){
+  size_t id;
+  const NamedFunc *selection = &Find(name, id).selection_;
+  ResultType type = value.Type() == ResultType::real ? ResultType::real : ResultType::integer;
+  string func_name = "Sum$("+value.Name()+","+name+")";
+  bool pure = selection->IsPure() && value.IsPure();
+  if(value.IsScalar()){
+    return NamedFunc(func_name,
+                     [id, selection, value](const Baby &b){
+                       return Evaluate(id, *selection, b).indices_.size()*value.GetScalar(b);
+                     }).Type(type).Pure(pure);
+  }
+  if(value.HasElements()){
+    return NamedFunc(func_name,
+                     [id, selection, value](const Baby &b){
+                       const vector<size_t> &indices = Evaluate(id, *selection, b).indices_;
+                       const auto &size = value.SizeFunction();
+                       const auto &element = value.ElementFunction();
+                       size_t num_values = indices.empty() ? 0 : size(b);
+                       ScalarType sum = 0.;
+                       for(const auto &i: indices){
+                         if(i < num_values) sum += element(b, i);
+                       }
+                       return sum;
+                     }).Type(type).Pure(pure);
+  }
+  return NamedFunc(func_name,
+                   [id, selection, value](const Baby &b){
+                     const vector<size_t> &indices = Evaluate(id, *selection, b).indices_;
+                     if(indices.empty()) return 0.;
+                     VectorType values = VectorArena::Get(0);
+                     value.GetVector(b, values);
+                     ScalarType sum = 0.;
+                     for(const auto &i: indices){
+                       if(i < values.size()) sum += values[i];
+                     }
+                     VectorArena::Recycle(values);
+                     return sum;
+                   }).Type(type).Pure(pure);
+}
+
+/*!\brief Indices of the objects selected in the current event of baby
+
+  For use in C++ code filling figures. Looks the selection up by name, so
+  functions from ObjectSelection::Mask() and friends are cheaper per event.
+
+  \param[in] name Name of selection
+
+  \param[in] baby Baby positioned at the event
+
+  \return Indices in increasing order, valid until the next call for this
+  selection on the calling thread
+*/
+const vector<size_t> & ObjectSelection::Indices(const string &name, const Baby &baby){
+  size_t id;
+  const NamedFunc &selection = Find(name, id).selection_;
+  return Evaluate(id, selection, baby).indices_;
+}
+
+/*!\brief Releases the results stored for the calling thread
+
+  PlotMaker calls this at the end of each Baby.
+*/
+void ObjectSelection::Reset(){
+  deque<Result>().swap(LocalResults());
+}
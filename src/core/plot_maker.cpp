@@ -8,6 +8,64 @@
   PlotMaker::MakePlots() determines the full set of \link Process
   Processes\endlink used by all plots, loops once over each Process to fill all
   histograms using that Process, and then prints the plots.
+
+  Programs calling PlotMaker::MakePlots() several times over the same processes
+  can set PlotMaker::cache_bytes_ to keep the variables used by the first loop
+  in memory (see EventCache). Later loops then iterate over the cached events
+  instead of reading the ntuples again. If PlotMaker::cache_preselection_ is
+  set, only events passing it are cached and later loops see only those
+  events, so it must be looser than every cut used afterwards.
+
+  Setting PlotMaker::optimize_cuts_ lets chains of "&&" in cuts measure the pass
+  rate and cost of each term on the first events of each file and evaluate the
+  cheapest and most rejecting terms first (see CutOptimizer).
+
+  If FuncProfiler is enabled, the time, number of calls and pass rate of every
+  NamedFunc during the event loop are printed after it and written to
+  PlotMaker::profile_file_.
+
+  Every call records per-Baby timing, entry counts and bytes read in a
+  RunTelemetry available from PlotMaker::Telemetry() and, if
+  PlotMaker::telemetry_file_ is set, written to that file at the end of
+  PlotMaker::MakePlots().
+
+  If PlotMaker::block_size_ is non-zero, components whose functions can all be
+  evaluated over blocks of events (see FigureComponent::CanRecordBlock()) are
+  filled once per EventBlock of that many entries instead of once per entry.
+  Other components are still filled entry by entry.
+
+  Babies are started in decreasing order of their number of entries as found
+  in the SampleManifest of their directory, if there is one, and progress
+  lines then include an estimate of the remaining time.
+
+  Vector temporaries are drawn from the VectorArena of the worker thread, which
+  is released after each Baby.
+
+  If PlotMaker::memory_budget_ is set, the memory of the filled figures and of
+  the open babies is estimated before the loop and a MemoryPlan limits the
+  number of babies open at once so that both fit the budget. The figures
+  themselves are allocated when pushed and kept until printed, so the budget
+  cannot lower their share. The chosen plan is printed.
+
+  At most one thread per CPU the program may use is started. On machines with
+  several NUMA nodes, PlotMaker::pin_threads_ is set by default, binding the
+  workers to nodes in alternation (see ThreadPool::PinThreads()).
+  Each Baby is opened by the worker processing it, so its branch buffers, the
+  EventCache it fills and the worker's VectorArena are allocated on that
+  worker's node. The entries processed per node are printed after the loop.
+
+  The babies can be split among several processes, e.g. batch jobs. A
+  PlotMaker with PlotMaker::shard_ set to i (of PlotMaker::num_shards_) only
+  loops over its share of the babies and, instead of printing, writes the
+  filled figure components to a result file in PlotMaker::shard_dir_. A
+  PlotMaker with PlotMaker::merge_shards_ set to the number of shards skips the
+  loop, adds up the result files of all shards and prints figures identical to
+  a single process run. Babies are assigned deterministically from their files
+  and processes, balancing entries if known from the SampleManifest, so every
+  shard must run the same program with the same arguments. The settings are
+  initialized from the environment variables DRAW_PICO_SHARD ("i/N"),
+  DRAW_PICO_MERGE (N) and DRAW_PICO_SHARD_DIR, which scripts/run_shards.py
+  sets to run any program in shards.
 */
 #include "core/plot_maker.hpp"
 
@@ -16,14 +74,36 @@
 #include <chrono>
 #include <map>
 #include <iomanip>  // setw
+#include <limits>
+#include <utility>
+#include <fstream>
+#include <sstream>
+#include <typeinfo>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/stat.h>
 
 #include "TLegend.h"
+#include "TChain.h"
+#include "TFile.h"
 
 #include "core/utilities.hpp"
 #include "core/timer.hpp"
 #include "core/thread_pool.hpp"
 #include "core/named_func.hpp"
 #include "core/process.hpp"
+#include "core/skim.hpp"
+#include "core/event_cache.hpp"
+#include "core/event_block.hpp"
+#include "core/vector_arena.hpp"
+#include "core/object_selection.hpp"
+#include "core/sample_manifest.hpp"
+#include "core/memory_plan.hpp"
+#include "core/numa_topology.hpp"
+#include "core/cut_optimizer.hpp"
+#include "core/func_profiler.hpp"
+#include "core/shard_io.hpp"
 
 using namespace std;
 using namespace PlotOptTypes;
@@ -37,6 +117,41 @@ using Clock = chrono::steady_clock;
 
 namespace{
   mutex print_mutex;
+  map<thread::id, size_t> worker_indices;//!<Index of each worker thread in the current event loop. Guarded by print_mutex.
+
+  //! One in this many entries has its time split into I/O, cut and fill
+  const long telemetry_sample_period = 16;
+
+  //! First bytes of a shard result file
+  const string shard_magic = "draw_pico shard result v1";
+
+  string Environment(const string &name){
+    const char *env = getenv(name.c_str());
+    return env == nullptr ? "" : env;
+  }
+
+  //! Components of figure by process name, in a fixed order for shard results
+  vector<pair<string, Figure::FigureComponent*> > ShardComponents(Figure &figure){
+    vector<pair<string, Figure::FigureComponent*> > components;
+    for(const auto &process: figure.GetProcesses()){
+      Figure::FigureComponent *component = figure.GetComponent(process);
+      if(component == nullptr) continue;
+      if(!component->CanMerge()){
+        ERROR("Figure "+figure.GetTag()+" cannot be merged across shards");
+      }
+      components.emplace_back(process->name_, component);
+    }
+    sort(components.begin(), components.end(),
+         [](const pair<string, Figure::FigureComponent*> &a,
+            const pair<string, Figure::FigureComponent*> &b){return a.first < b.first;});
+    for(size_t i = 1; i < components.size(); ++i){
+      if(components.at(i).first == components.at(i-1).first){
+        ERROR("Figure "+figure.GetTag()+" has several processes named "+components.at(i).first
+              +", so its shard results cannot be matched");
+      }
+    }
+    return components;
+  }
 }
 
 /*!\brief Standard constructor
@@ -46,7 +161,34 @@ PlotMaker::PlotMaker():
   min_print_(false),
   print_2d_figures_(true),
   max_entries_(-1),
-  figures_(){
+  event_veto_data_(nullptr),
+  cache_bytes_(0),
+  cache_preselection_(true),
+  optimize_cuts_(false),
+  profile_file_("named_func_profile.json"),
+  telemetry_file_(""),
+  block_size_(0),
+  memory_budget_(0),
+  pin_threads_(NumaTopology::Get().NumNodes() > 1),
+  shard_(-1),
+  num_shards_(1),
+  merge_shards_(0),
+  shard_dir_("shards"),
+  figures_(),
+  telemetry_(),
+  shard_babies_(),
+  num_calls_(0){
+  string shard = Environment("DRAW_PICO_SHARD");
+  if(shard != ""){
+    size_t slash = shard.find('/');
+    if(slash == string::npos) ERROR("DRAW_PICO_SHARD must be of the form i/N, not "+shard);
+    shard_ = stoi(shard.substr(0, slash));
+    num_shards_ = stoi(shard.substr(slash+1));
+  }
+  string merge = Environment("DRAW_PICO_MERGE");
+  if(merge != "") merge_shards_ = stoi(merge);
+  string shard_dir = Environment("DRAW_PICO_SHARD_DIR");
+  if(shard_dir != "") shard_dir_ = shard_dir;
 }
 
 /*!\brief Prints all added plots with given luminosity
@@ -55,6 +197,15 @@ PlotMaker::PlotMaker():
 */
 void PlotMaker::MakePlots(double luminosity,
                           const string &subdir){
+  size_t call = num_calls_++;
+  bool sharded = shard_ >= 0;
+  if(sharded && (num_shards_ < 1 || shard_ >= num_shards_)){
+    ERROR("Invalid shard "+to_string(shard_)+" of "+to_string(num_shards_));
+  }
+  if(sharded && merge_shards_ > 0) ERROR("Cannot run a shard and merge shards at once");
+  if(sharded || merge_shards_ > 0){
+    for(auto &figure: figures_) ShardComponents(*figure);
+  }
 
   // Setup babies with event veto data
   auto babies = GetBabies();
@@ -62,13 +213,36 @@ void PlotMaker::MakePlots(double luminosity,
     baby->SetEventVetoData(event_veto_data_);
   }
 
-  GetYields();
+  // Skims without an explicit branch list keep what later figures use
+  for(size_t ifig = 0; ifig < figures_.size(); ++ifig){
+    Skim *skim = dynamic_cast<Skim*>(figures_.at(ifig).get());
+    if(skim == nullptr || !skim->UsesFigureBranches()) continue;
+    for(size_t jfig = ifig+1; jfig < figures_.size(); ++jfig){
+      skim->AddFunctionBranches(figures_.at(jfig)->GetFunctions());
+    }
+  }
 
-  for(auto &figure: figures_){
-    if ((!(figure->is_2d_histogram()))||print_2d_figures_) {
-      figure->Print(luminosity, subdir);
+  telemetry_.Clear();
+  if(merge_shards_ > 0){
+    MergeShards(call);
+  }else{
+    if(sharded) AssignShardBabies();
+    size_t max_threads = NumaTopology::Get().NumCpus();
+    GetYields(PlanThreads(max_threads));
+    if(!min_print_) telemetry_.PrintNodes(cout);
+  }
+
+  if(sharded){
+    WriteShard(call);
+  }else{
+    for(auto &figure: figures_){
+      if ((!(figure->is_2d_histogram()))||print_2d_figures_) {
+        figure->Print(luminosity, subdir);
+      }
     }
   }
+
+  if(telemetry_file_ != "") telemetry_.Write(telemetry_file_);
 }
 
 const std::unique_ptr<Figure> & PlotMaker::GetFigure(std::string tag) const {
@@ -93,26 +267,91 @@ void PlotMaker::Clear(){
   figures_.clear();
 }
 
+/*!\brief Measurements of the event loop of the last PlotMaker::MakePlots call
+ */
+const RunTelemetry & PlotMaker::Telemetry() const{
+  return telemetry_;
+}
+
 void PlotMaker::SetEventVetoData(void * eventVetoData) {
   event_veto_data_ = eventVetoData;
 }
 
-void PlotMaker::GetYields(){
+/*!\brief Number of babies to process at once, at most max_threads and as
+  many as fit PlotMaker::memory_budget_ if it is set
+*/
+size_t PlotMaker::PlanThreads(size_t max_threads) const{
+  if(memory_budget_ == 0) return max_threads;
+
+  vector<size_t> figure_bytes;
+  for(const auto &figure: figures_){
+    size_t bytes = 0;
+    for(const auto &process: figure->GetProcesses()){
+      const Figure::FigureComponent *component = figure->GetComponent(process);
+      if(component != nullptr) bytes += component->EstimateBytes();
+    }
+    figure_bytes.push_back(bytes);
+  }
+  set<Baby*> babies = LoopBabies();
+  size_t baby_bytes = 0;
+  for(const auto &baby: babies){
+    baby_bytes = max(baby_bytes, MemoryPlan::EstimateBabyBytes(baby->FileNames()));
+  }
+  if(!multithreaded_) max_threads = 1;
+  max_threads = max(min(max_threads, babies.size()), static_cast<size_t>(1));
+
+  MemoryPlan plan(figure_bytes, baby_bytes, cache_bytes_, max_threads, memory_budget_);
+  plan.Print(cout);
+  return plan.NumThreads();
+}
+
+/*!\brief Loops over the babies of the processes used by the figures and
+  fills them
+
+  \param[in] max_threads Largest number of babies to process at once
+*/
+void PlotMaker::GetYields(size_t max_threads){
   auto start_time = Clock::now();
 
-  auto babies = GetBabies();
-  size_t num_threads = multithreaded_ ? min(babies.size(), static_cast<size_t>(thread::hardware_concurrency())) : 1;
-  cout << "Processing " << babies.size() << " babies with " << num_threads << " threads." << endl;
+  EventCache::SetBudget(cache_bytes_);
+  CutOptimizer::Enable(optimize_cuts_);
+  if(FuncProfiler::Enabled()) FuncProfiler::Reset();
+  worker_indices.clear();
+
+  // Babies whose entry counts are known from a SampleManifest start largest
+  // first so that a long file does not end up running alone at the end.
+  // Babies of unknown size go first.
+  vector<pair<long, Baby*> > babies;
+  long expected_entries = 0;
+  bool known_entries = true;
+  for(const auto &baby: LoopBabies()){
+    long entries = SampleManifest::Entries(baby->FileNames());
+    if(entries < 0){
+      known_entries = false;
+      entries = numeric_limits<long>::max();
+    }else{
+      if(max_entries_ > 0) entries = min(entries, max_entries_);
+      expected_entries += entries;
+    }
+    babies.emplace_back(entries, baby);
+  }
+  stable_sort(babies.begin(), babies.end(),
+              [](const pair<long, Baby*> &a, const pair<long, Baby*> &b){return a.first > b.first;});
+
+  size_t num_threads = multithreaded_ ? min(babies.size(), max_threads) : 1;
+  cout << "Processing " << babies.size() << " babies";
+  if(known_entries) cout << " (" << AddCommas(expected_entries) << " entries)";
+  cout << " with " << num_threads << " threads." << endl;
 
   long num_entries = 0;
 
   if(multithreaded_ && num_threads>1){
     vector<future<long> > num_entries_future(babies.size());
 
-    ThreadPool tp(num_threads);
+    ThreadPool tp(num_threads, pin_threads_);
     size_t Nbabies = 0;
     for(const auto &baby: babies){
-      num_entries_future.at(Nbabies) = tp.Push(bind(&PlotMaker::GetYield, this, ref(baby)));
+      num_entries_future.at(Nbabies) = tp.Push(bind(&PlotMaker::GetYield, this, baby.second));
       ++Nbabies;
     }
     size_t Nfiles=0;
@@ -125,22 +364,34 @@ void PlotMaker::GetYields(){
 	double seconds = chrono::duration<double>(Clock::now()-start_entries_time).count();
 	cout<<"Done "<<setw(log10(Nbabies)+1)<<Nfiles<<"/"<<Nbabies<<" files: "<<setw(10)<<AddCommas(num_entries)
 	    <<" entries in "<<HoursMinSec(seconds)<<"  ->  "<<setw(5)<<RoundNumber(num_entries/1000.,1,seconds)
-	    <<" kHz "<<endl;
+	    <<" kHz";
+        if(known_entries && num_entries > 0 && expected_entries > num_entries){
+          cout<<"  ETA "<<HoursMinSec(seconds*(expected_entries-num_entries)/num_entries);
+        }
+        cout<<endl;
       }
     }
   }else{
     for(const auto &baby: babies){
-      num_entries += GetYield(ref(baby));
+      num_entries += GetYield(baby.second);
     }
   }
   auto end_time = Clock::now();
   double num_seconds = chrono::duration<double>(end_time-start_time).count();
+  telemetry_.Finish(num_threads, num_seconds);
   if(!min_print_) cout << endl << num_threads << " threads processed "
 		       << babies.size() << " babies with "
 		       << AddCommas(num_entries) << " events in "
 		       << num_seconds << " seconds = "
 		       << 0.001*num_entries/num_seconds << " kHz."
 		       << endl;
+  if(cache_bytes_ > 0) cout << "Event cache uses " << RoundNumber(EventCache::TotalBytes(), 1, 1<<20)
+                            << " of " << RoundNumber(cache_bytes_, 1, 1<<20) << " MB." << endl;
+  if(optimize_cuts_ && !min_print_) CutOptimizer::Report(cout);
+  if(FuncProfiler::Enabled()){
+    FuncProfiler::Report(cout);
+    if(profile_file_ != "") FuncProfiler::WriteJson(profile_file_);
+  }
   cout << endl;
 }
 
@@ -163,9 +414,21 @@ long PlotMaker::GetYield(Baby *baby_ptr){
   oss << "]" << flush;
   tag += oss.str();
 
+  EventCache *cache = nullptr;
+  if(cache_bytes_ > 0 && baby.Cache().Start()) cache = &baby.Cache();
+  bool replay = cache != nullptr && cache->Complete();
+
   long num_entries = baby.GetEntries();
   if (max_entries_ > 0) 
     num_entries = max_entries_ < num_entries ? max_entries_ : num_entries;
+  bool full_pass = num_entries == baby.GetEntries();
+  if(replay){
+    long num_rows = cache->NumRows();
+    while(num_rows > 0 && cache->Entry(num_rows-1) >= num_entries) --num_rows;
+    full_pass = num_rows == static_cast<long>(cache->NumRows());
+    num_entries = num_rows;
+    tag += " (cached)";
+  }
 
   vector<pair<const Process*, set<Figure::FigureComponent*> > > proc_figs(baby.processes_.size());
   size_t iproc = 0;
@@ -175,28 +438,182 @@ long PlotMaker::GetYield(Baby *baby_ptr){
     ++iproc;
   }
 
+  // Split components into those filled per entry and per block. Process cuts
+  // are evaluated per block if no component needs them per entry.
+  bool use_blocks = block_size_ > 0;
+  EventBlock block(use_blocks ? block_size_ : 1);
+  vector<vector<Figure::FigureComponent*> > event_comps(proc_figs.size()), block_comps(proc_figs.size());
+  vector<bool> block_cut(proc_figs.size(), false);
+  vector<VectorType> block_pass(proc_figs.size());
+  for(size_t ipf = 0; ipf < proc_figs.size(); ++ipf){
+    for(const auto &component: proc_figs.at(ipf).second){
+      if(use_blocks && component->CanRecordBlock()){
+        block_comps.at(ipf).push_back(component);
+        for(const auto &func: component->figure_.GetFunctions()){
+          block.AddColumns(func);
+        }
+      }else{
+        event_comps.at(ipf).push_back(component);
+      }
+    }
+    const NamedFunc &cut = proc_figs.at(ipf).first->cut_;
+    if(block_comps.at(ipf).size() != 0) block.AddColumns(cut);
+    block_cut.at(ipf) = block_comps.at(ipf).size() != 0 && event_comps.at(ipf).size() == 0 && cut.HasBlock();
+    block_pass.at(ipf).resize(block.Capacity());
+  }
+
+  // Time split is measured on sampled entries and scaled to the loop time,
+  // except for blocks, which are always timed
+  vector<long> entries_passed(proc_figs.size(), 0);
+  double sampled_io = 0., sampled_cut = 0., sampled_fill = 0.;
+  double block_cut_seconds = 0., block_fill_seconds = 0.;
+  VectorType pass_vector;
+  const TChain *chain = baby.GetTree().get();
+  int tree_number = -1;
+  long long bytes_read = 0, file_bytes = 0;
+  auto loop_time = Clock::now();
+
   Timer timer(tag, num_entries, 10.);
-  for(long entry = 0; entry < num_entries; ++entry){
+  for(long ientry = 0; ientry < num_entries; ++ientry){
     if(!min_print_) timer.Iterate();
+    bool sample = ientry % telemetry_sample_period == 0;
+    Clock::time_point sample_time;
+    if(sample) sample_time = Clock::now();
+    // Only resets the Baby's variables, so cached rows are not read from disk
+    long entry = replay ? cache->Entry(ientry) : ientry;
     baby.GetEntry(entry);
+    if(replay){
+      cache->SetRow(ientry);
+    }else if(cache != nullptr){
+      cache->SetEntry(entry);
+    }
+    if(sample){
+      auto now = Clock::now();
+      sampled_io += chrono::duration<double>(now-sample_time).count();
+      sample_time = now;
+    }
 
-    for(const auto &proc_fig: proc_figs){
+    for(size_t ipf = 0; ipf < proc_figs.size(); ++ipf){
+      if(block_cut[ipf]) continue;
+      const auto &proc_fig = proc_figs[ipf];
+      bool pass;
       if(proc_fig.first->cut_.IsScalar()){
-        if(!proc_fig.first->cut_.GetScalar(baby)) continue;
+        pass = proc_fig.first->cut_.GetScalar(baby);
       }else{
-        if(!HavePass(proc_fig.first->cut_.GetVector(baby))) continue;
+        proc_fig.first->cut_.GetVector(baby, pass_vector);
+        pass = HavePass(pass_vector);
       }
-      for(const auto &component: proc_fig.second){
+      if(sample){
+        auto now = Clock::now();
+        sampled_cut += chrono::duration<double>(now-sample_time).count();
+        sample_time = now;
+      }
+      if(use_blocks) block_pass[ipf][block.Size()] = pass;
+      if(!pass) continue;
+      ++entries_passed[ipf];
+      for(const auto &component: event_comps[ipf]){
 	lock_guard<mutex> lock(component->mutex_);
         component->RecordEvent(baby);
       }
+      if(sample){
+        auto now = Clock::now();
+        sampled_fill += chrono::duration<double>(now-sample_time).count();
+        sample_time = now;
+      }
+    }
+
+    if(cache != nullptr){
+      bool keep = replay;
+      if(!replay){
+        if(cache_preselection_.IsScalar()){
+          keep = cache_preselection_.GetScalar(baby);
+        }else{
+          cache_preselection_.GetVector(baby, pass_vector);
+          keep = HavePass(pass_vector);
+        }
+      }
+      cache->EndEntry(baby, keep);
+      if(sample) sampled_io += chrono::duration<double>(Clock::now()-sample_time).count();
+    }
+
+    if(use_blocks){
+      if(sample) sample_time = Clock::now();
+      block.Append(baby);
+      if(sample) sampled_io += chrono::duration<double>(Clock::now()-sample_time).count();
+      if(block.Full() || ientry+1 == num_entries){
+        for(size_t ipf = 0; ipf < proc_figs.size(); ++ipf){
+          if(block_comps[ipf].size() == 0) continue;
+          auto block_time = Clock::now();
+          VectorType &pass = block_pass[ipf];
+          if(block_cut[ipf]){
+            proc_figs[ipf].first->cut_.GetBlock(block, pass);
+            for(size_t i = 0; i < block.Size(); ++i){
+              if(pass[i]) ++entries_passed[ipf];
+            }
+          }
+          auto fill_time = Clock::now();
+          for(const auto &component: block_comps[ipf]){
+            lock_guard<mutex> lock(component->mutex_);
+            component->RecordBlock(block, pass);
+          }
+          block_cut_seconds += chrono::duration<double>(fill_time-block_time).count();
+          block_fill_seconds += chrono::duration<double>(Clock::now()-fill_time).count();
+        }
+        block.Clear();
+      }
+    }
+
+    // TChain replaces the file when moving on, so bytes are added up per file
+    if(chain != nullptr){
+      if(chain->GetTreeNumber() != tree_number){
+        bytes_read += file_bytes;
+        tree_number = chain->GetTreeNumber();
+      }
+      const TFile *file = chain->GetCurrentFile();
+      file_bytes = file == nullptr ? 0 : file->GetBytesRead();
     }
   }
+  bytes_read += file_bytes;
+  if(cache != nullptr) cache->Finish(full_pass);
+
+  auto finish_time = Clock::now();
+  for(const auto &proc_fig: proc_figs){
+    for(const auto &component: proc_fig.second){
+      lock_guard<mutex> lock(component->mutex_);
+      component->FinishBaby(baby);
+    }
+  }
+  VectorArena::Reset();
+  ObjectSelection::Reset();
+  CutOptimizer::Reset();
 
   auto end_time = Clock::now();
   double num_seconds = chrono::duration<double>(end_time - start_time).count();
+  double loop_seconds = chrono::duration<double>(finish_time - loop_time).count();
+  double sampled_seconds = sampled_io + sampled_cut + sampled_fill;
+  double block_seconds = block_cut_seconds + block_fill_seconds;
+  double scale = sampled_seconds > 0. ? max(loop_seconds-block_seconds, 0.)/sampled_seconds : 0.;
+
+  RunTelemetry::BabyRecord record;
+  record.tag_ = tag;
+  record.open_seconds_ = chrono::duration<double>(loop_time - start_time).count();
+  record.io_seconds_ = scale*sampled_io;
+  record.cut_seconds_ = scale*sampled_cut + block_cut_seconds;
+  record.fill_seconds_ = scale*sampled_fill + block_fill_seconds;
+  record.finish_seconds_ = chrono::duration<double>(end_time - finish_time).count();
+  record.total_seconds_ = num_seconds;
+  record.entries_read_ = num_entries;
+  for(size_t ipf = 0; ipf < proc_figs.size(); ++ipf){
+    record.entries_passed_.emplace_back(proc_figs.at(ipf).first->name_, entries_passed.at(ipf));
+  }
+  record.bytes_read_ = bytes_read;
+  record.cached_ = replay;
   {
     lock_guard<mutex> lock(print_mutex);
+    auto worker = worker_indices.emplace(this_thread::get_id(), worker_indices.size()).first;
+    record.worker_ = worker->second;
+    record.node_ = ThreadPool::CurrentNode();
+    telemetry_.Add(record);
     if(!min_print_) cout << setw(9) << num_entries << " entries/"
                          << setw(10) << num_seconds << " sec.="
                          << setw(10) << 0.001*num_entries/num_seconds << " kHz for " << tag << endl;
@@ -204,6 +621,139 @@ long PlotMaker::GetYield(Baby *baby_ptr){
   return num_entries;
 }
 
+/*!\brief Chooses the babies processed by shard PlotMaker::shard_
+
+  Babies are ordered by their type, files and processes so that every shard of
+  the same program finds the same order. If the entries of all babies are
+  known from the SampleManifest, each baby, largest first, goes to the shard
+  with the fewest entries so far. Otherwise they are dealt round-robin.
+*/
+void PlotMaker::AssignShardBabies(){
+  vector<pair<string, Baby*> > babies;
+  bool known_entries = true;
+  for(const auto &baby: GetBabies()){
+    string key = typeid(*baby).name();
+    for(const auto &file: baby->FileNames()) key += "\n"+file;
+    set<string> processes;
+    for(const auto &proc: baby->processes_) processes.insert(proc->name_+" "+proc->cut_.Name());
+    for(const auto &proc: processes) key += "\n"+proc;
+    babies.emplace_back(key, baby);
+    if(SampleManifest::Entries(baby->FileNames()) < 0) known_entries = false;
+  }
+  sort(babies.begin(), babies.end(),
+       [](const pair<string, Baby*> &a, const pair<string, Baby*> &b){return a.first < b.first;});
+  for(size_t ibaby = 1; ibaby < babies.size(); ++ibaby){
+    if(babies.at(ibaby).first == babies.at(ibaby-1).first){
+      ERROR("Cannot split babies among shards: several babies read the same files for the same processes");
+    }
+  }
+
+  shard_babies_.clear();
+  if(!known_entries){
+    for(size_t ibaby = 0; ibaby < babies.size(); ++ibaby){
+      if(ibaby % num_shards_ == static_cast<size_t>(shard_)) shard_babies_.insert(babies.at(ibaby).second);
+    }
+  }else{
+    vector<pair<long, size_t> > entries;
+    for(size_t ibaby = 0; ibaby < babies.size(); ++ibaby){
+      entries.emplace_back(SampleManifest::Entries(babies.at(ibaby).second->FileNames()), ibaby);
+    }
+    stable_sort(entries.begin(), entries.end(),
+                [](const pair<long, size_t> &a, const pair<long, size_t> &b){return a.first > b.first;});
+    vector<long> shard_entries(num_shards_, 0);
+    for(const auto &baby: entries){
+      auto ishard = min_element(shard_entries.begin(), shard_entries.end()) - shard_entries.begin();
+      shard_entries.at(ishard) += baby.first;
+      if(ishard == shard_) shard_babies_.insert(babies.at(baby.second).second);
+    }
+  }
+  cout << "Shard " << shard_ << " of " << num_shards_ << " processes " << shard_babies_.size()
+       << " of " << babies.size() << " babies." << endl;
+}
+
+/*!\brief Path of the result of shard for the call-th PlotMaker::MakePlots call
+ */
+string PlotMaker::ShardFile(size_t call, int shard) const{
+  return shard_dir_+"/result_"+to_string(call)+"_shard_"+to_string(shard)+".bin";
+}
+
+/*!\brief Writes the state of every figure component to the result file of
+  this shard
+
+  The file is written under a temporary name and renamed when complete, so a
+  failed shard never leaves a result that could be merged.
+*/
+void PlotMaker::WriteShard(size_t call){
+  mkdir(shard_dir_.c_str(), 0777);
+  string path = ShardFile(call, shard_);
+  string tmp_path = path+".tmp";
+  ofstream out(tmp_path, ios::binary);
+  if(!out) ERROR("Could not open shard result "+tmp_path);
+  ShardIO::WriteString(out, shard_magic);
+  ShardIO::Write(out, num_shards_);
+  ShardIO::Write(out, shard_);
+  ShardIO::Write<size_t>(out, figures_.size());
+  for(auto &figure: figures_){
+    vector<pair<string, Figure::FigureComponent*> > components = ShardComponents(*figure);
+    ShardIO::Write<size_t>(out, components.size());
+    for(const auto &component: components){
+      ostringstream state;
+      component.second->WriteState(state);
+      ShardIO::WriteString(out, component.first);
+      ShardIO::WriteString(out, state.str());
+    }
+  }
+  out.close();
+  if(!out) ERROR("Could not write shard result "+tmp_path);
+  if(rename(tmp_path.c_str(), path.c_str()) != 0) ERROR("Could not rename "+tmp_path+" to "+path);
+  cout << "Wrote shard result " << path << endl;
+}
+
+/*!\brief Adds the results of all PlotMaker::merge_shards_ shards to the
+  figure components
+
+  The files must have been written by the same program, with the same
+  figures and processes.
+*/
+void PlotMaker::MergeShards(size_t call){
+  for(int ishard = 0; ishard < merge_shards_; ++ishard){
+    string path = ShardFile(call, ishard);
+    ifstream in(path, ios::binary);
+    if(!in) ERROR("Could not open shard result "+path);
+    if(ShardIO::ReadString(in) != shard_magic) ERROR(path+" is not a shard result");
+    int num_shards = ShardIO::Read<int>(in);
+    int shard = ShardIO::Read<int>(in);
+    if(num_shards != merge_shards_ || shard != ishard){
+      ERROR(path+" holds shard "+to_string(shard)+" of "+to_string(num_shards)
+            +" instead of "+to_string(ishard)+" of "+to_string(merge_shards_));
+    }
+    size_t num_figures = ShardIO::Read<size_t>(in);
+    if(num_figures != figures_.size()){
+      ERROR(path+" has "+to_string(num_figures)+" figures instead of "+to_string(figures_.size()));
+    }
+    for(auto &figure: figures_){
+      vector<pair<string, Figure::FigureComponent*> > components = ShardComponents(*figure);
+      size_t num_components = ShardIO::Read<size_t>(in);
+      if(num_components != components.size()){
+        ERROR(path+" has "+to_string(num_components)+" processes for figure "+figure->GetTag()
+              +" instead of "+to_string(components.size()));
+      }
+      for(const auto &component: components){
+        string name = ShardIO::ReadString(in);
+        if(name != component.first){
+          ERROR(path+" has process "+name+" instead of "+component.first+" for figure "+figure->GetTag());
+        }
+        istringstream state(ShardIO::ReadString(in));
+        component.second->MergeState(state);
+        if(state.peek() != istringstream::traits_type::eof()){
+          ERROR(path+" has unread data for process "+name+" of figure "+figure->GetTag());
+        }
+      }
+    }
+  }
+  cout << "Merged " << merge_shards_ << " shard results from " << shard_dir_ << "." << endl << endl;
+}
+
 set<Baby*> PlotMaker::GetBabies() const{
   set<Baby*> babies;
   for(auto &proc: GetProcesses()){
@@ -214,6 +764,14 @@ set<Baby*> PlotMaker::GetBabies() const{
   return babies;
 }
 
+/*!\brief Babies processed by the event loop, only those of this shard if
+  PlotMaker::shard_ is set
+*/
+set<Baby*> PlotMaker::LoopBabies() const{
+  if(shard_ < 0) return GetBabies();
+  return shard_babies_;
+}
+
 set<const Process*> PlotMaker::GetProcesses() const{
   set<const Process*> processes;
   for(const auto &figure: figures_){
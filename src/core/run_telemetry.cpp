@@ -0,0 +1,255 @@
+/*! \class RunTelemetry
+
+  \brief Per-Baby timing, throughput and I/O measurements of a PlotMaker run
+
+  PlotMaker::MakePlots() adds one BabyRecord for every Baby it loops over,
+  giving the worker thread that processed it, the wall time split into opening
+  the files, reading entries, evaluating process cuts, filling figures and
+  finishing, the number of entries read and passing each process cut, and the
+  bytes read from disk. The peak memory of the program is only known for the
+  process as a whole, so it is recorded once at the end of the loop. The records
+  are available from PlotMaker::Telemetry() and can be written as JSON or CSV
+  to size batch jobs and find slow files.
+
+  If the workers are bound to NUMA nodes (see ThreadPool::PinThreads()), each
+  record also gives the node, and RunTelemetry::PrintNodes() and the JSON
+  output summarize the throughput of each node to check scaling across
+  sockets.
+
+  Branches are read lazily when a variable is first used in an entry, so most
+  of the disk reading and decompression shows up as cut or fill time rather
+  than in io_seconds_.
+*/
+#include "core/run_telemetry.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include <sys/resource.h>
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  //! Babies, entries and busy worker seconds of one NUMA node
+  struct NodeSummary{
+    int node_;
+    size_t babies_;
+    long entries_;
+    double seconds_;
+  };
+
+  vector<NodeSummary> SummarizeNodes(const vector<RunTelemetry::BabyRecord> &records){
+    vector<NodeSummary> nodes;
+    for(const auto &record: records){
+      auto node = find_if(nodes.begin(), nodes.end(),
+                          [&record](const NodeSummary &n){return n.node_ == record.node_;});
+      if(node == nodes.end()) node = nodes.insert(nodes.end(), NodeSummary{record.node_, 0, 0, 0.});
+      ++node->babies_;
+      node->entries_ += record.entries_read_;
+      node->seconds_ += record.total_seconds_;
+    }
+    sort(nodes.begin(), nodes.end(),
+         [](const NodeSummary &a, const NodeSummary &b){return a.node_ < b.node_;});
+    return nodes;
+  }
+
+  string JsonEscape(const string &s){
+    string result;
+    for(const auto &c: s){
+      if(c == '"' || c == '\\') result += '\\';
+      result += c;
+    }
+    return result;
+  }
+
+  string CsvEscape(const string &s){
+    string result = "\"";
+    for(const auto &c: s){
+      if(c == '"') result += '"';
+      result += c;
+    }
+    return result+"\"";
+  }
+}
+
+/*!\brief Standard constructor
+ */
+RunTelemetry::RunTelemetry():
+  records_(),
+  num_threads_(0),
+  seconds_(0.),
+  peak_rss_kb_(0){
+}
+
+/*!\brief Removes all records
+ */
+void RunTelemetry::Clear(){
+  records_.clear();
+  num_threads_ = 0;
+  seconds_ = 0.;
+  peak_rss_kb_ = 0;
+}
+
+/*!\brief Adds measurements of one Baby
+
+  \param[in] record Measurements to add
+*/
+void RunTelemetry::Add(const BabyRecord &record){
+  records_.push_back(record);
+}
+
+/*!\brief Sets the properties of the whole event loop and records the peak
+  memory of the program up to now
+
+  \param[in] num_threads Number of worker threads used
+
+  \param[in] seconds Wall time of the event loop
+*/
+void RunTelemetry::Finish(size_t num_threads, double seconds){
+  num_threads_ = num_threads;
+  seconds_ = seconds;
+  peak_rss_kb_ = CurrentPeakRssKb();
+}
+
+const vector<RunTelemetry::BabyRecord> & RunTelemetry::Records() const{
+  return records_;
+}
+
+size_t RunTelemetry::NumThreads() const{
+  return num_threads_;
+}
+
+double RunTelemetry::Seconds() const{
+  return seconds_;
+}
+
+long RunTelemetry::EntriesRead() const{
+  long entries = 0;
+  for(const auto &record: records_) entries += record.entries_read_;
+  return entries;
+}
+
+long long RunTelemetry::BytesRead() const{
+  long long bytes = 0;
+  for(const auto &record: records_) bytes += record.bytes_read_;
+  return bytes;
+}
+
+/*!\brief Peak resident memory of the program, including anything before the
+  event loop, in kB when the loop finished
+*/
+long RunTelemetry::PeakRssKb() const{
+  return peak_rss_kb_;
+}
+
+/*!\brief Prints the entries processed on each NUMA node per second of the
+  event loop and per second of worker time
+
+  Prints nothing unless the workers were bound to more than one node.
+*/
+void RunTelemetry::PrintNodes(ostream &stream) const{
+  vector<NodeSummary> nodes = SummarizeNodes(records_);
+  if(nodes.size() < 2 || nodes.front().node_ < 0) return;
+  for(const auto &node: nodes){
+    stream << "NUMA node " << node.node_ << ": " << node.babies_ << (node.babies_ == 1 ? " baby, " : " babies, ")
+           << AddCommas(node.entries_) << " entries, "
+           << RoundNumber(node.entries_, 1, 1000.*seconds_) << " kHz ("
+           << RoundNumber(node.entries_, 1, 1000.*node.seconds_) << " kHz per busy thread)" << endl;
+  }
+}
+
+/*!\brief Writes run summary and one object per Baby as JSON
+
+  \param[in,out] stream Stream to write to
+*/
+void RunTelemetry::WriteJson(ostream &stream) const{
+  stream << "{\"threads\": " << num_threads_
+         << ", \"seconds\": " << seconds_
+         << ", \"entries_read\": " << EntriesRead()
+         << ", \"bytes_read\": " << BytesRead()
+         << ", \"peak_rss_kb\": " << PeakRssKb()
+         << ", \"nodes\": [";
+  vector<NodeSummary> nodes = SummarizeNodes(records_);
+  for(size_t i = 0; i < nodes.size(); ++i){
+    const NodeSummary &n = nodes.at(i);
+    stream << (i == 0 ? "" : ", ")
+           << "{\"node\": " << n.node_
+           << ", \"babies\": " << n.babies_
+           << ", \"entries_read\": " << n.entries_
+           << ", \"worker_seconds\": " << n.seconds_
+           << ", \"entries_per_second\": " << (seconds_ > 0. ? n.entries_/seconds_ : 0.) << "}";
+  }
+  stream << "], \"babies\": [";
+  for(size_t i = 0; i < records_.size(); ++i){
+    const BabyRecord &r = records_.at(i);
+    stream << (i == 0 ? "\n" : ",\n")
+           << "  {\"tag\": \"" << JsonEscape(r.tag_) << "\""
+           << ", \"worker\": " << r.worker_
+           << ", \"node\": " << r.node_
+           << ", \"cached\": " << (r.cached_ ? "true" : "false")
+           << ", \"open_seconds\": " << r.open_seconds_
+           << ", \"io_seconds\": " << r.io_seconds_
+           << ", \"cut_seconds\": " << r.cut_seconds_
+           << ", \"fill_seconds\": " << r.fill_seconds_
+           << ", \"finish_seconds\": " << r.finish_seconds_
+           << ", \"total_seconds\": " << r.total_seconds_
+           << ", \"entries_read\": " << r.entries_read_
+           << ", \"entries_passed\": {";
+    for(size_t iproc = 0; iproc < r.entries_passed_.size(); ++iproc){
+      stream << (iproc == 0 ? "" : ", ")
+             << "\"" << JsonEscape(r.entries_passed_.at(iproc).first) << "\": "
+             << r.entries_passed_.at(iproc).second;
+    }
+    stream << "}, \"bytes_read\": " << r.bytes_read_ << "}";
+  }
+  stream << "\n]}" << endl;
+}
+
+/*!\brief Writes one line per Baby and process as CSV
+
+  \param[in,out] stream Stream to write to
+*/
+void RunTelemetry::WriteCsv(ostream &stream) const{
+  stream << "tag,worker,node,cached,open_seconds,io_seconds,cut_seconds,fill_seconds,finish_seconds,"
+         << "total_seconds,entries_read,bytes_read,process,entries_passed" << endl;
+  for(const auto &r: records_){
+    vector<pair<string, long> > passed = r.entries_passed_;
+    if(passed.size() == 0) passed.emplace_back("", 0);
+    for(const auto &proc: passed){
+      stream << CsvEscape(r.tag_) << ',' << r.worker_ << ',' << r.node_ << ',' << r.cached_ << ','
+             << r.open_seconds_ << ',' << r.io_seconds_ << ',' << r.cut_seconds_ << ','
+             << r.fill_seconds_ << ',' << r.finish_seconds_ << ',' << r.total_seconds_ << ','
+             << r.entries_read_ << ',' << r.bytes_read_ << ','
+             << CsvEscape(proc.first) << ',' << proc.second << endl;
+    }
+  }
+}
+
+/*!\brief Writes the records to a file, as CSV if its name ends in ".csv" and
+  as JSON otherwise
+
+  \param[in] file_name Path of file to write
+*/
+void RunTelemetry::Write(const string &file_name) const{
+  ofstream file(file_name);
+  if(!file) ERROR("Could not open "+file_name);
+  if(file_name.size() >= 4 && file_name.substr(file_name.size()-4) == ".csv"){
+    WriteCsv(file);
+  }else{
+    WriteJson(file);
+  }
+  cout << "Wrote run telemetry to " << file_name << endl;
+}
+
+/*!\brief Peak resident memory of the program so far
+
+  \return Peak resident set size in kB
+*/
+long RunTelemetry::CurrentPeakRssKb(){
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
@@ -0,0 +1,415 @@
+/*! \class SampleManifest
+
+  \brief Sidecar index of the picos in a directory
+
+  Knowing how many entries a file has normally means opening it and reading
+  the tree header, which for a TChain over thousands of files takes a long
+  time. A manifest, written once by make_manifest.exe or
+  SampleManifest::Scan() and SampleManifest::Write(), records for every file in
+  a directory its size, modification time, an optional checksum of the
+  contents, the number of entries, the first entry of each cluster and the
+  compressed and uncompressed size of each top-level branch. It is stored as
+  plain text in SampleManifest::file_name inside the directory.
+
+  SampleManifest::Lookup() returns the record of a file from the manifest of
+  its directory, reading each manifest once. Files are recorded under the name
+  their directory lists them with, so a manifest scanned in a directory of
+  symbolic links describes the links, and is found for the paths Glob()
+  returns for them, which keep the link name. Records whose file has a
+  different size or modification time than when it was scanned are stale and
+  are not returned, so a manifest that was not rebuilt after files were
+  replaced never gives wrong numbers, only fewer of them.
+  SampleManifest::VerifyChecksum() compares the contents as well.
+
+  PlotMaker uses the entry counts to start the largest babies first and to
+  estimate the remaining time. SampleManifest::FileInfo::SplitEntries() cuts a
+  file into entry ranges on cluster boundaries, and
+  SampleManifest::FileInfo::ZipBytes() estimates the bytes read for a set of
+  branches.
+*/
+
+/*! \class SampleManifest::FileInfo
+
+  \brief Manifest record of a single file
+*/
+#include "core/sample_manifest.hpp"
+
+#include <cstdint>
+#include <cstdio>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include <sys/stat.h>
+
+#include "TBranch.h"
+#include "TFile.h"
+#include "TObjArray.h"
+#include "TTree.h"
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+const string SampleManifest::file_name = "pico_manifest.txt";
+
+namespace{
+  /*!\brief Get size and modification time of path
+
+    \return False if path cannot be accessed
+  */
+  bool StatFile(const string &path, long long &size, long long &mtime_sec, long &mtime_nsec){
+    struct stat file_stat;
+    if(stat(path.c_str(), &file_stat) != 0) return false;
+    size = file_stat.st_size;
+    mtime_sec = file_stat.st_mtim.tv_sec;
+    mtime_nsec = file_stat.st_mtim.tv_nsec;
+    return true;
+  }
+
+  /*!\brief 64-bit FNV-1a hash of the contents of path as 16 hex digits, or an
+    empty string if it cannot be read
+  */
+  string Checksum(const string &path){
+    ifstream file(path, ios::binary);
+    if(!file) return "";
+    uint64_t hash = 14695981039346656037ULL;
+    vector<char> buffer(1 << 20);
+    while(file){
+      file.read(buffer.data(), buffer.size());
+      streamsize num_read = file.gcount();
+      for(streamsize i = 0; i < num_read; ++i){
+        hash ^= static_cast<unsigned char>(buffer[i]);
+        hash *= 1099511628211ULL;
+      }
+    }
+    ostringstream oss;
+    oss << hex << setw(16) << setfill('0') << hash;
+    return oss.str();
+  }
+
+  string Dirname(const string &path){
+    size_t slash = path.rfind('/');
+    if(slash == string::npos) return ".";
+    if(slash == 0) return "/";
+    return path.substr(0, slash);
+  }
+
+  //! Rest of line after the leading whitespace
+  string Remainder(istringstream &iss){
+    string rest;
+    getline(iss >> ws, rest);
+    return rest;
+  }
+}
+
+/*!\brief Total compressed bytes of the given top-level branches
+
+  \param[in] branches Branch names. All branches are counted if empty.
+*/
+long long SampleManifest::FileInfo::ZipBytes(const set<string> &branches) const{
+  long long bytes = 0;
+  for(const auto &branch: branch_bytes_){
+    if(branches.empty() || branches.count(branch.first)) bytes += branch.second.first;
+  }
+  return bytes;
+}
+
+/*!\brief Splits the entries of the file into ranges starting on cluster
+  boundaries
+
+  Ranges hold at most max_entries entries unless a single cluster is larger.
+  Without cluster information, ranges of exactly max_entries are made.
+
+  \param[in] max_entries Target number of entries per range. The whole file
+  is one range if not positive.
+
+  \return [begin, end) entry ranges covering the file in order
+*/
+vector<pair<long, long> > SampleManifest::FileInfo::SplitEntries(long max_entries) const{
+  vector<pair<long, long> > ranges;
+  if(entries_ <= 0) return ranges;
+  if(max_entries <= 0 || entries_ <= max_entries){
+    ranges.emplace_back(0, entries_);
+    return ranges;
+  }
+  if(clusters_.empty()){
+    for(long begin = 0; begin < entries_; begin += max_entries){
+      ranges.emplace_back(begin, min(begin+max_entries, entries_));
+    }
+    return ranges;
+  }
+
+  vector<long> bounds = clusters_;
+  bounds.push_back(entries_);
+  long begin = 0;
+  for(size_t i = 1; i < bounds.size(); ++i){
+    if(bounds.at(i) - begin > max_entries && bounds.at(i-1) > begin){
+      ranges.emplace_back(begin, bounds.at(i-1));
+      begin = bounds.at(i-1);
+    }
+  }
+  ranges.emplace_back(begin, entries_);
+  return ranges;
+}
+
+/*!\brief Constructs an empty manifest for directory
+
+  \param[in] directory Directory containing the files
+*/
+SampleManifest::SampleManifest(const string &directory):
+  directory_(directory),
+  tree_name_("tree"),
+  files_(),
+  indices_(){
+}
+
+/*!\brief Reads every file matching pattern in directory
+
+  Files that cannot be opened or lack the tree are reported and skipped.
+
+  \param[in] directory Directory to scan
+
+  \param[in] pattern Wildcard pattern for the files, relative to directory
+
+  \param[in] tree_name Name of the tree to describe
+
+  \param[in] checksums Whether to hash the contents of each file
+
+  \return Manifest of the matching files
+*/
+SampleManifest SampleManifest::Scan(const string &directory,
+                                    const string &pattern,
+                                    const string &tree_name,
+                                    bool checksums){
+  SampleManifest manifest(directory);
+  manifest.tree_name_ = tree_name;
+  for(const auto &path: Glob(directory+"/"+pattern)){
+    FileInfo info{Basename(path), 0, 0, 0, "", 0, vector<long>(), map<string, pair<long long, long long> >()};
+    if(!StatFile(path, info.size_, info.mtime_sec_, info.mtime_nsec_)) continue;
+
+    unique_ptr<TFile> file(TFile::Open(path.c_str(), "read"));
+    if(file == nullptr || file->IsZombie()){
+      cerr << "Skipping " << path << ": cannot be opened." << endl;
+      continue;
+    }
+    TTree *tree = dynamic_cast<TTree*>(file->Get(tree_name.c_str()));
+    if(tree == nullptr){
+      cerr << "Skipping " << path << ": no tree named " << tree_name << "." << endl;
+      continue;
+    }
+
+    info.entries_ = tree->GetEntries();
+    auto clusters = tree->GetClusterIterator(0);
+    for(long long start = clusters(); start < info.entries_; start = clusters()){
+      info.clusters_.push_back(start);
+    }
+    TObjArray *branches = tree->GetListOfBranches();
+    for(int ibranch = 0; branches != nullptr && ibranch < branches->GetEntries(); ++ibranch){
+      TBranch *branch = dynamic_cast<TBranch*>(branches->At(ibranch));
+      if(branch == nullptr) continue;
+      info.branch_bytes_[branch->GetName()] = make_pair(branch->GetZipBytes("*"), branch->GetTotBytes("*"));
+    }
+    file->Close();
+
+    if(checksums) info.checksum_ = Checksum(path);
+    manifest.Add(info);
+  }
+  return manifest;
+}
+
+/*!\brief Path of the manifest of directory
+ */
+string SampleManifest::PathFor(const string &directory){
+  return directory+"/"+file_name;
+}
+
+/*!\brief Get the current manifest record of file
+
+  The manifest of each directory is read on first use and again whenever it is
+  rewritten.
+
+  \param[in] file Path of the file
+
+  \return Record of the file, or nullptr if its directory has no manifest,
+  the manifest does not list it, or the record is stale
+*/
+shared_ptr<const SampleManifest::FileInfo> SampleManifest::Lookup(const string &file){
+  //! Manifest of a directory and the modification time of its file when read
+  struct Loaded{
+    long long mtime_sec_;
+    long mtime_nsec_;
+    shared_ptr<const SampleManifest> manifest_;
+  };
+  static mutex loaded_mutex;
+  static map<string, Loaded> loaded;
+
+  string directory = Dirname(file);
+  long long size = 0, mtime_sec = 0;
+  long mtime_nsec = 0;
+  if(!StatFile(PathFor(directory), size, mtime_sec, mtime_nsec)) return nullptr;
+
+  shared_ptr<const SampleManifest> manifest;
+  {
+    lock_guard<mutex> lock(loaded_mutex);
+    auto found = loaded.find(directory);
+    if(found != loaded.end()
+       && found->second.mtime_sec_ == mtime_sec
+       && found->second.mtime_nsec_ == mtime_nsec){
+      manifest = found->second.manifest_;
+    }else{
+      auto read = make_shared<SampleManifest>(directory);
+      if(!read->Read()) read.reset();
+      manifest = read;
+      loaded[directory] = Loaded{mtime_sec, mtime_nsec, manifest};
+    }
+  }
+  if(manifest == nullptr) return nullptr;
+
+  const FileInfo *info = manifest->Find(Basename(file));
+  if(info == nullptr || !manifest->IsCurrent(*info)) return nullptr;
+  return shared_ptr<const FileInfo>(manifest, info);
+}
+
+/*!\brief Total number of entries in files according to their manifests
+
+  \return Number of entries, or -1 if any file lacks a current record
+*/
+long SampleManifest::Entries(const set<string> &files){
+  long entries = 0;
+  for(const auto &file: files){
+    auto info = Lookup(file);
+    if(info == nullptr) return -1;
+    entries += info->entries_;
+  }
+  return entries;
+}
+
+/*!\brief Replaces contents with the manifest file of the directory
+
+  \return False if the file does not exist or cannot be parsed
+*/
+bool SampleManifest::Read(){
+  ifstream input(PathFor(directory_));
+  if(!input) return false;
+  files_.clear();
+  indices_.clear();
+  vector<FileInfo> files;
+  string line;
+  while(getline(input, line)){
+    if(line.empty() || line.at(0) == '#') continue;
+    istringstream iss(line);
+    string key;
+    iss >> key;
+    if(key == "tree"){
+      tree_name_ = Remainder(iss);
+    }else if(key == "file"){
+      FileInfo info{"", 0, 0, 0, "", 0, vector<long>(), map<string, pair<long long, long long> >()};
+      iss >> info.size_ >> info.mtime_sec_ >> info.mtime_nsec_ >> info.checksum_ >> info.entries_;
+      if(info.checksum_ == "-") info.checksum_ = "";
+      info.name_ = Remainder(iss);
+      if(!iss || info.name_.empty()) return false;
+      files.push_back(info);
+    }else if(key == "clusters" && !files.empty()){
+      long start;
+      while(iss >> start) files.back().clusters_.push_back(start);
+    }else if(key == "branch" && !files.empty()){
+      long long zip_bytes, tot_bytes;
+      iss >> zip_bytes >> tot_bytes;
+      string name = Remainder(iss);
+      if(!iss || name.empty()) return false;
+      files.back().branch_bytes_[name] = make_pair(zip_bytes, tot_bytes);
+    }else{
+      return false;
+    }
+  }
+  for(const auto &info: files) Add(info);
+  return true;
+}
+
+/*!\brief Writes the manifest file of the directory
+
+  The file is written under a temporary name and renamed, so readers never see
+  a partial manifest.
+*/
+void SampleManifest::Write() const{
+  string path = PathFor(directory_);
+  string temp_path = path+".tmp";
+  {
+    ofstream output(temp_path);
+    if(!output) ERROR("Could not open "+temp_path);
+    output << "# draw_pico sample manifest\n";
+    output << "tree " << tree_name_ << "\n";
+    for(const auto &info: files_){
+      output << "file " << info.size_ << ' ' << info.mtime_sec_ << ' ' << info.mtime_nsec_ << ' '
+             << (info.checksum_.empty() ? "-" : info.checksum_) << ' ' << info.entries_ << ' ' << info.name_ << "\n";
+      output << "clusters";
+      for(const auto &start: info.clusters_) output << ' ' << start;
+      output << "\n";
+      for(const auto &branch: info.branch_bytes_){
+        output << "branch " << branch.second.first << ' ' << branch.second.second << ' ' << branch.first << "\n";
+      }
+    }
+    if(!output) ERROR("Could not write "+temp_path);
+  }
+  if(rename(temp_path.c_str(), path.c_str()) != 0) ERROR("Could not move "+temp_path+" to "+path);
+}
+
+const string & SampleManifest::Directory() const{
+  return directory_;
+}
+
+const string & SampleManifest::TreeName() const{
+  return tree_name_;
+}
+
+/*!\brief Records of all files in the order they were scanned, i.e. sorted by
+  name
+*/
+const vector<SampleManifest::FileInfo> & SampleManifest::Files() const{
+  return files_;
+}
+
+/*!\brief Get record of a file, stale or not
+
+  \param[in] name File name without directory
+
+  \return Record, or nullptr if the file is not listed
+*/
+const SampleManifest::FileInfo * SampleManifest::Find(const string &name) const{
+  auto found = indices_.find(name);
+  return found == indices_.end() ? nullptr : &files_.at(found->second);
+}
+
+/*!\brief Check if the file of info still has the recorded size and
+  modification time
+*/
+bool SampleManifest::IsCurrent(const FileInfo &info) const{
+  long long size = 0, mtime_sec = 0;
+  long mtime_nsec = 0;
+  return StatFile(directory_+"/"+info.name_, size, mtime_sec, mtime_nsec)
+    && size == info.size_ && mtime_sec == info.mtime_sec_ && mtime_nsec == info.mtime_nsec_;
+}
+
+/*!\brief Check if the contents of the file of info still match the recorded
+  checksum. False if no checksum was recorded.
+*/
+bool SampleManifest::VerifyChecksum(const FileInfo &info) const{
+  return !info.checksum_.empty() && Checksum(directory_+"/"+info.name_) == info.checksum_;
+}
+
+/*!\brief Adds or replaces the record of a file
+ */
+void SampleManifest::Add(const FileInfo &info){
+  auto found = indices_.find(info.name_);
+  if(found != indices_.end()){
+    files_.at(found->second) = info;
+  }else{
+    indices_[info.name_] = files_.size();
+    files_.push_back(info);
+  }
+}
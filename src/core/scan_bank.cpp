@@ -0,0 +1,513 @@
+/*! \class ScanBank
+
+  \brief Histograms or yields of a signal scan, one per scan point, filled in
+  a single pass
+
+  A signal scan sample mixes many mass points, which are usually treated as
+  one Process each, so every point rereads the files of the scan. A ScanBank
+  instead evaluates scalar key functions, e.g. {"mprod", "mlsp"}, for each
+  entry and fills the histogram (or yield) of the corresponding point, so the
+  whole scan is processed in one pass over one Process:
+
+  \code
+  pm.Push<ScanBank>("t5hh_met", vector<NamedFunc>{"mprod", "mlsp"},
+                    Axis({150., 200., 300., 400., 500.}, "met", "MET"),
+                    baseline, procs).MaxBytes(1ul << 30);
+  \endcode
+
+  Points are created the first time they are seen and kept in a hash table.
+  When the points of a figure exceed ScanBank::max_bytes_, the least recently
+  filled half is written to spill files and dropped from memory; since scan
+  files are mostly ordered by point, these are usually complete. Spilled
+  records are spread over several files by hash of the key, so that merging
+  them back at the end only needs one file's worth of points in memory at a
+  time.
+
+  ScanBank::Print() writes one text file per process with a line per point,
+  and ScanBank::ForEachPoint() passes the merged points to a callback, e.g.
+  to write datacards.
+*/
+
+/*! \class ScanBank::SingleScanBank
+
+  \brief Points of a ScanBank for one process
+*/
+
+/*! \class ScanBank::Point
+
+  \brief Histogram or yield of one scan point
+*/
+#include "core/scan_bank.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/utilities.hpp"
+#include "core/shard_io.hpp"
+
+using namespace std;
+
+namespace{
+  const size_t num_buckets = 64;//!<Number of spill files per process
+}
+
+/*!\brief Adds the contents of other, which must have the same key and number
+  of bins
+*/
+void ScanBank::Point::Add(const Point &other){
+  for(size_t ibin = 0; ibin < sumw_.size(); ++ibin){
+    sumw_[ibin] += other.sumw_[ibin];
+    sumw2_[ibin] += other.sumw2_[ibin];
+  }
+  entries_ += other.entries_;
+  last_used_ = max(last_used_, other.last_used_);
+}
+
+size_t ScanBank::SingleScanBank::KeyHash::operator()(const Key &key) const{
+  size_t seed = key.size();
+  for(const auto &x: key){
+    seed ^= hash<NamedFunc::ScalarType>()(x) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+ScanBank::SingleScanBank::SingleScanBank(const ScanBank &scan_bank,
+                                         const shared_ptr<Process> &process):
+  FigureComponent(scan_bank, process),
+  proc_and_bank_cut_(scan_bank.cut_ && process->cut_),
+  points_(),
+  point_bytes_(sizeof(Point) + 4*sizeof(void*)
+               + (scan_bank.keys_.size() + 2*scan_bank.NumBins())*sizeof(double)),
+  counter_(0),
+  num_spilled_(0),
+  spill_dir_(),
+  buckets_(),
+  key_(scan_bank.keys_.size()),
+  cut_mask_(),
+  wgt_vector_(),
+  val_vector_(){
+}
+
+/*!\brief Removes the spill files
+ */
+ScanBank::SingleScanBank::~SingleScanBank(){
+  if(spill_dir_ == "") return;
+  buckets_.clear();
+  for(size_t ibucket = 0; ibucket < num_buckets; ++ibucket){
+    remove(BucketPath(ibucket).c_str());
+  }
+  rmdir(spill_dir_.c_str());
+}
+
+void ScanBank::SingleScanBank::RecordEvent(const Baby &baby){
+  const ScanBank &bank = static_cast<const ScanBank&>(figure_);
+  ++counter_;
+
+  bool have_vec = false;
+  size_t min_vec_size = 0;
+  const NamedFunc &cut = proc_and_bank_cut_;
+  if(cut.IsScalar()){
+    if(!cut.GetScalar(baby)) return;
+  }else{
+    cut.GetMask(baby, cut_mask_);
+    if(!HavePass(cut_mask_)) return;
+    have_vec = true;
+    min_vec_size = cut_mask_.Size();
+  }
+
+  const NamedFunc &wgt = bank.weight_;
+  NamedFunc::ScalarType wgt_scalar = 0.;
+  if(wgt.IsScalar()){
+    wgt_scalar = wgt.GetScalar(baby);
+  }else{
+    wgt.GetVector(baby, wgt_vector_);
+    if(!have_vec || wgt_vector_.size() < min_vec_size){
+      have_vec = true;
+      min_vec_size = wgt_vector_.size();
+    }
+  }
+
+  const NamedFunc &val = bank.axis_.var_;
+  NamedFunc::ScalarType val_scalar = 0.;
+  if(bank.is_histogram_){
+    if(val.IsScalar()){
+      val_scalar = val.GetScalar(baby);
+    }else{
+      val.GetVector(baby, val_vector_);
+      if(!have_vec || val_vector_.size() < min_vec_size){
+        have_vec = true;
+        min_vec_size = val_vector_.size();
+      }
+    }
+  }
+
+  // Entries with no passing element within the shortest vector are not counted
+  size_t first = cut.IsVector() ? cut_mask_.NextSet(0) : 0;
+  if(have_vec && first >= min_vec_size) return;
+
+  for(size_t ikey = 0; ikey < key_.size(); ++ikey){
+    key_[ikey] = bank.keys_[ikey].GetScalar(baby);
+  }
+  Point &point = GetPoint(key_);
+  point.last_used_ = counter_;
+  ++point.entries_;
+
+  if(!have_vec){
+    Fill(point, val_scalar, wgt_scalar);
+  }else{
+    for(size_t i = first; i < min_vec_size; i = cut.IsVector() ? cut_mask_.NextSet(i+1) : i+1){
+      Fill(point,
+           val.IsScalar() || !bank.is_histogram_ ? val_scalar : val_vector_[i],
+           wgt.IsScalar() ? wgt_scalar : wgt_vector_[i]);
+    }
+  }
+
+  size_t max_bytes = bank.max_bytes_/max(bank.banks_.size(), static_cast<size_t>(1));
+  if(points_.size() > 1 && points_.size()*point_bytes_ > max_bytes) Spill(false);
+}
+
+/*!\brief Memory allowed for the points of this process before spilling
+ */
+size_t ScanBank::SingleScanBank::EstimateBytes() const{
+  const ScanBank &bank = static_cast<const ScanBank&>(figure_);
+  return bank.max_bytes_/max(bank.banks_.size(), static_cast<size_t>(1));
+}
+
+/*!\brief Scan banks can be merged across shards
+ */
+bool ScanBank::SingleScanBank::CanMerge() const{
+  return true;
+}
+
+/*!\brief Writes every point, with spilled records merged
+ */
+void ScanBank::SingleScanBank::WriteState(ostream &out){
+  ForEachPoint([&out](const Point &point){
+      ShardIO::Write(out, true);
+      ShardIO::Write(out, point.entries_);
+      ShardIO::WriteVector(out, point.key_);
+      ShardIO::WriteVector(out, point.sumw_);
+      ShardIO::WriteVector(out, point.sumw2_);
+    });
+  ShardIO::Write(out, false);
+}
+
+/*!\brief Adds the points written by another shard, spilling as when recording
+ */
+void ScanBank::SingleScanBank::MergeState(istream &in){
+  const ScanBank &bank = static_cast<const ScanBank&>(figure_);
+  size_t max_bytes = bank.max_bytes_/max(bank.banks_.size(), static_cast<size_t>(1));
+  size_t num_bins = bank.NumBins();
+  Point record{Key(key_.size()), vector<double>(num_bins), vector<double>(num_bins), 0, 0};
+  while(ShardIO::Read<bool>(in)){
+    ++counter_;
+    record.entries_ = ShardIO::Read<long>(in);
+    fill(record.key_.begin(), record.key_.end(), 0.);
+    fill(record.sumw_.begin(), record.sumw_.end(), 0.);
+    fill(record.sumw2_.begin(), record.sumw2_.end(), 0.);
+    ShardIO::AddVector(in, record.key_);
+    ShardIO::AddVector(in, record.sumw_);
+    ShardIO::AddVector(in, record.sumw2_);
+    record.last_used_ = counter_;
+    GetPoint(record.key_).Add(record);
+    if(points_.size() > 1 && points_.size()*point_bytes_ > max_bytes) Spill(false);
+  }
+}
+
+/*!\brief Calls func for each point of the scan, with spilled records merged
+
+  Points are passed in order of key if nothing was spilled, and otherwise in
+  order of key within each spill file. Recording may continue afterwards.
+*/
+void ScanBank::SingleScanBank::ForEachPoint(const function<void(const Point &)> &func){
+  const ScanBank &bank = static_cast<const ScanBank&>(figure_);
+  auto by_key = [](const Point *a, const Point *b){return a->key_ < b->key_;};
+  vector<const Point*> sorted;
+  if(spill_dir_ == ""){
+    for(const auto &point: points_) sorted.push_back(&point.second);
+    sort(sorted.begin(), sorted.end(), by_key);
+    for(const auto &point: sorted) func(*point);
+    return;
+  }
+
+  Spill(true);
+  buckets_.clear();
+  size_t num_bins = bank.NumBins();
+  Point record{Key(key_.size()), vector<double>(num_bins), vector<double>(num_bins), 0, 0};
+  for(size_t ibucket = 0; ibucket < num_buckets; ++ibucket){
+    ifstream in(BucketPath(ibucket), ios::binary);
+    unordered_map<Key, Point, KeyHash> merged;
+    while(in.read(reinterpret_cast<char*>(&record.entries_), sizeof(record.entries_))
+          && in.read(reinterpret_cast<char*>(record.key_.data()), record.key_.size()*sizeof(double))
+          && in.read(reinterpret_cast<char*>(record.sumw_.data()), num_bins*sizeof(double))
+          && in.read(reinterpret_cast<char*>(record.sumw2_.data()), num_bins*sizeof(double))){
+      auto found = merged.find(record.key_);
+      if(found == merged.end()){
+        merged.emplace(record.key_, record);
+      }else{
+        found->second.Add(record);
+      }
+    }
+    sorted.clear();
+    for(const auto &point: merged) sorted.push_back(&point.second);
+    sort(sorted.begin(), sorted.end(), by_key);
+    for(const auto &point: sorted) func(*point);
+  }
+}
+
+/*!\brief Number of points currently held in memory
+ */
+size_t ScanBank::SingleScanBank::NumPoints() const{
+  return points_.size();
+}
+
+/*!\brief Number of point records written to spill files so far
+ */
+size_t ScanBank::SingleScanBank::NumSpilled() const{
+  return num_spilled_;
+}
+
+ScanBank::Point & ScanBank::SingleScanBank::GetPoint(const Key &key){
+  auto found = points_.find(key);
+  if(found != points_.end()) return found->second;
+  size_t num_bins = static_cast<const ScanBank&>(figure_).NumBins();
+  return points_.emplace(key, Point{key, vector<double>(num_bins, 0.), vector<double>(num_bins, 0.), 0, 0}).first->second;
+}
+
+void ScanBank::SingleScanBank::Fill(Point &point,
+                                    NamedFunc::ScalarType value,
+                                    NamedFunc::ScalarType weight){
+  const ScanBank &bank = static_cast<const ScanBank&>(figure_);
+  size_t ibin = 0;
+  if(bank.is_histogram_){
+    const vector<double> &edges = bank.axis_.Bins();
+    ibin = upper_bound(edges.cbegin(), edges.cend(), value) - edges.cbegin();
+  }
+  point.sumw_[ibin] += weight;
+  point.sumw2_[ibin] += weight*weight;
+}
+
+/*!\brief Writes points to the spill files and drops them from memory
+
+  \param[in] all If true, all points are spilled. Otherwise, the least recently
+  filled half is.
+*/
+void ScanBank::SingleScanBank::Spill(bool all){
+  if(points_.empty()) return;
+  const ScanBank &bank = static_cast<const ScanBank&>(figure_);
+  if(spill_dir_ == ""){
+    string pattern = bank.spill_directory_+"/"+CodeToPlainText(bank.name_+"_"+process_->name_)+"_XXXXXX";
+    vector<char> dir_name(pattern.cbegin(), pattern.cend());
+    dir_name.push_back('\0');
+    if(mkdtemp(dir_name.data()) == nullptr) ERROR("Could not create spill directory "+pattern);
+    spill_dir_ = dir_name.data();
+  }
+  if(buckets_.empty()){
+    for(size_t ibucket = 0; ibucket < num_buckets; ++ibucket){
+      buckets_.emplace_back(new ofstream(BucketPath(ibucket), ios::binary | ios::app));
+      if(!*buckets_.back()) ERROR("Could not open spill file "+BucketPath(ibucket));
+    }
+  }
+
+  size_t threshold = counter_;
+  if(!all){
+    vector<size_t> last_used;
+    last_used.reserve(points_.size());
+    for(const auto &point: points_) last_used.push_back(point.second.last_used_);
+    auto middle = last_used.begin() + last_used.size()/2;
+    nth_element(last_used.begin(), middle, last_used.end());
+    threshold = *middle;
+  }
+
+  KeyHash key_hash;
+  for(auto point = points_.begin(); point != points_.end();){
+    const Point &p = point->second;
+    if(p.last_used_ > threshold){
+      ++point;
+      continue;
+    }
+    ofstream &out = *buckets_[key_hash(p.key_) % num_buckets];
+    out.write(reinterpret_cast<const char*>(&p.entries_), sizeof(p.entries_));
+    out.write(reinterpret_cast<const char*>(p.key_.data()), p.key_.size()*sizeof(double));
+    out.write(reinterpret_cast<const char*>(p.sumw_.data()), p.sumw_.size()*sizeof(double));
+    out.write(reinterpret_cast<const char*>(p.sumw2_.data()), p.sumw2_.size()*sizeof(double));
+    if(!out) ERROR("Could not write to spill directory "+spill_dir_);
+    ++num_spilled_;
+    point = points_.erase(point);
+  }
+  for(auto &bucket: buckets_) bucket->flush();
+}
+
+string ScanBank::SingleScanBank::BucketPath(size_t ibucket) const{
+  return spill_dir_+"/bucket_"+to_string(ibucket)+".bin";
+}
+
+/*!\brief Constructor of a bank of histograms
+
+  \param[in] name Name of the bank, used for the output file names
+
+  \param[in] keys Scalar functions identifying the scan point
+
+  \param[in] axis Binning and variable of the histogram of each point. Under-
+  and overflow are stored as separate bins.
+
+  \param[in] cut Cut applied before filling
+
+  \param[in] processes Processes for which to fill banks
+*/
+ScanBank::ScanBank(const string &name,
+                   const vector<NamedFunc> &keys,
+                   const Axis &axis,
+                   const NamedFunc &cut,
+                   const vector<shared_ptr<Process> > &processes):
+  Figure(),
+  name_(name),
+  keys_(keys),
+  axis_(axis),
+  is_histogram_(true),
+  cut_(cut),
+  weight_("weight"),
+  max_bytes_(1ul << 30),
+  spill_directory_("/tmp"),
+  banks_(){
+  CheckKeys();
+  for(const auto &process: processes){
+    banks_.emplace_back(new SingleScanBank(*this, process));
+  }
+}
+
+/*!\brief Constructor of a bank of yields, storing the sum of weights passing
+  cut for each point
+*/
+ScanBank::ScanBank(const string &name,
+                   const vector<NamedFunc> &keys,
+                   const NamedFunc &cut,
+                   const vector<shared_ptr<Process> > &processes):
+  Figure(),
+  name_(name),
+  keys_(keys),
+  axis_(1, 0., 1., 0.),
+  is_histogram_(false),
+  cut_(cut),
+  weight_("weight"),
+  max_bytes_(1ul << 30),
+  spill_directory_("/tmp"),
+  banks_(){
+  CheckKeys();
+  for(const auto &process: processes){
+    banks_.emplace_back(new SingleScanBank(*this, process));
+  }
+}
+
+/*!\brief Writes tables/[subdir/]name_process.txt for each process
+
+  Each line holds the key values, the number of entries, and the yield and
+  its uncertainty in each bin, scaled by luminosity for simulation. For
+  histograms, the first and last bins are the underflow and overflow.
+*/
+void ScanBank::Print(double luminosity,
+                     const string &subdir){
+  if(subdir != "") mkdir(("tables/"+subdir).c_str(), 0777);
+  for(const auto &bank: banks_){
+    string file_name = "tables/"+(subdir != "" ? subdir+"/" : "")
+      +CodeToPlainText(name_+"_"+bank->process_->name_)+".txt";
+    ofstream file(file_name);
+    file << "#";
+    for(const auto &key: keys_) file << ' ' << key.Name();
+    file << " entries";
+    if(is_histogram_){
+      file << " [" << axis_.var_.Name() << " bins:";
+      for(const auto &edge: axis_.Bins()) file << ' ' << edge;
+      file << ']';
+    }
+    file << '\n' << setprecision(8);
+    double scale = bank->process_->type_ == Process::Type::data ? 1. : luminosity;
+    size_t num_points = 0;
+    bank->ForEachPoint([&](const Point &point){
+        for(const auto &x: point.key_) file << x << ' ';
+        file << point.entries_;
+        for(size_t ibin = 0; ibin < point.sumw_.size(); ++ibin){
+          file << ' ' << scale*point.sumw_[ibin] << ' ' << scale*sqrt(point.sumw2_[ibin]);
+        }
+        file << '\n';
+        ++num_points;
+      });
+    file.close();
+    cout << "Wrote " << num_points << " scan points to " << file_name << endl;
+  }
+}
+
+set<const Process*> ScanBank::GetProcesses() const{
+  set<const Process*> processes;
+  for(const auto &bank: banks_){
+    processes.insert(bank->process_.get());
+  }
+  return processes;
+}
+
+vector<NamedFunc> ScanBank::GetFunctions() const{
+  vector<NamedFunc> functions = keys_;
+  functions.push_back(cut_);
+  functions.push_back(weight_);
+  if(is_histogram_) functions.push_back(axis_.var_);
+  return functions;
+}
+
+Figure::FigureComponent * ScanBank::GetComponent(const Process *process){
+  for(const auto &bank: banks_){
+    if(bank->process_.get() == process) return bank.get();
+  }
+  return nullptr;
+}
+
+/*!\brief Number of values stored per point: the histogram bins plus under-
+  and overflow, or 1 for yields
+*/
+size_t ScanBank::NumBins() const{
+  return is_histogram_ ? axis_.Nbins()+2 : 1;
+}
+
+/*!\brief Calls func for each point of process, see
+  ScanBank::SingleScanBank::ForEachPoint()
+*/
+void ScanBank::ForEachPoint(const Process *process,
+                            const function<void(const Point &)> &func){
+  FigureComponent *component = GetComponent(process);
+  if(component == nullptr) ERROR("Process "+process->name_+" is not in scan bank "+name_);
+  static_cast<SingleScanBank*>(component)->ForEachPoint(func);
+}
+
+ScanBank & ScanBank::Weight(const NamedFunc &weight){
+  weight_ = weight;
+  return *this;
+}
+
+/*!\brief Sets the approximate memory allowed for the points of all processes
+  before the least recently filled ones are spilled to disk
+*/
+ScanBank & ScanBank::MaxBytes(size_t max_bytes){
+  max_bytes_ = max_bytes;
+  return *this;
+}
+
+/*!\brief Sets the directory in which spill files are created
+ */
+ScanBank & ScanBank::SpillDirectory(const string &directory){
+  spill_directory_ = directory;
+  return *this;
+}
+
+void ScanBank::CheckKeys() const{
+  if(keys_.empty()) ERROR("Scan bank "+name_+" needs at least one key");
+  for(const auto &key: keys_){
+    if(!key.IsScalar()) ERROR("Scan bank key "+key.Name()+" is not a scalar");
+  }
+}
@@ -0,0 +1,99 @@
+/*! \namespace ShardIO
+
+  \brief Binary reading and writing of the partial results of a shard
+
+  When PlotMaker runs as one of several shards, each figure component writes
+  what it has accumulated with these functions, and the merging process adds
+  the values read back to its own components. Numbers are written in the
+  native binary representation, so merging reproduces the sums of a single
+  process up to the order of additions; results are meant to be merged on a
+  machine of the same architecture.
+*/
+#include "core/shard_io.hpp"
+
+#include "TArrayD.h"
+
+using namespace std;
+
+/*!\brief Writes the length and characters of s
+ */
+void ShardIO::WriteString(ostream &out, const string &s){
+  Write<size_t>(out, s.size());
+  out.write(s.data(), s.size());
+}
+
+/*!\brief Reads a string written by ShardIO::WriteString()
+ */
+string ShardIO::ReadString(istream &in){
+  size_t size = Read<size_t>(in);
+  string s(size, '\0');
+  in.read(&s[0], size);
+  if(!in) ERROR("Shard result is truncated");
+  return s;
+}
+
+/*!\brief Writes the length and values of v
+ */
+void ShardIO::WriteVector(ostream &out, const vector<double> &v){
+  Write<size_t>(out, v.size());
+  for(const auto &x: v) Write(out, x);
+}
+
+/*!\brief Adds the values written by ShardIO::WriteVector() to v, which must
+  have the same length
+*/
+void ShardIO::AddVector(istream &in, vector<double> &v){
+  size_t size = Read<size_t>(in);
+  if(size != v.size()){
+    ERROR("Shard result has "+to_string(size)+" values instead of "+to_string(v.size()));
+  }
+  for(auto &x: v) x += Read<double>(in);
+}
+
+/*!\brief Writes the contents, sums of squared weights, statistics and number
+  of entries of hist
+*/
+void ShardIO::WriteHist(ostream &out, const TH1 &hist){
+  int num_cells = hist.GetNcells();
+  const TArrayD *sumw2 = hist.GetSumw2N() > 0 ? hist.GetSumw2() : nullptr;
+  Write(out, num_cells);
+  Write(out, sumw2 != nullptr);
+  for(int bin = 0; bin < num_cells; ++bin){
+    Write(out, hist.GetBinContent(bin));
+    if(sumw2 != nullptr) Write(out, sumw2->fArray[bin]);
+  }
+  double stats[7] = {0., 0., 0., 0., 0., 0., 0.};
+  hist.GetStats(stats);
+  for(const auto &stat: stats) Write(out, stat);
+  Write(out, hist.GetEntries());
+}
+
+/*!\brief Adds a histogram written by ShardIO::WriteHist() to hist, which must
+  have the same binning
+
+  Equivalent to having filled hist with the entries of both.
+*/
+void ShardIO::AddHist(istream &in, TH1 &hist){
+  int num_cells = Read<int>(in);
+  if(num_cells != hist.GetNcells()){
+    ERROR("Shard result has "+to_string(num_cells)+" cells instead of "+to_string(hist.GetNcells()));
+  }
+  bool has_sumw2 = Read<bool>(in);
+  TArrayD *sumw2 = hist.GetSumw2N() > 0 ? hist.GetSumw2() : nullptr;
+  double stats[7] = {0., 0., 0., 0., 0., 0., 0.};
+  hist.GetStats(stats);
+  double entries = hist.GetEntries();
+  for(int bin = 0; bin < num_cells; ++bin){
+    double content = Read<double>(in);
+    double content2 = has_sumw2 ? Read<double>(in) : content;
+    hist.SetBinContent(bin, hist.GetBinContent(bin)+content);
+    if(sumw2 != nullptr) sumw2->fArray[bin] += content2;
+  }
+  int num_stats = hist.GetDimension() == 2 ? 7 : 4;
+  for(int i = 0; i < 7; ++i){
+    double stat = Read<double>(in);
+    if(i < num_stats) stats[i] += stat;
+  }
+  hist.PutStats(stats);
+  hist.SetEntries(entries+Read<double>(in));
+}
@@ -0,0 +1,419 @@
+/*! \class Skim
+
+  \brief Writes events passing a selection to reduced ntuples
+
+  Skim is a Figure that, instead of filling a histogram, copies selected events
+  to per-process output files during the same event loop used to fill all other
+  figures in a PlotMaker. Any number of skims with different selections can be
+  added to a PlotMaker, and all of them are produced with a single read of the
+  inputs.
+
+  The set of branches to copy may be given explicitly (names or TTree wildcards,
+  e.g. "el_*"). If no branch list is provided, the skim keeps every branch
+  appearing in its own cut, in the process cuts, and in the variables, cuts and
+  weights of all figures added to the PlotMaker after the skim. Variables used
+  only inside C++ lambdas cannot be seen this way and must be added explicitly
+  with Skim::Branches().
+
+  Each Baby is processed by a single worker thread, so each Baby in flight gets
+  its own writer and temporary output file. The temporary files are merged into
+  skims/<subdir>/<name>_<process>.root when Skim::Print() is called.
+*/
+
+/*! \class Skim::SingleSkim
+
+  \brief Writers and temporary output files for a single Process
+*/
+
+/*! \class Skim::SingleSkim::Writer
+
+  \brief Copies selected entries of one Baby's TChain to a temporary file
+*/
+#include "core/skim.hpp"
+
+#include <cctype>
+#include <cstdio>
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+
+#include <sys/stat.h>
+
+#include "TChain.h"
+#include "TFileMerger.h"
+#include "TObjArray.h"
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  atomic<unsigned long> part_counter(0);
+
+  /*!\brief Extracts everything that looks like a C++ identifier from a string
+
+    \param[in] expression String representation of a NamedFunc
+
+    \return Identifiers found in expression
+  */
+  set<string> GetIdentifiers(const string &expression){
+    set<string> identifiers;
+    size_t start = 0;
+    while(start < expression.size()){
+      char c = expression.at(start);
+      if(isalpha(c) || c == '_'){
+        size_t end = start+1;
+        while(end < expression.size()
+              && (isalnum(expression.at(end)) || expression.at(end) == '_')){
+          ++end;
+        }
+        identifiers.insert(expression.substr(start, end-start));
+        start = end;
+      }else if(isdigit(c) || c == '.'){
+        //Skip numbers, including exponents like 1e5
+        while(start < expression.size()
+              && (isalnum(expression.at(start)) || expression.at(start) == '.')){
+          ++start;
+        }
+      }else{
+        ++start;
+      }
+    }
+    return identifiers;
+  }
+
+  bool HasWildcard(const string &pattern){
+    return pattern.find_first_of("*?[") != string::npos;
+  }
+}
+
+/*!\brief Opens temporary output file and clones structure of Baby's tree
+
+  \param[in] skim Skim providing list of branches and compression
+
+  \param[in] baby Baby with an active TChain whose current entries are copied
+
+  \param[in] file_name Temporary output file
+*/
+Skim::SingleSkim::Writer::Writer(const Skim &skim,
+                                 const Baby &baby,
+                                 const string &file_name):
+  file_name_(file_name),
+  num_written_(0),
+  baby_(baby),
+  file_(),
+  tree_(nullptr),
+  branch_names_(),
+  branches_(),
+  tree_number_(-1){
+  TChain *chain = baby_.GetTree().get();
+  if(chain == nullptr) ERROR("Baby for "+file_name_+" has no active chain");
+  baby_.LoadEntry();
+  lock_guard<mutex> lock(Multithreading::root_mutex);
+
+  file_.reset(new TFile(file_name_.c_str(), "recreate"));
+  if(!file_ || file_->IsZombie()) ERROR("Could not open "+file_name_);
+  file_->SetCompressionSettings(skim.compression_);
+
+  chain->SetBranchStatus("*", false);
+  for(const auto &pattern: skim.BranchPatterns()){
+    if(!HasWildcard(pattern) && chain->GetBranch(pattern.c_str()) == nullptr) continue;
+    chain->SetBranchStatus(pattern.c_str(), true);
+  }
+  file_->cd();
+  tree_ = chain->CloneTree(0);
+  //Baby reads through TBranch::GetEntry, which skips disabled branches
+  chain->SetBranchStatus("*", true);
+  if(tree_ == nullptr) ERROR("Could not clone tree for "+file_name_);
+  tree_->SetDirectory(file_.get());
+
+  TObjArray *branches = tree_->GetListOfBranches();
+  for(int ibranch = 0; branches != nullptr && ibranch < branches->GetEntries(); ++ibranch){
+    branch_names_.push_back(branches->At(ibranch)->GetName());
+  }
+}
+
+Skim::SingleSkim::Writer::~Writer(){
+  try{
+    Close();
+  }catch(...){
+  }
+}
+
+/*!\brief Loads the copied branches for the current entry and writes them
+ */
+void Skim::SingleSkim::Writer::Fill(){
+  baby_.LoadEntry();
+  const TChain *chain = baby_.GetTree().get();
+  if(chain->GetTreeNumber() != tree_number_) FindBranches();
+  long entry = chain->GetTree()->GetReadEntry();
+  for(const auto &branch: branches_){
+    if(branch != nullptr) branch->GetEntry(entry);
+  }
+  tree_->Fill();
+  ++num_written_;
+}
+
+/*!\brief Looks up the copied branches in the current tree of the chain
+
+  Called when the chain moves to a new file, so that Fill() does not search
+  the branches by name for every event.
+*/
+void Skim::SingleSkim::Writer::FindBranches(){
+  const TChain *chain = baby_.GetTree().get();
+  TTree *tree = chain->GetTree();
+  branches_.clear();
+  for(const auto &name: branch_names_){
+    branches_.push_back(tree->GetBranch(name.c_str()));
+  }
+  tree_number_ = chain->GetTreeNumber();
+}
+
+/*!\brief Writes output tree and closes temporary file
+
+  Must be called while the Baby's TChain is still active, since the chain keeps
+  a reference to the cloned tree.
+*/
+void Skim::SingleSkim::Writer::Close(){
+  if(!file_) return;
+  lock_guard<mutex> lock(Multithreading::root_mutex);
+  const auto &chain = baby_.GetTree();
+  if(chain){
+    chain->TTree::RecursiveRemove(tree_);
+    if(chain->GetTree() != nullptr) chain->GetTree()->RecursiveRemove(tree_);
+  }
+  file_->cd();
+  tree_->Write();
+  file_->Close();
+  file_.reset();
+  tree_ = nullptr;
+}
+
+/*!\brief Standard constructor
+
+  \param[in] skim Skim containing this component
+
+  \param[in] process Process whose events are written
+*/
+Skim::SingleSkim::SingleSkim(const Skim &skim,
+                             const shared_ptr<Process> &process):
+  FigureComponent(skim, process),
+  full_cut_(skim.cut_ && process->cut_),
+  cut_vector_(),
+  writers_(),
+  parts_(),
+  num_written_(0){
+}
+
+Skim::SingleSkim::~SingleSkim(){
+  for(const auto &part: parts_){
+    remove(part.c_str());
+  }
+}
+
+void Skim::SingleSkim::RecordEvent(const Baby &baby){
+  if(full_cut_.IsScalar()){
+    if(!full_cut_.GetScalar(baby)) return;
+  }else{
+    full_cut_.GetVector(baby, cut_vector_);
+    if(!HavePass(cut_vector_)) return;
+  }
+
+  auto writer = writers_.find(&baby);
+  if(writer == writers_.end()){
+    const Skim &skim = static_cast<const Skim&>(figure_);
+    mkdir("skims", 0777);
+    string file_name = "skims/"+CodeToPlainText(skim.name_+"_"+process_->name_)
+      +"_part"+to_string(part_counter++)+".root";
+    writer = writers_.emplace(&baby, unique_ptr<Writer>(new Writer(skim, baby, file_name))).first;
+  }
+  writer->second->Fill();
+}
+
+/*!\brief Closes the writer associated to baby, if any
+
+  \param[in] baby Baby which has been fully processed
+*/
+void Skim::SingleSkim::FinishBaby(const Baby &baby){
+  auto writer = writers_.find(&baby);
+  if(writer == writers_.end()) return;
+  writer->second->Close();
+  num_written_ += writer->second->num_written_;
+  parts_.push_back(writer->second->file_name_);
+  writers_.erase(writer);
+}
+
+/*!\brief Get name of merged output file
+
+  \param[in] subdir Subdirectory of skims/ in which to place output
+
+  \return Path to merged output file
+*/
+string Skim::SingleSkim::OutputName(const string &subdir) const{
+  const Skim &skim = static_cast<const Skim&>(figure_);
+  string dir = subdir != "" ? "skims/"+subdir+"/" : "skims/";
+  return dir+CodeToPlainText(skim.name_+"_"+process_->name_)+".root";
+}
+
+/*!\brief Get number of events written so far by closed writers
+ */
+long Skim::SingleSkim::NumWritten() const{
+  return num_written_;
+}
+
+/*!\brief Merges temporary files from all writers into final output
+
+  \param[in] subdir Subdirectory of skims/ in which to place output
+*/
+void Skim::SingleSkim::Merge(const string &subdir){
+  for(auto &writer: writers_){
+    writer.second->Close();
+    num_written_ += writer.second->num_written_;
+    parts_.push_back(writer.second->file_name_);
+  }
+  writers_.clear();
+
+  string out_name = OutputName(subdir);
+  if(parts_.size() == 0){
+    cout << "No events selected for " << out_name << endl;
+    return;
+  }
+
+  if(parts_.size() == 1){
+    if(rename(parts_.front().c_str(), out_name.c_str()) != 0){
+      ERROR("Could not move "+parts_.front()+" to "+out_name);
+    }
+  }else{
+    const Skim &skim = static_cast<const Skim&>(figure_);
+    lock_guard<mutex> lock(Multithreading::root_mutex);
+    TFileMerger merger(false);
+    merger.OutputFile(out_name.c_str(), "recreate", skim.compression_);
+    for(const auto &part: parts_){
+      merger.AddFile(part.c_str(), false);
+    }
+    if(!merger.Merge()) ERROR("Failed to merge parts of "+out_name);
+    for(const auto &part: parts_){
+      remove(part.c_str());
+    }
+  }
+  parts_.clear();
+  cout << "Wrote " << num_written_ << " events to " << out_name << endl;
+}
+
+/*!\brief Standard constructor
+
+  \param[in] name Name of skim, used in output file names
+
+  \param[in] cut Selection of events to write
+
+  \param[in] processes Processes for which to produce skims
+
+  \param[in] branches Branch names or wildcards to copy. If empty, all branches
+  used by the cuts and by figures added after this one are copied.
+*/
+Skim::Skim(const string &name,
+           const NamedFunc &cut,
+           const vector<shared_ptr<Process> > &processes,
+           const vector<string> &branches):
+  Figure(),
+  name_(name),
+  cut_(cut),
+  tag_(""),
+  compression_(404),
+  skims_(),
+  branch_patterns_(branches.cbegin(), branches.cend()),
+  figure_branches_(branches.size() == 0){
+  vector<NamedFunc> cuts = {cut_};
+  for(const auto &process: processes){
+    skims_.emplace_back(new SingleSkim(*this, process));
+    cuts.push_back(process->cut_);
+  }
+  if(figure_branches_) AddFunctionBranches(cuts);
+}
+
+void Skim::Print(double /*luminosity*/,
+                 const string &subdir){
+  mkdir("skims", 0777);
+  if(subdir != "") mkdir(("skims/"+subdir).c_str(), 0777);
+  for(auto &skim: skims_){
+    skim->Merge(subdir);
+  }
+}
+
+set<const Process*> Skim::GetProcesses() const{
+  set<const Process*> processes;
+  for(const auto &skim: skims_){
+    processes.insert(skim->process_.get());
+  }
+  return processes;
+}
+
+string Skim::GetTag() const{
+  return tag_;
+}
+
+vector<NamedFunc> Skim::GetFunctions() const{
+  return {cut_};
+}
+
+Figure::FigureComponent * Skim::GetComponent(const Process *process){
+  for(const auto &skim: skims_){
+    if(skim->process_.get() == process) return skim.get();
+  }
+  return nullptr;
+}
+
+Skim & Skim::Tag(const string &tag){
+  tag_ = tag;
+  return *this;
+}
+
+/*!\brief Set explicit list of branches to copy
+
+  Disables automatic collection of branches from other figures.
+
+  \param[in] branches Branch names or TTree wildcards (e.g. "el_*")
+
+  \return Reference to *this
+*/
+Skim & Skim::Branches(const vector<string> &branches){
+  branch_patterns_ = set<string>(branches.cbegin(), branches.cend());
+  figure_branches_ = false;
+  return *this;
+}
+
+/*!\brief Add branches for all variables appearing in the given functions
+
+  Identifiers that are not branches of the input tree are ignored when the
+  output file is created.
+
+  \param[in] functions Functions whose string representations are scanned
+
+  \return Reference to *this
+*/
+Skim & Skim::AddFunctionBranches(const vector<NamedFunc> &functions){
+  for(const auto &function: functions){
+    for(const auto &identifier: GetIdentifiers(function.Name())){
+      branch_patterns_.insert(identifier);
+    }
+  }
+  return *this;
+}
+
+/*!\brief Set ROOT compression settings (algorithm*100+level) of output files
+ */
+Skim & Skim::Compression(int compression){
+  compression_ = compression;
+  return *this;
+}
+
+/*!\brief Check if branch list is filled from figures following this one
+ */
+bool Skim::UsesFigureBranches() const{
+  return figure_branches_;
+}
+
+const set<string> & Skim::BranchPatterns() const{
+  return branch_patterns_;
+}
@@ -15,6 +15,7 @@
 #include "TString.h"
 
 #include "core/utilities.hpp"
+#include "core/shard_io.hpp"
 
 using namespace std;
 
@@ -48,7 +49,7 @@ Table::TableColumn::TableColumn(const Table &table,
   sumw_(table.rows_.size(), 0.),
   sumw2_(table.rows_.size(), 0.),
   proc_and_table_cut_(table.rows_.size(), process->cut_),
-  cut_vector_(),
+  cut_mask_(),
   wgt_vector_(),
   val_vector_(){
     for(size_t irow = 0; irow < table.rows_.size(); ++irow){
@@ -74,10 +75,11 @@ void Table::TableColumn::RecordEvent(const Baby &baby){
       if(!cut.GetScalar(baby)) continue;
 
     }else{
-      cut_vector_ = cut.GetVector(baby);
-      if(!have_vector || cut_vector_.size() < min_vec_size){
+      cut.GetMask(baby, cut_mask_);
+      if(!HavePass(cut_mask_)) continue;
+      if(!have_vector || cut_mask_.Size() < min_vec_size){
         have_vector = true;
-        min_vec_size = cut_vector_.size();
+        min_vec_size = cut_mask_.Size();
       }
     }
 
@@ -85,7 +87,7 @@ void Table::TableColumn::RecordEvent(const Baby &baby){
     if(wgt.IsScalar()){
       wgt_scalar = wgt.GetScalar(baby);
     }else{
-      wgt_vector_ = wgt.GetVector(baby);
+      wgt.GetVector(baby, wgt_vector_);
       if(!have_vector || wgt_vector_.size() < min_vec_size){
         have_vector = true;
         min_vec_size = wgt_vector_.size();
@@ -96,9 +98,8 @@ void Table::TableColumn::RecordEvent(const Baby &baby){
       sumw_.at(irow) += wgt_scalar;
       sumw2_.at(irow) += wgt_scalar*wgt_scalar;
     }else{
-      for(size_t iobject = 0; iobject < min_vec_size; ++iobject){
-        NamedFunc::ScalarType this_cut = cut.IsScalar() ? true : cut_vector_.at(iobject);
-        if(!this_cut) continue;
+      for(size_t iobject = cut.IsVector() ? cut_mask_.NextSet(0) : 0; iobject < min_vec_size;
+          iobject = cut.IsVector() ? cut_mask_.NextSet(iobject+1) : iobject+1){
         NamedFunc::ScalarType this_wgt = wgt.IsScalar() ? wgt_scalar : wgt_vector_.at(iobject);
         sumw_.at(irow) += this_wgt;
         sumw2_.at(irow) += this_wgt*this_wgt;
@@ -107,6 +108,26 @@ void Table::TableColumn::RecordEvent(const Baby &baby){
   }
 }
 
+/*!\brief Table columns can be merged across shards
+ */
+bool Table::TableColumn::CanMerge() const{
+  return true;
+}
+
+/*!\brief Writes the sums of weights and squared weights of each row
+ */
+void Table::TableColumn::WriteState(ostream &out){
+  ShardIO::WriteVector(out, sumw_);
+  ShardIO::WriteVector(out, sumw2_);
+}
+
+/*!\brief Adds the sums written by another shard
+ */
+void Table::TableColumn::MergeState(istream &in){
+  ShardIO::AddVector(in, sumw_);
+  ShardIO::AddVector(in, sumw2_);
+}
+
 Table::Table(const string &name,
     const vector<TableRow> &rows,
     const vector<shared_ptr<Process> > &processes,
@@ -233,6 +254,16 @@ set<const Process*> Table::GetProcesses() const{
   return processes;
 }
 
+vector<NamedFunc> Table::GetFunctions() const{
+  vector<NamedFunc> functions;
+  for(const auto &row: rows_){
+    if(!row.is_data_row_) continue;
+    functions.push_back(row.cut_);
+    functions.push_back(row.weight_);
+  }
+  return functions;
+}
+
 Figure::FigureComponent * Table::GetComponent(const Process *process){
   const auto &component_list = GetComponentList(process);
   for(const auto &component: component_list){
@@ -1,14 +1,109 @@
+/*! \class ThreadPool
+
+  \brief Fixed set of worker threads running tasks with work stealing
+
+  Each worker owns a deque of tasks. A task pushed from one of the pool's own
+  threads goes to that thread's deque, and tasks pushed from outside are dealt
+  to the workers in turn. A worker runs the newest task of its own deque and,
+  once that is empty, steals the oldest task from another worker. Each deque
+  has its own mutex, so threads only contend when stealing from the same
+  worker, instead of all tasks going through a single queue.
+
+  ThreadPool::Push() runs one callable and returns a std::future for its
+  result. For many small tasks, ThreadPool::PushRange() and
+  ThreadPool::ParallelFor() split an index range into chunks submitted in one
+  go, without a future per index. Completion is tracked by a ThreadPool::Latch,
+  which also carries the first exception thrown. A thread waiting with
+  ThreadPool::Wait() runs queued tasks until its range is done, so ranges may
+  be submitted from inside tasks.
+
+  Worker threads can be bound to NUMA nodes with ThreadPool::PinThreads()
+  (Linux only). Consecutive workers then go to different nodes (see
+  NumaTopology), each free to run on any CPU of its node so that concurrent
+  processes are balanced by the scheduler, and a new thread binds itself
+  before running any task, so the memory it allocates is placed on its own
+  node. Idle workers steal from
+  workers on the same node before crossing to another one.
+  ThreadPool::CurrentNode() tells a task which node it runs on.
+*/
+
+/*! \class ThreadPool::Latch
+
+  \brief Counter of outstanding tasks that can be waited on
+*/
 #include "core/thread_pool.hpp"
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "TThread.h"
 
+#include "core/numa_topology.hpp"
+
 using namespace std;
 
+namespace{
+  thread_local const ThreadPool *current_pool = nullptr;//!<Pool owning the calling thread, if any
+  thread_local size_t current_worker = 0;//!<Index of the calling thread in current_pool
+}
+
+/*!\brief Standard constructor
+
+  \param[in] count Initial number of outstanding tasks
+*/
+ThreadPool::Latch::Latch(size_t count):
+  count_(count),
+  error_(),
+  mutex_(),
+  cv_(){
+}
+
+/*!\brief Adds count outstanding tasks
+ */
+void ThreadPool::Latch::Add(size_t count){
+  count_ += count;
+}
+
+/*!\brief Marks one task as done
+ */
+void ThreadPool::Latch::CountDown(){
+  lock_guard<mutex> lock(mutex_);
+  if(--count_ == 0) cv_.notify_all();
+}
+
+/*!\brief Records an exception thrown by a task, rethrown by
+  ThreadPool::Latch::Wait(). Only the first one is kept.
+*/
+void ThreadPool::Latch::Fail(exception_ptr error){
+  lock_guard<mutex> lock(mutex_);
+  if(!error_) error_ = error;
+}
+
+/*!\brief Check if all tasks are done
+ */
+bool ThreadPool::Latch::Done() const{
+  return count_ == 0;
+}
+
+/*!\brief Blocks until all tasks are done, rethrowing the first exception of a
+  task. Must be called before the latch is destroyed.
+*/
+void ThreadPool::Latch::Wait(){
+  unique_lock<mutex> lock(mutex_);
+  cv_.wait(lock, [this](){return count_ == 0;});
+  if(error_) rethrow_exception(error_);
+}
+
+/*!\brief Constructs pool with one thread less than the number of CPUs
+ */
 ThreadPool::ThreadPool():
-  tasks_(),
-  threads_(),
-  stop_thread_now_(),
-  stop_at_empty_(),
+  workers_(),
+  queued_(0),
+  next_worker_(0),
+  stop_at_empty_(false),
+  pin_threads_(false),
   mutex_(),
   cv_(){
   TThread::Initialize();
@@ -21,97 +116,287 @@ ThreadPool::ThreadPool():
   Resize(num_threads);
 }
 
-ThreadPool::ThreadPool(std::size_t num_threads):
-  tasks_(),
-  threads_(),
-  stop_thread_now_(),
-  stop_at_empty_(),
+/*!\brief Constructs pool with num_threads threads, bound to CPUs from the
+  start if pin_threads is set
+ */
+ThreadPool::ThreadPool(std::size_t num_threads, bool pin_threads):
+  workers_(),
+  queued_(0),
+  next_worker_(0),
+  stop_at_empty_(false),
+  pin_threads_(pin_threads),
   mutex_(),
   cv_(){
   TThread::Initialize();
   Resize(num_threads);
 }
 
+/*!\brief Runs all queued tasks and joins the threads
+ */
 ThreadPool::~ThreadPool(){
-  stop_at_empty_ = true;
-  {
-    lock_guard<mutex> lock(mutex_);
-    cv_.notify_all();
+  StopThreads();
+}
+
+size_t ThreadPool::Size() const{
+  return workers_.size();
+}
+
+/*!\brief Changes the number of threads
+
+  Waits for all queued tasks to finish first. Must not be called from a task
+  or concurrently with pushing tasks. With zero threads, tasks run immediately
+  in the pushing thread.
+*/
+void ThreadPool::Resize(size_t num_threads){
+  if(num_threads == Size()) return;
+  StopThreads();
+  workers_.resize(num_threads);
+  for(auto &worker: workers_){
+    if(worker == nullptr) worker.reset(new Worker());
   }
+  StartThreads();
+}
 
-  for(size_t ithread = 0; ithread < Size(); ++ithread){
-    if(threads_.at(ithread)->joinable()){
-      threads_.at(ithread)->join();
-    }
+/*!\brief Binds worker i to the CPUs of node NumaTopology::WorkerNode(i), or lets workers
+  run on the CPUs allowed for the calling thread again. Has no effect outside
+  Linux.
+
+  Memory already allocated by running workers stays where it is. To keep it
+  local, pin from the constructor instead.
+*/
+void ThreadPool::PinThreads(bool pin){
+  pin_threads_ = pin;
+  ApplyAffinity();
+}
+
+/*!\brief NUMA node of the calling thread if it is a bound worker of a pool,
+  -1 otherwise
+*/
+int ThreadPool::CurrentNode(){
+  if(current_pool == nullptr) return -1;
+  return current_pool->workers_[current_worker]->node_;
+}
+
+/*!\brief Runs func(i) for every i in [begin, end) without waiting for it
+
+  The range is split into chunks of grain indices, one task each, all queued
+  at once. latch is counted up by the number of chunks and counted down as
+  each finishes; it must outlive them.
+
+  \param[in] begin First index
+
+  \param[in] end One past the last index
+
+  \param[in] func Function called for each index, possibly concurrently
+
+  \param[in,out] latch Tracks completion of the chunks
+
+  \param[in] grain Indices per task. If 0, about four tasks per thread are
+  made.
+*/
+void ThreadPool::PushRange(size_t begin, size_t end,
+                           const function<void(size_t)> &func,
+                           Latch &latch, size_t grain){
+  if(end <= begin) return;
+  size_t count = end - begin;
+  if(grain == 0) grain = max(count/(4*max(Size(), static_cast<size_t>(1))), static_cast<size_t>(1));
+  size_t num_chunks = (count + grain - 1)/grain;
+  latch.Add(num_chunks);
+
+  auto body = make_shared<const function<void(size_t)> >(func);
+  vector<Task> tasks;
+  tasks.reserve(num_chunks);
+  for(size_t first = begin; first < end; first = end - first > grain ? first + grain : end){
+    size_t last = end - first > grain ? first + grain : end;
+    tasks.push_back([body, first, last, &latch](){
+        try{
+          for(size_t i = first; i < last; ++i) (*body)(i);
+        }catch(...){
+          latch.Fail(current_exception());
+        }
+        latch.CountDown();
+      });
   }
+  Enqueue(tasks);
 }
 
-size_t ThreadPool::Size() const{
-  return threads_.size();
+/*!\brief Runs func(i) for every i in [begin, end) and waits for completion
+
+  See ThreadPool::PushRange(). The calling thread helps run the tasks. The
+  first exception thrown by func is rethrown once all indices are processed.
+*/
+void ThreadPool::ParallelFor(size_t begin, size_t end,
+                             const function<void(size_t)> &func,
+                             size_t grain){
+  Latch latch;
+  PushRange(begin, end, func, latch, grain);
+  Wait(latch);
 }
 
-void ThreadPool::Resize(size_t num_threads){
-  size_t old_num_threads = Size();
-  if(num_threads > old_num_threads){
-    threads_.resize(num_threads);
-    stop_thread_now_.resize(num_threads);
+/*!\brief Runs queued tasks in the calling thread until latch is done, then
+  waits for the tasks still running elsewhere
 
-    for(size_t ithread = old_num_threads; ithread < num_threads; ++ithread){
-      threads_.at(ithread).reset(new thread(&ThreadPool::DoTasksFromQueue, this, ithread));
-    }
-  }else if(num_threads < old_num_threads){
-    for(size_t ithread = num_threads; ithread < old_num_threads; ++ithread){
-      *stop_thread_now_.at(ithread) = true;
-      threads_.at(ithread)->detach();
-    }
+  Rethrows the first exception recorded by latch.
+*/
+void ThreadPool::Wait(Latch &latch){
+  Task task;
+  while(!latch.Done() && TakeTask(task)){
+    task();
+    task = nullptr;
+  }
+  latch.Wait();
+}
 
-    {
-      lock_guard<mutex> lock(mutex_);
-      cv_.notify_all();
+void ThreadPool::Enqueue(Task &&task){
+  if(workers_.empty()){
+    task();
+    return;
+  }
+  size_t iworker = current_pool == this ? current_worker : next_worker_++ % workers_.size();
+  Worker &worker = *workers_[iworker];
+  // Counted before it is published, so a thief taking it at once cannot
+  // make queued_ wrap around
+  ++queued_;
+  {
+    lock_guard<mutex> lock(worker.mutex_);
+    worker.tasks_.push_back(move(task));
+  }
+  {
+    lock_guard<mutex> lock(mutex_);
+  }
+  cv_.notify_one();
+}
+
+/*!\brief Deals tasks to the workers in contiguous slices and wakes all
+  threads once
+*/
+void ThreadPool::Enqueue(vector<Task> &tasks){
+  if(workers_.empty()){
+    for(auto &task: tasks) task();
+    return;
+  }
+  size_t num_workers = workers_.size();
+  size_t offset = current_pool == this ? current_worker : next_worker_++;
+  queued_ += tasks.size();
+  for(size_t i = 0; i < num_workers; ++i){
+    size_t first = tasks.size()*i/num_workers, last = tasks.size()*(i+1)/num_workers;
+    if(first == last) continue;
+    Worker &worker = *workers_[(offset+i) % num_workers];
+    lock_guard<mutex> lock(worker.mutex_);
+    for(size_t itask = first; itask < last; ++itask){
+      worker.tasks_.push_back(move(tasks[itask]));
     }
+  }
+  tasks.clear();
+  {
+    lock_guard<mutex> lock(mutex_);
+  }
+  cv_.notify_all();
+}
+
+/*!\brief Takes the newest task of the calling worker's deque, or else the
+  oldest task of another deque
+
+  \param[out] task Task to run if one was found
 
-    threads_.resize(num_threads);
-    stop_thread_now_.resize(num_threads);
+  \return True if a task was found
+*/
+bool ThreadPool::TakeTask(Task &task){
+  if(queued_ == 0 || workers_.empty()) return false;
+  size_t num_workers = workers_.size();
+  bool is_worker = current_pool == this;
+  size_t first = is_worker ? current_worker : next_worker_ % num_workers;
+  int node = is_worker ? workers_[first]->node_.load() : -1;
+  // Bound workers look at their own node first
+  for(int pass = node < 0 ? 1 : 0; pass < 2; ++pass){
+    for(size_t i = 0; i < num_workers; ++i){
+      Worker &worker = *workers_[(first+i) % num_workers];
+      if(pass == 0 && worker.node_ != node) continue;
+      if(pass == 1 && node >= 0 && worker.node_ == node) continue;
+      lock_guard<mutex> lock(worker.mutex_);
+      if(worker.tasks_.empty()) continue;
+      if(is_worker && i == 0){
+        task = move(worker.tasks_.back());
+        worker.tasks_.pop_back();
+      }else{
+        task = move(worker.tasks_.front());
+        worker.tasks_.pop_front();
+      }
+      --queued_;
+      return true;
+    }
   }
+  return false;
 }
 
-void ThreadPool::DoTasksFromQueue(size_t ithread){
-  unique_ptr<function<void()> > task = tasks_.Pop();
+void ThreadPool::DoTasks(size_t ithread){
+  current_pool = this;
+  current_worker = ithread;
+  if(pin_threads_) BindWorker(ithread, true);
+  Task task;
   while(true){
-    while(task != nullptr){
-      (*task)();
-      if(stop_thread_now_.at(ithread)) return;
-      task = tasks_.Pop();
+    if(TakeTask(task)){
+      task();
+      task = nullptr;
+      continue;
     }
-
     unique_lock<mutex> lock(mutex_);
-    cv_.wait(lock, bind(&ThreadPool::ReadyToAct, this, ithread, ref(task)));
-    if(task == nullptr) return;
+    cv_.wait(lock, [this](){return queued_ > 0 || stop_at_empty_;});
+    if(queued_ == 0 && stop_at_empty_) return;
   }
 }
 
-bool ThreadPool::ReadyToAct(size_t ithread, unique_ptr<function<void()> > &task){
-  if(stop_thread_now_.at(ithread)){
-    return true;
-  }else{
-    task = tasks_.Pop();
-    return stop_at_empty_ || task != nullptr;
+void ThreadPool::StartThreads(){
+  stop_at_empty_ = false;
+  for(size_t ithread = 0; ithread < workers_.size(); ++ithread){
+    workers_[ithread]->thread_ = thread(&ThreadPool::DoTasks, this, ithread);
   }
 }
 
-void ThreadPool::Queue::Push(FuncPtr &func){
-  lock_guard<mutex> lock(mutex_);
-  queue_.push(unique_ptr<function<void()> >());
-  queue_.back() = move(func);
+/*!\brief Lets the threads finish all queued tasks and joins them
+ */
+void ThreadPool::StopThreads(){
+  stop_at_empty_ = true;
+  {
+    lock_guard<mutex> lock(mutex_);
+    cv_.notify_all();
+  }
+  for(auto &worker: workers_){
+    if(worker->thread_.joinable()) worker->thread_.join();
+  }
 }
 
-ThreadPool::Queue::FuncPtr ThreadPool::Queue::Pop(){
-  lock_guard<mutex> lock(mutex_);
-  if(queue_.empty()){
-    return FuncPtr();
+void ThreadPool::ApplyAffinity(){
+  for(size_t ithread = 0; ithread < workers_.size(); ++ithread){
+    if(workers_[ithread]->thread_.joinable()) BindWorker(ithread, false);
+  }
+}
+
+/*!\brief Binds a worker to the CPUs of its node if ThreadPool::pin_threads_ is set, and
+  otherwise to the CPUs allowed for the calling thread
+
+  \param[in] ithread Index of the worker
+
+  \param[in] self Whether the calling thread is the worker itself
+*/
+void ThreadPool::BindWorker(size_t ithread, bool self){
+  Worker &worker = *workers_[ithread];
+  worker.node_ = -1;
+#ifdef __linux__
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  int node = -1;
+  if(pin_threads_){
+    const NumaTopology &topology = NumaTopology::Get();
+    size_t inode = topology.WorkerNode(ithread);
+    for(const auto &cpu: topology.Cpus(inode)) CPU_SET(cpu, &cpus);
+    node = topology.NodeId(inode);
   }else{
-    Queue::FuncPtr func = move(queue_.front());
-    queue_.pop();
-    return func;
+    sched_getaffinity(0, sizeof(cpus), &cpus);
   }
+  pthread_t handle = self ? pthread_self() : worker.thread_.native_handle();
+  if(pthread_setaffinity_np(handle, sizeof(cpus), &cpus) == 0) worker.node_ = node;
+#else
+  (void)self;
+#endif
 }
@@ -32,6 +32,9 @@ Token::Type Token::GetType(const string &x){
     case ')': return Type::close_paren;
     case '[': return Type::open_square;
     case ']': return Type::close_square;
+    case ',': return Type::comma;
+    case '?': return Type::question;
+    case ':': return Type::colon;
     default: return Type::unknown;
     }
   case 2:
@@ -9,9 +9,13 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 #include <unistd.h>
 #include <glob.h>
+#include <fnmatch.h>
+#include <dirent.h>
 #include <libgen.h>
 #include <sys/stat.h>
 
@@ -23,18 +27,169 @@
 #include "TArrow.h"
 #include "RooStats/RooStatsUtils.h"
 
+#include "core/numa_topology.hpp"
+#include "core/thread_pool.hpp"
+
 using namespace std;
 
 mutex Multithreading::root_mutex;
 
+namespace{
+  //! Entries of a directory as of its last modification time
+  struct DirectoryListing{
+    timespec mtime_;//!<Modification time of the directory when read
+    string real_path_;//!<Directory with symbolic links resolved
+    vector<pair<string, bool> > entries_;//!<Entry names, and whether each must be checked with AddEntryPaths()
+  };
+
+  bool HasWildcard(const string &s){
+    return s.find_first_of("*?[\\") != string::npos;
+  }
+
+  /*!\brief Pool shared by GlobAll() and AddEntryPaths()
+
+    Globbing waits on the file system rather than the CPU, so a few threads
+    are enough. Nested ranges run on the same pool (see ThreadPool::Wait()).
+  */
+  ThreadPool & GlobPool(){
+    static ThreadPool pool(min(NumaTopology::Get().NumCpus(), static_cast<size_t>(8)));
+    return pool;
+  }
+
+  /*!\brief Adds each of paths that exists to ret, with symbolic links in its
+    directory resolved, checking large lists on several threads
+
+    A symbolic link in the file name itself is kept, so that a file is known by
+    the name under which its directory lists it (see SampleManifest::Lookup()).
+  */
+  void AddEntryPaths(const vector<string> &paths, set<string> &ret){
+    vector<string> resolved(paths.size());
+    auto resolve = [&paths, &resolved](size_t i){
+      const string &path = paths[i];
+      size_t slash = path.rfind('/');
+      string dir = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+      string name = slash == string::npos ? path : path.substr(slash+1);
+      bool is_dir_name = name == "." || name == "..";
+      struct stat path_stat;
+      if(stat(path.c_str(), &path_stat) != 0) return;
+      char *real = realpath((is_dir_name ? path : dir).c_str(), nullptr);
+      if(real == nullptr) return;
+      string real_str = real;
+      free(real);
+      if(is_dir_name) resolved[i] = real_str;
+      else resolved[i] = (real_str == "/" ? "/" : real_str+"/")+name;
+    };
+    if(paths.size() < 256){
+      for(size_t i = 0; i < paths.size(); ++i) resolve(i);
+    }else{
+      GlobPool().ParallelFor(0, paths.size(), resolve, 64);
+    }
+    for(auto &path: resolved){
+      if(!path.empty()) ret.insert(move(path));
+    }
+  }
+
+  /*!\brief Get entries of directory dir, reading it only if it changed since
+    the last call
+
+    Many processes are usually globbed from the same few directories, so each
+    is listed once per program instead of once per pattern.
+
+    \return Listing, or nullptr if dir cannot be read
+  */
+  shared_ptr<const DirectoryListing> ListDirectory(const string &dir){
+    static mutex listings_mutex;
+    static unordered_map<string, shared_ptr<const DirectoryListing> > listings;
+
+    struct stat dir_stat;
+    if(stat(dir.c_str(), &dir_stat) != 0 || !S_ISDIR(dir_stat.st_mode)) return nullptr;
+    {
+      lock_guard<mutex> lock(listings_mutex);
+      auto found = listings.find(dir);
+      if(found != listings.end()
+         && found->second->mtime_.tv_sec == dir_stat.st_mtim.tv_sec
+         && found->second->mtime_.tv_nsec == dir_stat.st_mtim.tv_nsec){
+        return found->second;
+      }
+    }
+
+    auto listing = make_shared<DirectoryListing>();
+    listing->mtime_ = dir_stat.st_mtim;
+    char *real = realpath(dir.c_str(), nullptr);
+    if(real == nullptr) return nullptr;
+    listing->real_path_ = real;
+    free(real);
+    DIR *dir_p = opendir(dir.c_str());
+    if(dir_p == nullptr) return nullptr;
+    while(const dirent *entry = readdir(dir_p)){
+      string name = entry->d_name;
+      bool resolve = entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN || name == "." || name == "..";
+      listing->entries_.emplace_back(name, resolve);
+    }
+    closedir(dir_p);
+
+    lock_guard<mutex> lock(listings_mutex);
+    listings[dir] = listing;
+    return listing;
+  }
+}
+
+/*!\brief Get paths of existing files matching a shell wildcard pattern, with
+  symbolic links resolved in the directory but not in the file name
+
+  Patterns with wildcards only in the file name are matched against a cached
+  listing of the directory (see ListDirectory), so globbing many patterns in
+  the same directory reads it once. Other patterns, e.g. with wildcards in
+  directory names or starting with "~", go through glob().
+*/
 set<string> Glob(const string &pattern){
-  glob_t glob_result;
-  glob(pattern.c_str(), GLOB_TILDE, nullptr, &glob_result);
+  size_t slash = pattern.rfind('/');
+  string dir = slash == string::npos ? "." : slash == 0 ? "/" : pattern.substr(0, slash);
+  string base = slash == string::npos ? pattern : pattern.substr(slash+1);
+  set<string> ret;
+  if(pattern.empty() || pattern.at(0) == '~' || base.empty() || HasWildcard(dir)){
+    glob_t glob_result;
+    glob(pattern.c_str(), GLOB_TILDE, nullptr, &glob_result);
+    vector<string> paths(glob_result.gl_pathv, glob_result.gl_pathv+glob_result.gl_pathc);
+    globfree(&glob_result);
+    AddEntryPaths(paths, ret);
+    return ret;
+  }
+
+  auto listing = ListDirectory(dir);
+  if(listing == nullptr) return ret;
+  string prefix = listing->real_path_ == "/" ? "/" : listing->real_path_+"/";
+  vector<string> links;
+  for(const auto &entry: listing->entries_){
+    if(fnmatch(base.c_str(), entry.first.c_str(), FNM_PERIOD) != 0) continue;
+    if(entry.second){
+      links.push_back(dir+"/"+entry.first);
+    }else{
+      ret.insert(prefix+entry.first);
+    }
+  }
+  AddEntryPaths(links, ret);
+  return ret;
+}
+
+/*!\brief Get paths of existing files matching any of patterns (see Glob()), globbing
+  the patterns on several threads
+*/
+set<string> GlobAll(const set<string> &patterns){
+  vector<string> pattern_list(patterns.cbegin(), patterns.cend());
+  vector<set<string> > matches(pattern_list.size());
+  auto glob_pattern = [&pattern_list, &matches](size_t i){
+    matches[i] = Glob(pattern_list[i]);
+  };
+  if(pattern_list.size() < 4){
+    for(size_t i = 0; i < pattern_list.size(); ++i) glob_pattern(i);
+  }else{
+    GlobPool().ParallelFor(0, pattern_list.size(), glob_pattern, 1);
+  }
   set<string> ret;
-  for(size_t i=0; i<glob_result.gl_pathc; ++i){
-    ret.emplace(realpath(glob_result.gl_pathv[i], nullptr));
+  for(auto &match: matches){
+    ret.insert(match.cbegin(), match.cend());
   }
-  globfree(&glob_result);
   return ret;
 }
 
@@ -0,0 +1,99 @@
+/*! \class VectorArena
+
+  \brief Per-thread pool of storage for NamedFunc vector temporaries
+
+  Vector-valued NamedFuncs return a NamedFunc::VectorType by value, and nested
+  expressions such as "photon_pt>15 && photon_sig" produce one such vector per
+  operand per event. Allocating each of them from the global heap makes malloc a
+  point of contention when many threads fill figures at once.
+
+  VectorArena keeps, separately for each thread, a stack of vectors whose
+  storage is no longer used. VectorArena::Get() hands out one of them instead
+  of allocating, and VectorArena::Recycle() returns the storage of a temporary
+  once its values have been consumed. After the first few events of a Baby,
+  the largest collection sizes have been seen and vector-valued expressions run
+  without touching the heap. Since every thread has its own pool, no locking
+  is needed.
+
+  NamedFunc::VectorType stays a std::vector, so vectors from the pool can be
+  returned and stored like any other, and code not using the pool keeps
+  working. Storage that is not recycled is simply freed by its owner.
+  VectorArena::Reset() releases the pool of the calling thread, which
+  PlotMaker does at the end of each Baby.
+*/
+#include "core/vector_arena.hpp"
+
+#include <vector>
+
+using namespace std;
+
+using VectorType = NamedFunc::VectorType;
+
+namespace{
+  //! Maximum number of vectors kept per thread
+  const size_t max_free = 256;
+
+  //! Vectors with larger capacity are freed rather than kept
+  const size_t max_capacity = 1 << 16;
+
+  struct Pool{
+    vector<VectorType> free_;//!<Vectors with unused storage, most recently recycled last
+    long allocations_;//!<Calls to VectorArena::Get needing new storage
+  };
+
+  Pool & LocalPool(){
+    thread_local Pool pool{vector<VectorType>(), 0};
+    return pool;
+  }
+}
+
+/*!\brief Get a vector of size zeros, reusing recycled storage if available
+
+  \param[in] size Number of elements
+
+  \return Vector of size elements set to 0
+*/
+VectorType VectorArena::Get(size_t size){
+  Pool &pool = LocalPool();
+  VectorType vec;
+  if(!pool.free_.empty()){
+    vec = move(pool.free_.back());
+    pool.free_.pop_back();
+  }
+  if(vec.capacity() < size) ++pool.allocations_;
+  vec.assign(size, 0.);
+  return vec;
+}
+
+/*!\brief Return the storage of vec to the pool of the calling thread
+
+  \param[in,out] vec Vector whose values are no longer needed. Left empty.
+*/
+void VectorArena::Recycle(VectorType &vec){
+  Pool &pool = LocalPool();
+  if(vec.capacity() == 0 || vec.capacity() > max_capacity || pool.free_.size() >= max_free){
+    VectorType().swap(vec);
+    return;
+  }
+  pool.free_.push_back(move(vec));
+  vec.clear();
+}
+
+/*!\brief Free all storage in the pool of the calling thread
+ */
+void VectorArena::Reset(){
+  vector<VectorType>().swap(LocalPool().free_);
+}
+
+/*!\brief Number of vectors in the pool of the calling thread
+ */
+size_t VectorArena::NumFree(){
+  return LocalPool().free_.size();
+}
+
+/*!\brief Number of calls to VectorArena::Get() in the calling thread that could
+  not reuse storage
+*/
+long VectorArena::NumAllocations(){
+  return LocalPool().allocations_;
+}
@@ -12,6 +12,7 @@
 #include "TLorentzVector.h"
 
 #include "core/baby.hpp"
+#include "core/gen_tree.hpp"
 #include "core/process.hpp"
 #include "core/named_func.hpp"
 #include "core/plot_maker.hpp"
@@ -32,18 +33,11 @@ int main(){
 
   NamedFunc sig_lepid("signal lepton ID",[](const Baby &b) -> NamedFunc::ScalarType{
 //     int iz(-1), lepid(0);
-    int lepid(0);
 //     bool checktau(false);
-    for(size_t imc(0); imc < b.mc_id()->size(); imc++) {
-      lepid = abs(b.mc_id()->at(imc));
-      if(lepid == 11 || lepid == 13 || lepid == 15)
-        return lepid;
-      if(b.mc_mom()->at(imc) == 23 && b.mc_mom()->at(b.mc_momidx()->at(imc)) == 25) {
-        lepid = abs(b.mc_id()->at(imc));
-        if(lepid == 11 || lepid == 13 || lepid == 15)
-          return lepid;
-      }
-    }
+    const GenTree &tree = GenTree::Get(b);
+    int imc = tree.FirstAbs({11, 13, 15});
+    if(imc >= 0)
+      return abs(tree.Id(imc));
 //       if(b.mc_id()->at(imc) == 23 && b.mc_mom()->at(imc) == 25)
 //         iz = imc;
 //       if(b.mc_momidx()->at(imc) == iz && b.mc_id()->at(imc) == 15)
@@ -58,7 +52,7 @@ int main(){
 //     return b.ll_lepid()->at(0);
 //   if(b.nmu() > 1) return 13;
 //   if(b.nel() > 1) return 11;
-  return lepid;
+  return 0;
   });
 
   NamedFunc nels("Number of electrons with WP98",[](const Baby &b) -> NamedFunc::ScalarType{ 
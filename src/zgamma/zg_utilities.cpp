@@ -1,5 +1,6 @@
 #include "zgamma/zg_utilities.hpp"
 #include "zgamma/KinZfitter.h"
+#include "core/gen_tree.hpp"
 
 namespace ZgUtilities {
   using std::string;
@@ -10,16 +11,14 @@ namespace ZgUtilities {
   TLorentzVector AssignL1(const Baby &b, bool gen) {
     TLorentzVector l1;
     if(gen) {
-      for(size_t i = 0; i < b.mc_id()->size(); i++)
-        if(b.mc_id()->at(i) == 11 ||
-           b.mc_id()->at(i) == 13 ||
-           b.mc_id()->at(i) == 15) {
-            l1.SetPtEtaPhiM(b.mc_pt()->at(i),
-                            b.mc_eta()->at(i),
-                            b.mc_phi()->at(i),
-                            b.mc_mass()->at(i));
-            if(b.mc_mom()->at(i) == 23) break;
-          }
+      const GenTree &tree = GenTree::Get(b);
+      int i = tree.First({11, 13, 15}, 23);
+      if(i < 0) i = tree.Last({11, 13, 15});
+      if(i >= 0)
+        l1.SetPtEtaPhiM(b.mc_pt()->at(i),
+                        b.mc_eta()->at(i),
+                        b.mc_phi()->at(i),
+                        b.mc_mass()->at(i));
     }
     else{
       int il(-1);
@@ -46,16 +45,14 @@ namespace ZgUtilities {
   TLorentzVector AssignL2(const Baby &b, bool gen) {
     TLorentzVector l2;
     if(gen) {
-      for(size_t i = 0; i < b.mc_id()->size(); i++)
-        if(b.mc_id()->at(i) == -11 ||
-           b.mc_id()->at(i) == -13 ||
-           b.mc_id()->at(i) == -15) {
-            l2.SetPtEtaPhiM(b.mc_pt()->at(i),
-                            b.mc_eta()->at(i),
-                            b.mc_phi()->at(i),
-                            b.mc_mass()->at(i));
-            if(b.mc_mom()->at(i) == 23) break;
-          }
+      const GenTree &tree = GenTree::Get(b);
+      int i = tree.First({-11, -13, -15}, 23);
+      if(i < 0) i = tree.Last({-11, -13, -15});
+      if(i >= 0)
+        l2.SetPtEtaPhiM(b.mc_pt()->at(i),
+                        b.mc_eta()->at(i),
+                        b.mc_phi()->at(i),
+                        b.mc_mass()->at(i));
     }
     else{
       int il(-1);